@@ -0,0 +1,222 @@
+/**
+ *
+ * Arduino.h: Minimal Arduino core API for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+// Only the subset of the Arduino core API used by the library is provided.
+// Flash (PROGMEM) helpers map to plain memory functions.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+
+using std::isinf;
+using std::isnan;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+// Milliseconds since the first call
+unsigned long millis();
+// Microseconds since the first call
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Sets time zone. NTP servers are ignored, host clock is expected to be synced
+void configTzTime(const char *tz, const char *server1,
+                  const char *server2 = nullptr,
+                  const char *server3 = nullptr);
+
+class String {
+ public:
+  String() {}
+  String(const char *cstr) : _str(cstr ? cstr : "") {}
+  String(const std::string &str) : _str(str) {}
+  String(const __FlashStringHelper *pstr)
+      : String(reinterpret_cast<const char *>(pstr)) {}
+  explicit String(char c) : _str(1, c) {}
+  explicit String(int value) : _str(std::to_string(value)) {}
+  explicit String(unsigned int value) : _str(std::to_string(value)) {}
+  explicit String(long value) : _str(std::to_string(value)) {}
+  explicit String(unsigned long value) : _str(std::to_string(value)) {}
+  String(float value, unsigned char decimalPlaces = 2);
+  String(double value, unsigned char decimalPlaces = 2);
+  const char *c_str() const { return _str.c_str(); }
+  unsigned int length() const { return _str.length(); }
+  bool reserve(unsigned int size) {
+    _str.reserve(size);
+    return true;
+  }
+  long toInt() const { return atol(_str.c_str()); }
+  float toFloat() const { return atof(_str.c_str()); }
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &s, unsigned int from = 0) const;
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const;
+  void toLowerCase();
+  void trim();
+  bool equals(const String &s) const { return _str == s._str; }
+  bool equalsIgnoreCase(const String &s) const;
+  bool startsWith(const String &s) const { return _str.rfind(s._str, 0) == 0; }
+  char charAt(unsigned int i) const { return i < _str.length() ? _str[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  String &operator+=(const String &s) {
+    _str += s._str;
+    return *this;
+  }
+  String &operator+=(const char *s) {
+    _str += s;
+    return *this;
+  }
+  String &operator+=(char c) {
+    _str.push_back(c);
+    return *this;
+  }
+  bool operator==(const String &s) const { return _str == s._str; }
+  bool operator==(const char *s) const { return _str == s; }
+  bool operator!=(const String &s) const { return _str != s._str; }
+  bool operator!=(const char *s) const { return _str != s; }
+  friend String operator+(const String &a, const String &b) {
+    return String(a._str + b._str);
+  }
+  friend String operator+(const String &a, const char *b) {
+    return String(a._str + b);
+  }
+  friend String operator+(const char *a, const String &b) {
+    return String(a + b._str);
+  }
+
+ private:
+  std::string _str;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+  virtual void flush() {}
+  size_t print(const char *str) { return write(str); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(const __FlashStringHelper *s) {
+    return write(reinterpret_cast<const char *>(s));
+  }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n) { return printf("%d", n); }
+  size_t print(unsigned int n) { return printf("%u", n); }
+  size_t print(long n) { return printf("%ld", n); }
+  size_t print(unsigned long n) { return printf("%lu", n); }
+  size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T &v) {
+    return print(v) + println();
+  }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  size_t printf_P(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+ protected:
+  size_t vprintf(const char *format, va_list args);
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) {
+    return readBytes((char *)buffer, length);
+  }
+  String readStringUntil(char terminator);
+  String readString();
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() const { return _timeout; }
+
+ protected:
+  // Reads byte, waits up to timeout for data
+  int timedRead();
+  // Waits until data is available. Returns false on timeout or end of stream
+  virtual bool waitAvailable(unsigned long timeoutMs);
+  unsigned long _timeout = 1000;
+};
+
+// Console output
+class HostSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  void setDebugOutput(bool) {}
+  virtual size_t write(uint8_t c) override;
+  virtual size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  virtual int available() override { return 0; }
+  virtual int read() override { return -1; }
+  virtual int peek() override { return -1; }
+  virtual void flush() override;
+};
+
+extern HostSerial Serial;
+
+#endif  //_HOST_ARDUINO_H_
@@ -0,0 +1,142 @@
+/**
+ *
+ * HTTPClient.h: HTTP/1.1 client for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _HOST_HTTP_CLIENT_H_
+#define _HOST_HTTP_CLIENT_H_
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Same values as the ESP cores use
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+/**
+ * HTTPClient provides the subset of the ESP32 HTTPClient API used by the
+ * library: a single connection, optionally kept alive between requests.
+ */
+class HTTPClient {
+ public:
+  HTTPClient() {}
+  ~HTTPClient() { end(); }
+  HTTPClient(const HTTPClient &) = delete;
+  HTTPClient &operator=(const HTTPClient &) = delete;
+
+  bool begin(WiFiClient &client, const String &url);
+  bool begin(WiFiClient &client, const String &host, uint16_t port,
+             const String &uri = "/", bool https = false);
+  void end();
+  bool connected();
+
+  void setReuse(bool reuse) { _reuse = reuse; }
+  void setUserAgent(const String &userAgent) { _userAgent = userAgent.c_str(); }
+  void setTimeout(uint16_t timeout) { _tcpTimeout = timeout; }
+  void setConnectTimeout(int32_t connectTimeout) {
+    _connectTimeout = connectTimeout;
+  }
+  void addHeader(const String &name, const String &value, bool first = false,
+                 bool replace = true);
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+  String header(const char *name);
+  bool hasHeader(const char *name);
+
+  int GET();
+  int POST(uint8_t *payload, size_t size);
+  int POST(const String &payload);
+  int sendRequest(const char *type, const uint8_t *payload = nullptr,
+                  size_t size = 0);
+  // Sends size bytes of stream. With size 0, like ESP32, sends stream without
+  // Content-Length until available() returns -1
+  int sendRequest(const char *type, Stream *stream, size_t size = 0);
+
+  // Returns body size, -1 if not known (chunked or missing Content-Length)
+  int getSize() const { return _size; }
+  WiFiClient &getStream() {
+    _streamUsed = true;
+    return *_client;
+  }
+  WiFiClient *getStreamPtr() {
+    _streamUsed = true;
+    return connected() ? _client : nullptr;
+  }
+  // Reads whole body, decoding chunked transfer encoding
+  String getString();
+  static String errorToString(int error);
+
+ protected:
+  // Connects or reuses connection. Returns true if connected
+  bool connect();
+  // Sends request line and headers, Content-Length only if contentLength
+  bool sendHeader(const char *type, size_t size, bool contentLength = true);
+  int handleHeaderResponse();
+  int returnError(int error);
+  // Reads line terminated by \n, without \r\n. Returns false on timeout
+  bool readLine(std::string &line);
+
+  WiFiClient *_client = nullptr;
+  bool _secure = false;
+  std::string _host;
+  uint16_t _port = 80;
+  std::string _uri;
+  std::string _base64Auth;
+  std::string _connectedHost;
+  uint16_t _connectedPort = 0;
+  std::string _userAgent = "HostHTTPClient";
+  std::string _headers;
+  // Buffers reused by requests
+  std::string _request;
+  std::string _line;
+  bool _reuse = true;
+  bool _canReuse = false;
+  uint16_t _tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+  int32_t _connectTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+  int _returnCode = 0;
+  int _size = -1;
+  bool _chunked = false;
+  // Response body was not read completely
+  bool _bodyPending = false;
+  // Body was read directly from stream, unread size is not known
+  bool _streamUsed = false;
+  std::vector<std::pair<std::string, std::string>> _currentHeaders;
+};
+
+#endif  //_HOST_HTTP_CLIENT_H_
@@ -0,0 +1,67 @@
+/**
+ *
+ * Ticker.h: Periodic timer for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _HOST_TICKER_H_
+#define _HOST_TICKER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Ticker calls a callback periodically from a background thread, like the
+ * ESP timer task does on the device.
+ */
+class Ticker {
+ public:
+  typedef std::function<void(void)> callback_function_t;
+  Ticker() {}
+  ~Ticker() { detach(); }
+  Ticker(const Ticker &) = delete;
+  Ticker &operator=(const Ticker &) = delete;
+
+  void attach(float seconds, callback_function_t callback) {
+    attach_ms((uint32_t)(seconds * 1000), callback);
+  }
+  void attach_ms(uint32_t milliseconds, callback_function_t callback);
+  template <typename TArg>
+  void attach_ms(uint32_t milliseconds, void (*callback)(TArg), TArg arg) {
+    attach_ms(milliseconds, [callback, arg]() { callback(arg); });
+  }
+  void detach();
+  bool active() const { return _thread.joinable(); }
+
+ private:
+  std::thread _thread;
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  bool _stop = false;
+};
+
+#endif  //_HOST_TICKER_H_
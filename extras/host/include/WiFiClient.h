@@ -0,0 +1,93 @@
+/**
+ *
+ * WiFiClient.h: TCP client over POSIX sockets for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _HOST_WIFI_CLIENT_H_
+#define _HOST_WIFI_CLIENT_H_
+
+#include <Arduino.h>
+#include <sys/types.h>
+
+// Arduino Client interface
+class Client : public Stream {
+ public:
+  virtual int connect(const char *host, uint16_t port) = 0;
+  virtual int read(uint8_t *buf, size_t size) = 0;
+  using Stream::read;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() { return connected(); }
+};
+
+/**
+ * WiFiClient is a non-blocking TCP socket with a small receive buffer.
+ * Reads never block, timed reads wait using poll(2).
+ */
+class WiFiClient : public Client {
+ public:
+  WiFiClient() {}
+  virtual ~WiFiClient();
+  WiFiClient(const WiFiClient &) = delete;
+  WiFiClient &operator=(const WiFiClient &) = delete;
+  virtual int connect(const char *host, uint16_t port) override;
+  virtual int connect(const char *host, uint16_t port, int32_t timeoutMs);
+  virtual size_t write(uint8_t c) override { return write(&c, 1); }
+  virtual size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  virtual int available() override;
+  virtual int read() override;
+  virtual int read(uint8_t *buf, size_t size) override;
+  virtual int peek() override;
+  virtual void stop() override;
+  virtual uint8_t connected() override;
+  void setNoDelay(bool noDelay);
+  // Timeout of connect in ms
+  void setConnectTimeout(int32_t timeoutMs) { _connectTimeout = timeoutMs; }
+  // Underlying socket descriptor, -1 if not connected
+  int fd() const { return _fd; }
+
+ protected:
+  virtual bool waitAvailable(unsigned long timeoutMs) override;
+  // Called after TCP connection is established
+  virtual bool afterConnect(const char *) { return true; }
+  // Transport send/receive. Return -1 and set errno to EAGAIN when blocked
+  virtual ssize_t rawSend(const uint8_t *buf, size_t size);
+  virtual ssize_t rawRecv(uint8_t *buf, size_t size);
+  // Bytes buffered by the transport layer itself
+  virtual size_t rawPending() { return 0; }
+  // Waits for socket readiness, events are poll(2) flags
+  bool waitSocket(short events, int timeoutMs);
+  // Reads available data into the receive buffer without blocking.
+  // Returns number of buffered bytes, -1 when connection is closed
+  int fill();
+  int _fd = -1;
+  int32_t _connectTimeout = 5000;
+  bool _eof = false;
+  uint8_t _rx[1460];
+  size_t _rxPos = 0;
+  size_t _rxLen = 0;
+};
+
+#endif  //_HOST_WIFI_CLIENT_H_
@@ -0,0 +1,93 @@
+/**
+ *
+ * WiFiClientSecure.h: TLS client for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _HOST_WIFI_CLIENT_SECURE_H_
+#define _HOST_WIFI_CLIENT_SECURE_H_
+
+#include <WiFiClient.h>
+
+#include <string>
+
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+typedef struct ssl_session_st SSL_SESSION;
+
+/**
+ * TLSSession holds a TLS session for abbreviated handshake, like
+ * BearSSL::Session of the ESP8266 core. The session is stored DER encoded in a
+ * fixed buffer, so the object can be copied as a whole.
+ */
+class TLSSession {
+ public:
+  TLSSession() { clear(); }
+  // Forgets stored session
+  void clear();
+  // Returns true if a session is stored
+  bool isEmpty() const { return _length == 0; }
+
+ private:
+  friend class WiFiClientSecure;
+  uint16_t _length;
+  // Encoded session, includes server certificate
+  uint8_t _data[2046];
+};
+
+/**
+ * WiFiClientSecure implements TLS using OpenSSL. When the library is built
+ * without OpenSSL (INFLUXDB_CLIENT_HOST_TLS undefined), connecting fails.
+ */
+class WiFiClientSecure : public WiFiClient {
+ public:
+  WiFiClientSecure() {}
+  virtual ~WiFiClientSecure();
+  // Skips server certificate validation
+  void setInsecure() { _insecure = true; }
+  // Sets trusted CA certificate in PEM format
+  void setCACert(const char *rootCA) { _caCert = rootCA ? rootCA : ""; }
+  // Sets session resumed by the next connections and updated with sessions
+  // received from server
+  void setSession(TLSSession *session) { _session = session; }
+  // Returns true if the current connection resumed a session
+  bool isSessionReused() const;
+  virtual void stop() override;
+
+ protected:
+  virtual bool afterConnect(const char *host) override;
+  virtual ssize_t rawSend(const uint8_t *buf, size_t size) override;
+  virtual ssize_t rawRecv(uint8_t *buf, size_t size) override;
+  virtual size_t rawPending() override;
+  bool _insecure = false;
+  std::string _caCert;
+  SSL_CTX *_ctx = nullptr;
+  SSL *_ssl = nullptr;
+  TLSSession *_session = nullptr;
+
+ private:
+  // Stores a session received from server
+  static int newSession(SSL *ssl, SSL_SESSION *session);
+};
+
+#endif  //_HOST_WIFI_CLIENT_SECURE_H_
@@ -0,0 +1,234 @@
+/**
+ *
+ * Arduino.cpp: Minimal Arduino core API for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <Arduino.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+HostSerial Serial;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() { std::this_thread::yield(); }
+
+static std::minstd_rand randomEngine;
+
+long random(long max) { return max > 0 ? random(0, max) : 0; }
+
+long random(long min, long max) {
+  if (min >= max) {
+    return min;
+  }
+  return min + (long)(randomEngine() % (unsigned long)(max - min));
+}
+
+void randomSeed(unsigned long seed) { randomEngine.seed(seed); }
+
+void configTzTime(const char *tz, const char *, const char *, const char *) {
+  if (tz) {
+    setenv("TZ", tz, 1);
+    tzset();
+  }
+}
+
+String::String(float value, unsigned char decimalPlaces)
+    : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces) {
+  char buff[64];
+  snprintf(buff, sizeof(buff), "%.*f", decimalPlaces, value);
+  _str = buff;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  auto i = _str.find(c, from);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+int String::indexOf(const String &s, unsigned int from) const {
+  auto i = _str.find(s._str, from);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    std::swap(from, to);
+  }
+  if (from >= _str.length()) {
+    return String();
+  }
+  return String(_str.substr(from, to - from));
+}
+
+void String::toLowerCase() {
+  std::transform(_str.begin(), _str.end(), _str.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+}
+
+void String::trim() {
+  auto b = _str.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos) {
+    _str.clear();
+    return;
+  }
+  auto e = _str.find_last_not_of(" \t\r\n");
+  _str = _str.substr(b, e - b + 1);
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+  return _str.length() == s._str.length() &&
+         strcasecmp(_str.c_str(), s._str.c_str()) == 0;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) {
+      break;
+    }
+    n++;
+  }
+  return n;
+}
+
+size_t Print::vprintf(const char *format, va_list args) {
+  char buff[128];
+  va_list copy;
+  va_copy(copy, args);
+  int len = vsnprintf(buff, sizeof(buff), format, copy);
+  va_end(copy);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len < sizeof(buff)) {
+    return write((const uint8_t *)buff, len);
+  }
+  std::string big(len + 1, 0);
+  vsnprintf(&big[0], big.size(), format, args);
+  return write((const uint8_t *)big.data(), len);
+}
+
+size_t Print::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  auto n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+size_t Print::printf_P(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  auto n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+bool Stream::waitAvailable(unsigned long timeoutMs) {
+  auto start = millis();
+  while (available() <= 0) {
+    if (millis() - start >= timeoutMs) {
+      return false;
+    }
+    yield();
+  }
+  return true;
+}
+
+int Stream::timedRead() {
+  auto start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    auto elapsed = millis() - start;
+    if (elapsed >= _timeout || !waitAvailable(_timeout - elapsed)) {
+      break;
+    }
+  } while (true);
+  return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string ret;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    ret.push_back((char)c);
+    c = timedRead();
+  }
+  return String(ret);
+}
+
+String Stream::readString() {
+  std::string ret;
+  int c = timedRead();
+  while (c >= 0) {
+    ret.push_back((char)c);
+    c = timedRead();
+  }
+  return String(ret);
+}
+
+size_t HostSerial::write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HostSerial::flush() { fflush(stdout); }
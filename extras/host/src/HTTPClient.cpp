@@ -0,0 +1,486 @@
+/**
+ *
+ * HTTPClient.cpp: HTTP/1.1 client for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <HTTPClient.h>
+#include <strings.h>
+
+static std::string base64Encode(const std::string &src) {
+  static const char table[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string ret;
+  size_t i = 0;
+  for (; i + 2 < src.length(); i += 3) {
+    uint32_t n = (uint8_t)src[i] << 16 | (uint8_t)src[i + 1] << 8 |
+                 (uint8_t)src[i + 2];
+    ret.push_back(table[n >> 18 & 63]);
+    ret.push_back(table[n >> 12 & 63]);
+    ret.push_back(table[n >> 6 & 63]);
+    ret.push_back(table[n & 63]);
+  }
+  if (i < src.length()) {
+    uint32_t n = (uint8_t)src[i] << 16;
+    if (i + 1 < src.length()) {
+      n |= (uint8_t)src[i + 1] << 8;
+    }
+    ret.push_back(table[n >> 18 & 63]);
+    ret.push_back(table[n >> 12 & 63]);
+    ret.push_back(i + 1 < src.length() ? table[n >> 6 & 63] : '=');
+    ret.push_back('=');
+  }
+  return ret;
+}
+
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+  std::string u = url.c_str();
+  auto index = u.find("://");
+  if (index == std::string::npos) {
+    return false;
+  }
+  auto protocol = u.substr(0, index);
+  bool https;
+  uint16_t port;
+  if (protocol == "http") {
+    https = false;
+    port = 80;
+  } else if (protocol == "https") {
+    https = true;
+    port = 443;
+  } else {
+    return false;
+  }
+  u.erase(0, index + 3);
+  index = u.find('/');
+  auto host = u.substr(0, index);
+  std::string uri = index == std::string::npos ? "/" : u.substr(index);
+  index = host.find('@');
+  std::string auth;
+  if (index != std::string::npos) {
+    auth = base64Encode(host.substr(0, index));
+    host.erase(0, index + 1);
+  }
+  index = host.find(':');
+  if (index != std::string::npos) {
+    port = atoi(host.c_str() + index + 1);
+    host.erase(index);
+  }
+  if (!begin(client, String(host), port, String(uri), https)) {
+    return false;
+  }
+  _base64Auth = auth;
+  return true;
+}
+
+bool HTTPClient::begin(WiFiClient &client, const String &host, uint16_t port,
+                       const String &uri, bool https) {
+  if (_client != &client || _connectedHost != host.c_str() ||
+      port != _connectedPort) {
+    if (_client && _client != &client) {
+      _client->stop();
+    }
+    _canReuse = false;
+  }
+  _secure = https;
+  _host = host.c_str();
+  _port = port;
+  _uri = uri.c_str();
+  _base64Auth.clear();
+  _client = &client;
+  _headers.clear();
+  for (auto &h : _currentHeaders) {
+    h.second.clear();
+  }
+  _returnCode = 0;
+  _size = -1;
+  _chunked = false;
+  return true;
+}
+
+void HTTPClient::end() {
+  if (!_client) {
+    return;
+  }
+  if (_reuse && _canReuse && _client->connected() && _bodyPending &&
+      !_streamUsed && !_chunked && _size > 0) {
+    // drop unread body, so the next response starts at the status line
+    char buff[128];
+    int left = _size;
+    while (left > 0) {
+      size_t r = _client->readBytes(buff, std::min<int>(left, sizeof(buff)));
+      if (r == 0) {
+        break;
+      }
+      left -= r;
+    }
+    _bodyPending = left > 0;
+  }
+  if (_reuse && _canReuse && _client->connected() && !_bodyPending) {
+    _streamUsed = false;
+  } else {
+    _bodyPending = false;
+    _streamUsed = false;
+    _client->stop();
+    _canReuse = false;
+  }
+}
+
+bool HTTPClient::connected() { return _client && _client->connected(); }
+
+void HTTPClient::addHeader(const String &name, const String &value, bool first,
+                           bool replace) {
+  if (replace) {
+    size_t nameLength = name.length();
+    for (size_t i = 0; i < _headers.length();) {
+      size_t next = _headers.find("\r\n", i) + 2;
+      if (_headers.compare(i, nameLength, name.c_str()) == 0 &&
+          _headers[i + nameLength] == ':') {
+        _headers.erase(i, next - i);
+        break;
+      }
+      i = next;
+    }
+  }
+  if (first) {
+    std::string header = name.c_str();
+    header += ": ";
+    header += value.c_str();
+    header += "\r\n";
+    _headers.insert(0, header);
+  } else {
+    _headers.append(name.c_str()).append(": ").append(value.c_str());
+    _headers.append("\r\n");
+  }
+}
+
+void HTTPClient::collectHeaders(const char *headerKeys[],
+                                const size_t headerKeysCount) {
+  _currentHeaders.clear();
+  for (size_t i = 0; i < headerKeysCount; i++) {
+    _currentHeaders.emplace_back(headerKeys[i], "");
+  }
+}
+
+String HTTPClient::header(const char *name) {
+  for (auto &h : _currentHeaders) {
+    if (strcasecmp(h.first.c_str(), name) == 0) {
+      return String(h.second);
+    }
+  }
+  return String();
+}
+
+bool HTTPClient::hasHeader(const char *name) {
+  for (auto &h : _currentHeaders) {
+    if (strcasecmp(h.first.c_str(), name) == 0 && h.second.length() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int HTTPClient::GET() { return sendRequest("GET"); }
+
+int HTTPClient::POST(uint8_t *payload, size_t size) {
+  return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::POST(const String &payload) {
+  return sendRequest("POST", (const uint8_t *)payload.c_str(),
+                     payload.length());
+}
+
+bool HTTPClient::connect() {
+  if (!_client) {
+    return false;
+  }
+  if (_canReuse && _reuse && _client->connected()) {
+    return true;
+  }
+  _client->stop();
+  _client->setConnectTimeout(_connectTimeout);
+  if (!_client->connect(_host.c_str(), _port)) {
+    return false;
+  }
+  _client->setTimeout(_tcpTimeout);
+  _connectedHost = _host;
+  _connectedPort = _port;
+  return true;
+}
+
+bool HTTPClient::sendHeader(const char *type, size_t size,
+                            bool contentLength) {
+  std::string &header = _request;
+  header = type;
+  header += ' ';
+  header += _uri;
+  header += " HTTP/1.1\r\nHost: ";
+  header += _host;
+  if (_port != (_secure ? 443 : 80)) {
+    header += ':';
+    header += std::to_string(_port);
+  }
+  header += "\r\nUser-Agent: ";
+  header += _userAgent;
+  header += "\r\nConnection: ";
+  header += _reuse ? "keep-alive" : "close";
+  header += "\r\n";
+  if (_base64Auth.length()) {
+    header += "Authorization: Basic ";
+    header += _base64Auth;
+    header += "\r\n";
+  }
+  if (contentLength && (size > 0 || strcmp(type, "POST") == 0 ||
+                        strcmp(type, "PUT") == 0)) {
+    header += "Content-Length: ";
+    header += std::to_string(size);
+    header += "\r\n";
+  }
+  header += _headers;
+  header += "\r\n";
+  return _client->write((const uint8_t *)header.data(), header.length()) ==
+         header.length();
+}
+
+int HTTPClient::returnError(int error) {
+  if (error < 0 && _client) {
+    _client->stop();
+    _canReuse = false;
+  }
+  _returnCode = error;
+  return error;
+}
+
+int HTTPClient::sendRequest(const char *type, const uint8_t *payload,
+                            size_t size) {
+  if (!connect()) {
+    return returnError(HTTPC_ERROR_CONNECTION_REFUSED);
+  }
+  if (!sendHeader(type, payload ? size : 0)) {
+    return returnError(HTTPC_ERROR_SEND_HEADER_FAILED);
+  }
+  if (payload && size > 0 && _client->write(payload, size) != size) {
+    return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+  }
+  return returnError(handleHeaderResponse());
+}
+
+int HTTPClient::sendRequest(const char *type, Stream *stream, size_t size) {
+  if (!stream) {
+    return returnError(HTTPC_ERROR_NO_STREAM);
+  }
+  if (!connect()) {
+    return returnError(HTTPC_ERROR_CONNECTION_REFUSED);
+  }
+  if (!sendHeader(type, size, size > 0)) {
+    return returnError(HTTPC_ERROR_SEND_HEADER_FAILED);
+  }
+  uint8_t buff[1460];
+  if (size == 0) {
+    int available;
+    while ((available = stream->available()) >= 0) {
+      if (available == 0) {
+        delay(1);
+        continue;
+      }
+      size_t r = stream->readBytes(
+          buff, std::min<size_t>(sizeof(buff), (size_t)available));
+      if (_client->write(buff, r) != r) {
+        return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+      }
+    }
+    return returnError(handleHeaderResponse());
+  }
+  size_t sent = 0;
+  while (sent < size) {
+    size_t toRead = std::min(sizeof(buff), size - sent);
+    size_t r = stream->readBytes(buff, toRead);
+    if (r == 0) {
+      return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    }
+    if (_client->write(buff, r) != r) {
+      return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    }
+    sent += r;
+  }
+  return returnError(handleHeaderResponse());
+}
+
+bool HTTPClient::readLine(std::string &line) {
+  line.clear();
+  auto start = millis();
+  while (millis() - start < _tcpTimeout) {
+    int c = _client->read();
+    if (c < 0) {
+      if (!_client->connected()) {
+        return false;
+      }
+      uint8_t b;
+      // timed read waits for data
+      if (_client->readBytes(&b, 1) != 1) {
+        continue;
+      }
+      c = b;
+    }
+    if (c == '\n') {
+      if (line.length() && line.back() == '\r') {
+        line.pop_back();
+      }
+      return true;
+    }
+    line.push_back((char)c);
+  }
+  return false;
+}
+
+int HTTPClient::handleHeaderResponse() {
+  std::string &line = _line;
+  int code = 0;
+  _size = -1;
+  _chunked = false;
+  _canReuse = _reuse;
+  while (true) {
+    if (!readLine(line)) {
+      return _client->connected() ? HTTPC_ERROR_READ_TIMEOUT
+                                  : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    if (code == 0) {
+      if (line.compare(0, 5, "HTTP/") != 0) {
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+      }
+      auto sp = line.find(' ');
+      code = sp == std::string::npos ? 0 : atoi(line.c_str() + sp + 1);
+      if (code <= 0) {
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+      }
+      continue;
+    }
+    if (line.empty()) {
+      if (code == 100) {
+        code = 0;
+        continue;
+      }
+      break;
+    }
+    auto colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    // split in place, name is terminated by the colon
+    line[colon] = 0;
+    const char *name = line.c_str();
+    const char *value = name + colon + 1;
+    while (*value == ' ') {
+      value++;
+    }
+    if (strcasecmp(name, "Content-Length") == 0) {
+      _size = atoi(value);
+    } else if (strcasecmp(name, "Connection") == 0) {
+      _canReuse = _reuse && strcasecmp(value, "close") != 0;
+    } else if (strcasecmp(name, "Transfer-Encoding") == 0) {
+      _chunked = strcasecmp(value, "chunked") == 0;
+    }
+    for (auto &h : _currentHeaders) {
+      if (strcasecmp(h.first.c_str(), name) == 0) {
+        h.second = value;
+      }
+    }
+  }
+  if (_size < 0 && !_chunked && code != 204 && code != 304) {
+    // body is terminated by closing connection
+    _canReuse = false;
+  }
+  if (code == 204 || code == 304) {
+    _size = 0;
+  }
+  _bodyPending = _size != 0;
+  _streamUsed = false;
+  return code;
+}
+
+String HTTPClient::getString() {
+  std::string body;
+  if (!_client) {
+    return String();
+  }
+  if (_chunked) {
+    std::string line;
+    while (readLine(line)) {
+      int len = (int)strtol(line.c_str(), nullptr, 16);
+      if (len <= 0) {
+        readLine(line);
+        break;
+      }
+      size_t start = body.length();
+      body.resize(start + len);
+      if (_client->readBytes(&body[start], len) != (size_t)len) {
+        body.resize(start);
+        break;
+      }
+      readLine(line);
+    }
+  } else if (_size > 0) {
+    body.resize(_size);
+    body.resize(_client->readBytes(&body[0], _size));
+    _bodyPending = (int)body.length() < _size;
+    return String(body);
+  } else if (_size < 0) {
+    char buff[512];
+    size_t r;
+    while ((r = _client->readBytes(buff, sizeof(buff))) > 0) {
+      body.append(buff, r);
+    }
+  }
+  _bodyPending = _size < 0 && !_chunked;
+  return String(body);
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+      return F("connection refused");
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+      return F("send header failed");
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+      return F("send payload failed");
+    case HTTPC_ERROR_NOT_CONNECTED:
+      return F("not connected");
+    case HTTPC_ERROR_CONNECTION_LOST:
+      return F("connection lost");
+    case HTTPC_ERROR_NO_STREAM:
+      return F("no stream");
+    case HTTPC_ERROR_NO_HTTP_SERVER:
+      return F("no HTTP server");
+    case HTTPC_ERROR_TOO_LESS_RAM:
+      return F("too less ram");
+    case HTTPC_ERROR_ENCODING:
+      return F("Transfer-Encoding not supported");
+    case HTTPC_ERROR_STREAM_WRITE:
+      return F("Stream write error");
+    case HTTPC_ERROR_READ_TIMEOUT:
+      return F("read Timeout");
+    default:
+      return String();
+  }
+}
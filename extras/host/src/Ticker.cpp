@@ -0,0 +1,61 @@
+/**
+ *
+ * Ticker.cpp: Periodic timer for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <Ticker.h>
+
+#include <chrono>
+
+void Ticker::attach_ms(uint32_t milliseconds, callback_function_t callback) {
+  detach();
+  _stop = false;
+  _thread = std::thread([this, milliseconds, callback]() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto next = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(milliseconds);
+    while (!_cond.wait_until(lock, next, [this] { return _stop; })) {
+      lock.unlock();
+      callback();
+      lock.lock();
+      next += std::chrono::milliseconds(milliseconds);
+    }
+  });
+}
+
+void Ticker::detach() {
+  if (!_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cond.notify_all();
+  if (_thread.get_id() == std::this_thread::get_id()) {
+    _thread.detach();
+  } else {
+    _thread.join();
+  }
+}
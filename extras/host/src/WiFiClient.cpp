@@ -0,0 +1,221 @@
+/**
+ *
+ * WiFiClient.cpp: TCP client over POSIX sockets for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <WiFiClient.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClient::~WiFiClient() { stop(); }
+
+static int connectAddr(const struct addrinfo *ai, int32_t timeoutMs) {
+  int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+  if (fd < 0) {
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+    if (errno != EINPROGRESS) {
+      close(fd);
+      return -1;
+    }
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (poll(&pfd, 1, timeoutMs) <= 0 ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+  return connect(host, port, _connectTimeout);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+  stop();
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *res = nullptr;
+  char portStr[6];
+  snprintf(portStr, sizeof(portStr), "%u", port);
+  if (getaddrinfo(host, portStr, &hints, &res) != 0) {
+    return 0;
+  }
+  for (auto ai = res; ai && _fd < 0; ai = ai->ai_next) {
+    _fd = connectAddr(ai, timeoutMs);
+  }
+  freeaddrinfo(res);
+  if (_fd < 0) {
+    return 0;
+  }
+  setNoDelay(true);
+  _eof = false;
+  _rxPos = _rxLen = 0;
+  if (!afterConnect(host)) {
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+  if (_fd >= 0) {
+    int flag = noDelay;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+}
+
+ssize_t WiFiClient::rawSend(const uint8_t *buf, size_t size) {
+  return ::send(_fd, buf, size, MSG_NOSIGNAL);
+}
+
+ssize_t WiFiClient::rawRecv(uint8_t *buf, size_t size) {
+  return ::recv(_fd, buf, size, 0);
+}
+
+bool WiFiClient::waitSocket(short events, int timeoutMs) {
+  struct pollfd pfd = {_fd, events, 0};
+  int r;
+  do {
+    r = poll(&pfd, 1, timeoutMs);
+  } while (r < 0 && errno == EINTR);
+  return r > 0;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+  size_t sent = 0;
+  while (_fd >= 0 && sent < size) {
+    auto r = rawSend(buf + sent, size - sent);
+    if (r > 0) {
+      sent += r;
+    } else if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!waitSocket(POLLOUT, _timeout)) {
+        break;
+      }
+    } else if (r < 0 && errno == EINTR) {
+      continue;
+    } else {
+      stop();
+      break;
+    }
+  }
+  return sent;
+}
+
+int WiFiClient::fill() {
+  if (_rxPos < _rxLen) {
+    return _rxLen - _rxPos;
+  }
+  if (_fd < 0 || _eof) {
+    return -1;
+  }
+  _rxPos = _rxLen = 0;
+  auto r = rawRecv(_rx, sizeof(_rx));
+  if (r > 0) {
+    _rxLen = r;
+    return r;
+  }
+  if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return 0;
+  }
+  _eof = true;
+  return -1;
+}
+
+int WiFiClient::available() {
+  int n = fill();
+  if (n <= 0) {
+    return 0;
+  }
+  return n + rawPending();
+}
+
+int WiFiClient::read() {
+  if (fill() <= 0) {
+    return -1;
+  }
+  return _rx[_rxPos++];
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+  if (fill() <= 0) {
+    return -1;
+  }
+  size_t n = std::min(size, _rxLen - _rxPos);
+  memcpy(buf, _rx + _rxPos, n);
+  _rxPos += n;
+  return n;
+}
+
+int WiFiClient::peek() {
+  if (fill() <= 0) {
+    return -1;
+  }
+  return _rx[_rxPos];
+}
+
+bool WiFiClient::waitAvailable(unsigned long timeoutMs) {
+  auto start = millis();
+  while (true) {
+    int n = fill();
+    if (n != 0) {
+      return n > 0;
+    }
+    auto elapsed = millis() - start;
+    if (elapsed >= timeoutMs || !waitSocket(POLLIN, timeoutMs - elapsed)) {
+      return fill() > 0;
+    }
+  }
+}
+
+void WiFiClient::stop() {
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+  _rxPos = _rxLen = 0;
+  _eof = false;
+}
+
+uint8_t WiFiClient::connected() {
+  if (_rxPos < _rxLen) {
+    return 1;
+  }
+  if (_fd < 0) {
+    return 0;
+  }
+  return fill() >= 0;
+}
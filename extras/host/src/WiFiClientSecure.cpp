@@ -0,0 +1,194 @@
+/**
+ *
+ * WiFiClientSecure.cpp: TLS client for host (Linux) builds
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <WiFiClientSecure.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+
+#ifdef INFLUXDB_CLIENT_HOST_TLS
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+WiFiClientSecure::~WiFiClientSecure() { stop(); }
+
+void TLSSession::clear() {
+  _length = 0;
+  memset(_data, 0, sizeof(_data));
+}
+
+#ifdef INFLUXDB_CLIENT_HOST_TLS
+
+// Maps OpenSSL result to the socket convention used by WiFiClient
+static ssize_t sslResult(SSL *ssl, int r) {
+  if (r > 0) {
+    return r;
+  }
+  switch (SSL_get_error(ssl, r)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      errno = EAGAIN;
+      return -1;
+    case SSL_ERROR_ZERO_RETURN:
+      return 0;
+    default:
+      errno = EIO;
+      return -1;
+  }
+}
+
+int WiFiClientSecure::newSession(SSL *ssl, SSL_SESSION *session) {
+  auto client = static_cast<WiFiClientSecure *>(SSL_get_app_data(ssl));
+  TLSSession *stored = client->_session;
+  if (!stored || !SSL_SESSION_is_resumable(session)) {
+    return 0;
+  }
+  int length = i2d_SSL_SESSION(session, nullptr);
+  if (length <= 0 || length > (int)sizeof(stored->_data)) {
+    return 0;
+  }
+  stored->clear();
+  unsigned char *data = stored->_data;
+  i2d_SSL_SESSION(session, &data);
+  stored->_length = length;
+  // session is not kept
+  return 0;
+}
+
+bool WiFiClientSecure::isSessionReused() const {
+  return _ssl && SSL_session_reused(_ssl);
+}
+
+bool WiFiClientSecure::afterConnect(const char *host) {
+  if (!_ctx) {
+    _ctx = SSL_CTX_new(TLS_client_method());
+    if (!_ctx) {
+      return false;
+    }
+    // sessions are kept by TLSSession, which outlives the context
+    SSL_CTX_set_session_cache_mode(
+        _ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(_ctx, newSession);
+    if (_insecure) {
+      SSL_CTX_set_verify(_ctx, SSL_VERIFY_NONE, nullptr);
+    } else {
+      SSL_CTX_set_verify(_ctx, SSL_VERIFY_PEER, nullptr);
+      if (_caCert.length()) {
+        BIO *bio = BIO_new_mem_buf(_caCert.c_str(), _caCert.length());
+        X509 *cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+        if (cert) {
+          X509_STORE_add_cert(SSL_CTX_get_cert_store(_ctx), cert);
+          X509_free(cert);
+        }
+        BIO_free(bio);
+      } else {
+        SSL_CTX_set_default_verify_paths(_ctx);
+      }
+    }
+  }
+  _ssl = SSL_new(_ctx);
+  if (!_ssl) {
+    return false;
+  }
+  SSL_set_fd(_ssl, _fd);
+  SSL_set_app_data(_ssl, this);
+  SSL_set_tlsext_host_name(_ssl, host);
+  if (!_insecure) {
+    SSL_set1_host(_ssl, host);
+  }
+  if (_session && !_session->isEmpty()) {
+    const unsigned char *data = _session->_data;
+    SSL_SESSION *session = d2i_SSL_SESSION(nullptr, &data, _session->_length);
+    if (session) {
+      SSL_set_session(_ssl, session);
+      SSL_SESSION_free(session);
+    }
+  }
+  auto start = millis();
+  while (true) {
+    int r = SSL_connect(_ssl);
+    if (r == 1) {
+      return true;
+    }
+    int err = SSL_get_error(_ssl, r);
+    int32_t left = _connectTimeout - (int32_t)(millis() - start);
+    if (left <= 0 ||
+        (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) ||
+        !waitSocket(err == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT, left)) {
+      return false;
+    }
+  }
+}
+
+ssize_t WiFiClientSecure::rawSend(const uint8_t *buf, size_t size) {
+  return sslResult(_ssl, SSL_write(_ssl, buf, size));
+}
+
+ssize_t WiFiClientSecure::rawRecv(uint8_t *buf, size_t size) {
+  return sslResult(_ssl, SSL_read(_ssl, buf, size));
+}
+
+size_t WiFiClientSecure::rawPending() { return _ssl ? SSL_pending(_ssl) : 0; }
+
+void WiFiClientSecure::stop() {
+  if (_ssl) {
+    SSL_shutdown(_ssl);
+    SSL_free(_ssl);
+    _ssl = nullptr;
+  }
+  WiFiClient::stop();
+  if (_ctx) {
+    SSL_CTX_free(_ctx);
+    _ctx = nullptr;
+  }
+}
+
+#else  // INFLUXDB_CLIENT_HOST_TLS
+
+int WiFiClientSecure::newSession(SSL *, SSL_SESSION *) { return 0; }
+
+bool WiFiClientSecure::isSessionReused() const { return false; }
+
+bool WiFiClientSecure::afterConnect(const char *) { return false; }
+
+ssize_t WiFiClientSecure::rawSend(const uint8_t *, size_t) {
+  errno = ENOTSUP;
+  return -1;
+}
+
+ssize_t WiFiClientSecure::rawRecv(uint8_t *, size_t) {
+  errno = ENOTSUP;
+  return -1;
+}
+
+size_t WiFiClientSecure::rawPending() { return 0; }
+
+void WiFiClientSecure::stop() { WiFiClient::stop(); }
+
+#endif  // INFLUXDB_CLIENT_HOST_TLS
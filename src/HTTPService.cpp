@@ -4,20 +4,23 @@
 #include "Platform.h"
 #include "Version.h"
 #include "util/debug.h"
+#include "util/helpers.h"
 
 static const char UserAgent[] PROGMEM =
     "influxdb-client-arduino/" INFLUXDB_CLIENT_VERSION
     " (" INFLUXDB_CLIENT_PLATFORM " " INFLUXDB_CLIENT_PLATFORM_VERSION ")";
 
 #if defined(ESP8266)
-bool checkMFLN(BearSSL::WiFiClientSecure *client, std::string url);
+bool checkMFLN(BearSSL::WiFiClientSecure *client, std::string url,
+               TLSState &state);
 #endif
 
 // This cannot be put to PROGMEM due to the way how it is used
 static const char *RetryAfter = "Retry-After";
 const char *TransferEncoding = "Transfer-Encoding";
 
-HTTPService::HTTPService(ConnectionInfo *pConnInfo) : _pConnInfo(pConnInfo) {
+HTTPService::HTTPService(ConnectionInfo *pConnInfo)
+    : _pConnInfo(pConnInfo), _lease(std::make_shared<bool>(true)) {
   _apiURL = pConnInfo->serverUrl;
   _apiURL += "/api/v2/";
   auto https{pConnInfo->serverUrl.find("https") != std::string::npos};
@@ -35,8 +38,9 @@ HTTPService::HTTPService(ConnectionInfo *pConnInfo) : _pConnInfo(pConnInfo) {
         wifiClientSec->setFingerprint(pConnInfo->certInfo);
       }
     }
-    checkMFLN(wifiClientSec, pConnInfo->serverUrl);
-#elif defined(ESP32)
+    // probing connects, so it is postponed to the first request
+    _checkMFLN = true;
+#elif defined(ESP32) || defined(INFLUXDB_CLIENT_HOST)
     WiFiClientSecure *wifiClientSec = new WiFiClientSecure;
     if (pConnInfo->insecure) {
 #ifndef ARDUINO_ESP32_RELEASE_1_0_4
@@ -46,6 +50,13 @@ HTTPService::HTTPService(ConnectionInfo *pConnInfo) : _pConnInfo(pConnInfo) {
     } else if (pConnInfo->certInfo && strlen_P(pConnInfo->certInfo) > 0) {
       wifiClientSec->setCACert(pConnInfo->certInfo);
     }
+#endif
+    if (!pConnInfo->tlsState.belongsTo(pConnInfo->serverUrl)) {
+      pConnInfo->tlsState.bind(pConnInfo->serverUrl);
+    }
+#ifdef INFLUXDB_CLIENT_TLS_SESSION
+    // connections to server share the session
+    wifiClientSec->setSession(&pConnInfo->tlsState.session);
 #endif
     _wifiClient.reset(wifiClientSec);
   } else {
@@ -57,9 +68,102 @@ HTTPService::HTTPService(ConnectionInfo *pConnInfo) : _pConnInfo(pConnInfo) {
   _httpClient->setReuse(_httpOptions._connectionReuse);
 
   _httpClient->setUserAgent(FPSTR(UserAgent));
+  if (pConnInfo->authToken.length() > 0) {
+    _authorization = "Token ";
+    _authorization += pConnInfo->authToken.c_str();
+  }
+  parseServerUrl();
 };
 
-HTTPService::~HTTPService() {}
+void HTTPService::parseServerUrl() {
+  const std::string &url = _pConnInfo->serverUrl;
+  auto index = url.find("://");
+  if (index == std::string::npos) {
+    return;
+  }
+  auto hostStart = index + 3;
+  auto pathStart = url.find('/', hostStart);
+  if (pathStart == std::string::npos) {
+    pathStart = url.length();
+  }
+  std::string host = url.substr(hostStart, pathStart - hostStart);
+  // user info and IPv6 addresses are left to HTTPClient
+  if (host.find('@') != std::string::npos ||
+      host.find('[') != std::string::npos) {
+    return;
+  }
+  _https = url.compare(0, index, "https") == 0;
+  _port = _https ? 443 : 80;
+  index = host.find(':');
+  if (index != std::string::npos) {
+    _port = atoi(host.c_str() + index + 1);
+    host.erase(index);
+  }
+  _host = host.c_str();
+  _basePath = url.c_str() + pathStart;
+  _baseLength = url.length();
+}
+
+static uint32_t serverId(const std::string &serverUrl) {
+  // URL is used with and without trailing slash
+  size_t length = serverUrl.length();
+  if (length && serverUrl[length - 1] == '/') {
+    length--;
+  }
+  uint32_t crc = updateCrc32(0, (const uint8_t *)serverUrl.data(), length);
+  // 0 marks unbound state
+  return crc ? crc : 1;
+}
+
+// CRC of state without checksum
+static uint32_t stateCrc(const TLSState &state) {
+  uint32_t crc =
+      updateCrc32(0, (const uint8_t *)&state.serverId, sizeof(state.serverId));
+  const uint8_t *rest = (const uint8_t *)&state.mfln;
+  return updateCrc32(crc, rest, (const uint8_t *)(&state + 1) - rest);
+}
+
+void TLSState::bind(const std::string &serverUrl) {
+  *this = TLSState();
+  serverId = ::serverId(serverUrl);
+}
+
+bool TLSState::belongsTo(const std::string &serverUrl) const {
+  return serverId == ::serverId(serverUrl);
+}
+
+void TLSState::seal() { checksum = stateCrc(*this); }
+
+bool TLSState::isValid() const {
+  return serverId != 0 && checksum == stateCrc(*this);
+}
+
+void HTTPService::beforeConnect() {
+#if defined(ESP8266)
+  if (_checkMFLN) {
+    _checkMFLN = false;
+    checkMFLN(static_cast<BearSSL::WiFiClientSecure *>(_wifiClient.get()),
+              _pConnInfo->serverUrl, _pConnInfo->tlsState);
+  }
+#endif
+}
+
+bool HTTPService::closeIdle() {
+  const uint32_t timeout = _httpOptions._connectionIdleTimeout;
+  if (!timeout || !isIdle() || millis() - _lastUseTime < timeout) {
+    return false;
+  }
+  if (_wifiClient->connected()) {
+    INFLUXDB_CLIENT_DEBUG("[D] Closing idle connection\n");
+    _wifiClient->stop();
+  }
+  return true;
+}
+
+HTTPService::~HTTPService() {
+  // HTTPClient stops connection on deletion, so it must go first
+  _httpClient.reset();
+}
 
 void HTTPService::setHTTPOptions(const HTTPOptions &httpOptions) {
   _httpOptions = httpOptions;
@@ -68,14 +172,24 @@ void HTTPService::setHTTPOptions(const HTTPOptions &httpOptions) {
   }
   _httpClient->setReuse(_httpOptions._connectionReuse);
   _httpClient->setTimeout(_httpOptions._httpReadTimeout);
-#if defined(ESP32)
+#if defined(ESP32) || defined(INFLUXDB_CLIENT_HOST)
   _httpClient->setConnectTimeout(_httpOptions._httpReadTimeout);
 #endif
 }
 
-// parse URL for host and port and call probeMaxFragmentLength
+// parse URL for host and port and call probeMaxFragmentLength, unless the
+// result is already known
 #if defined(ESP8266)
-bool checkMFLN(BearSSL::WiFiClientSecure *client, std::string url) {
+bool checkMFLN(BearSSL::WiFiClientSecure *client, std::string url,
+               TLSState &state) {
+  if (state.mfln != TLSState::MflnUnknown) {
+    const bool mfln = state.mfln == TLSState::MflnSupported;
+    INFLUXDB_CLIENT_DEBUG("[D] Cached MFLN:%s\n", mfln ? "yes" : "no");
+    if (mfln) {
+      client->setBufferSizes(1024, 1024);
+    }
+    return mfln;
+  }
   auto index = url.find(':');
   if (index == std::string::npos) {
     return false;
@@ -113,6 +227,7 @@ bool checkMFLN(BearSSL::WiFiClientSecure *client, std::string url) {
                         port);
   bool mfln = client->probeMaxFragmentLength(host.c_str(), port, 1024);
   INFLUXDB_CLIENT_DEBUG("[D]  MFLN:%s\n", mfln ? "yes" : "no");
+  state.mfln = mfln ? TLSState::MflnSupported : TLSState::MflnUnsupported;
   if (mfln) {
     client->setBufferSizes(1024, 1024);
   }
@@ -121,37 +236,56 @@ bool checkMFLN(BearSSL::WiFiClientSecure *client, std::string url) {
 #endif  // ESP8266
 
 bool HTTPService::beforeRequest(const char *url) {
-  if (!_httpClient->begin(*_wifiClient, url)) {
+  // asynchronous request uses the same connection, let it complete
+  while (_request && poll()) {
+    yield();
+  }
+  beforeConnect();
+  bool begun;
+  if (_baseLength &&
+      strncmp(url, _pConnInfo->serverUrl.c_str(), _baseLength) == 0) {
+    // URL of server API, host and port are already known
+    _uri = _basePath;
+    _uri += url + _baseLength;
+    begun = _httpClient->begin(*_wifiClient, _host, _port, _uri, _https);
+  } else {
+    begun = _httpClient->begin(*_wifiClient, url);
+  }
+  if (!begun) {
     _pConnInfo->lastError = "begin failed";
     return false;
   }
-  if (_pConnInfo->authToken.length() > 0) {
-    _httpClient->addHeader(F("Authorization"),
-                           "Token " + String(_pConnInfo->authToken.c_str()));
+  if (_authorization.length() > 0) {
+    _httpClient->addHeader(F("Authorization"), _authorization);
+  }
+  if (_collectHeaders) {
+    const char *headerKeys[] = {RetryAfter, TransferEncoding};
+    _httpClient->collectHeaders(headerKeys, 2);
+    _collectHeaders = false;
   }
-  const char *headerKeys[] = {RetryAfter, TransferEncoding};
-  _httpClient->collectHeaders(headerKeys, 2);
   return true;
 }
 
 bool HTTPService::doPOST(const char *url, const char *data,
                          const char *contentType, int expectedCode,
                          httpResponseCallback cb) {
+  size_t length = strlen(data);
   INFLUXDB_CLIENT_DEBUG("[D] POST request - %s, data: %d bytes, type %s\n", url,
-                        strlen(data), contentType);
+                        length, contentType);
   if (!beforeRequest(url)) {
     return false;
   }
   if (contentType) {
     _httpClient->addHeader(F("Content-Type"), FPSTR(contentType));
   }
-  _lastStatusCode = _httpClient->POST((uint8_t *)data, strlen(data));
+  _lastStatusCode = _httpClient->POST((uint8_t *)data, length);
   return afterRequest(expectedCode, cb);
 }
 
 bool HTTPService::doPOST(const char *url, Stream *stream,
                          const char *contentType, int expectedCode,
-                         httpResponseCallback cb) {
+                         httpResponseCallback cb,
+                         const char *contentEncoding) {
   INFLUXDB_CLIENT_DEBUG("[D] POST request - %s, data: %d bytes, type %s\n", url,
                         stream->available(), contentType);
   if (!beforeRequest(url)) {
@@ -160,11 +294,105 @@ bool HTTPService::doPOST(const char *url, Stream *stream,
   if (contentType) {
     _httpClient->addHeader(F("Content-Type"), FPSTR(contentType));
   }
+  if (contentEncoding) {
+    _httpClient->addHeader(F("Content-Encoding"), FPSTR(contentEncoding));
+  }
   _lastStatusCode =
       _httpClient->sendRequest("POST", stream, stream->available());
   return afterRequest(expectedCode, cb);
 }
 
+// Frames data pulled from producer as chunks of chunked transfer encoding.
+// HTTPClient sends stream of unknown size until available() returns -1
+class ChunkedStream : public Stream {
+ public:
+  ChunkedStream(httpBodyProducer &producer) : _producer(producer) {}
+  virtual int available() override {
+    if (_pos == _end && !_last) {
+      next();
+    }
+    return _pos < _end ? _end - _pos : -1;
+  }
+  virtual int read() override {
+    int c = peek();
+    if (c >= 0) {
+      _pos++;
+    }
+    return c;
+  }
+  virtual size_t readBytes(char *buffer, size_t len) override {
+    size_t read = 0;
+    while (read < len && available() > 0) {
+      size_t n = std::min<size_t>(len - read, _end - _pos);
+      memcpy(buffer + read, _buffer + _pos, n);
+      _pos += n;
+      read += n;
+    }
+    return read;
+  }
+  virtual int peek() override {
+    return available() > 0 ? _buffer[_pos] : -1;
+  }
+  virtual void flush() override{};
+  virtual size_t write(uint8_t) override { return 0; }
+
+ private:
+  // Data of chunk, fits one TCP segment with its size line
+  static const size_t ChunkSize = 1024;
+  // Size line in hex, at most 3 digits, is written just before data
+  static const size_t SizeLine = 5;
+  // Pulls next chunk, terminated by the last chunk of zero size
+  void next() {
+    size_t size = _producer(_buffer + SizeLine, ChunkSize);
+    _end = SizeLine + size;
+    if (size == 0) {
+      _last = true;
+    } else {
+      _buffer[_end++] = '\r';
+      _buffer[_end++] = '\n';
+    }
+    _pos = SizeLine - 2;
+    _buffer[SizeLine - 2] = '\r';
+    _buffer[SizeLine - 1] = '\n';
+    do {
+      _buffer[--_pos] = "0123456789abcdef"[size & 15];
+      size >>= 4;
+    } while (size > 0);
+    if (_last) {
+      _buffer[_end++] = '\r';
+      _buffer[_end++] = '\n';
+    }
+  }
+  httpBodyProducer &_producer;
+  uint8_t _buffer[SizeLine + ChunkSize + 2];
+  size_t _pos = 0;
+  size_t _end = 0;
+  bool _last = false;
+};
+
+#ifdef INFLUXDB_CLIENT_CHUNKED_POST
+bool HTTPService::doPOST(const char *url, httpBodyProducer producer,
+                         const char *contentType, int expectedCode,
+                         httpResponseCallback cb,
+                         const char *contentEncoding) {
+  INFLUXDB_CLIENT_DEBUG("[D] POST request - %s, data: chunked, type %s\n", url,
+                        contentType);
+  if (!beforeRequest(url)) {
+    return false;
+  }
+  if (contentType) {
+    _httpClient->addHeader(F("Content-Type"), FPSTR(contentType));
+  }
+  if (contentEncoding) {
+    _httpClient->addHeader(F("Content-Encoding"), FPSTR(contentEncoding));
+  }
+  _httpClient->addHeader(TransferEncoding, F("chunked"));
+  ChunkedStream stream(producer);
+  _lastStatusCode = _httpClient->sendRequest("POST", &stream, 0);
+  return afterRequest(expectedCode, cb);
+}
+#endif  // INFLUXDB_CLIENT_CHUNKED_POST
+
 bool HTTPService::doGET(const char *url, int expectedCode,
                         httpResponseCallback cb) {
   INFLUXDB_CLIENT_DEBUG("[D] GET request - %s\n", url);
@@ -187,6 +415,10 @@ bool HTTPService::doDELETE(const char *url, int expectedCode,
 
 bool HTTPService::afterRequest(int expectedStatusCode, httpResponseCallback cb,
                                bool modifyLastConnStatus) {
+  // HTTPClient keeps collected values between requests (ESP cores even append
+  // new ones), so headers are registered again only when some were received
+  _collectHeaders = _httpClient->hasHeader(RetryAfter) ||
+                    _httpClient->hasHeader(TransferEncoding);
   if (modifyLastConnStatus) {
     _lastRequestTime = millis();
     INFLUXDB_CLIENT_DEBUG("[D] HTTP status code - %d\n", _lastStatusCode);
@@ -217,5 +449,342 @@ bool HTTPService::afterRequest(int expectedStatusCode, httpResponseCallback cb,
   if (endConnection) {
     _httpClient->end();
   }
+  _lastUseTime = millis();
   return ret;
-}
\ No newline at end of file
+}
+HTTPRequest::HTTPRequest() {}
+
+HTTPRequest::~HTTPRequest() {}
+
+std::shared_ptr<HTTPRequest> HTTPService::prepareRequest(
+    const char *url, const char *contentType, int expectedCode,
+    httpRequestCallback cb, const char *contentEncoding, bool streamResponse) {
+  if (_request) {
+    _pConnInfo->lastError = "Request in progress";
+    return nullptr;
+  }
+  if (!_baseLength ||
+      strncmp(url, _pConnInfo->serverUrl.c_str(), _baseLength) != 0) {
+    _pConnInfo->lastError = "Unsupported URL";
+    return nullptr;
+  }
+  std::shared_ptr<HTTPRequest> request(new HTTPRequest);
+  request->_expectedCode = expectedCode;
+  request->_callback = cb;
+  request->_streamResponse = streamResponse;
+  request->_client = _wifiClient.get();
+  std::string &head = request->_out;
+  head.reserve(256);
+  head = "POST ";
+  head += _basePath.c_str();
+  head += url + _baseLength;
+  head += " HTTP/1.1\r\nHost: ";
+  head += _host.c_str();
+  if (_port != (_https ? 443 : 80)) {
+    head += ':';
+    head += std::to_string(_port);
+  }
+  head += "\r\nUser-Agent: ";
+  head += String(FPSTR(UserAgent)).c_str();
+  head += "\r\nConnection: ";
+  head += _httpOptions._connectionReuse ? "keep-alive" : "close";
+  head += "\r\n";
+  if (_authorization.length() > 0) {
+    head += "Authorization: ";
+    head += _authorization.c_str();
+    head += "\r\n";
+  }
+  if (contentType) {
+    head += "Content-Type: ";
+    head += String(FPSTR(contentType)).c_str();
+    head += "\r\n";
+  }
+  if (contentEncoding) {
+    head += "Content-Encoding: ";
+    head += String(FPSTR(contentEncoding)).c_str();
+    head += "\r\n";
+  }
+  request->_lastActivity = millis();
+  return request;
+}
+
+std::shared_ptr<HTTPRequest> HTTPService::beginPOST(const char *url,
+                                                    const char *data,
+                                                    const char *contentType,
+                                                    int expectedCode,
+                                                    httpRequestCallback cb,
+                                                    bool streamResponse) {
+  INFLUXDB_CLIENT_DEBUG("[D] Async POST request - %s, type %s\n", url,
+                        contentType);
+  auto request = prepareRequest(url, contentType, expectedCode, cb, nullptr,
+                                streamResponse);
+  if (request) {
+    size_t length = strlen(data);
+    request->_out += "Content-Length: ";
+    request->_out += std::to_string(length);
+    request->_out += "\r\n\r\n";
+    request->_out.append(data, length);
+    _request = request;
+  }
+  return request;
+}
+
+std::shared_ptr<HTTPRequest> HTTPService::beginPOST(
+    const char *url, httpBodyProducer producer, const char *contentType,
+    int expectedCode, httpRequestCallback cb, const char *contentEncoding) {
+  INFLUXDB_CLIENT_DEBUG("[D] Async POST request - %s, data: chunked, type %s\n",
+                        url, contentType);
+  auto request = prepareRequest(url, contentType, expectedCode, cb,
+                                contentEncoding, false);
+  if (request) {
+    request->_out += "Transfer-Encoding: chunked\r\n\r\n";
+    request->_producer = producer;
+    request->_chunks.reset(new ChunkedStream(request->_producer));
+    _request = request;
+  }
+  return request;
+}
+
+bool HTTPService::poll() {
+  if (!_request) {
+    return false;
+  }
+  // keep request alive while its callback runs
+  std::shared_ptr<HTTPRequest> request = _request;
+  bool progress = false;
+  switch (request->_state) {
+    case HTTPRequest::State::Connecting:
+      progress = connect(*request);
+      break;
+    case HTTPRequest::State::Sending:
+      progress = send(*request);
+      break;
+    case HTTPRequest::State::ReceivingHeaders:
+      progress = receiveHeaders(*request);
+      break;
+    case HTTPRequest::State::ReceivingBody:
+      progress = receiveBody(*request);
+      break;
+    case HTTPRequest::State::Done:
+      break;
+  }
+  if (request->_state == HTTPRequest::State::Done) {
+    return _request != nullptr;
+  }
+  if (progress) {
+    request->_lastActivity = millis();
+  } else if (request->_state != HTTPRequest::State::Sending) {
+    if (!_wifiClient->connected() && _wifiClient->available() <= 0) {
+      finish(*request, HTTPC_ERROR_CONNECTION_LOST);
+    } else if (millis() - request->_lastActivity >
+               (uint32_t)_httpOptions._httpReadTimeout) {
+      finish(*request, HTTPC_ERROR_READ_TIMEOUT);
+    }
+  }
+  return _request != nullptr;
+}
+
+bool HTTPService::connect(HTTPRequest &request) {
+  if (_httpOptions._connectionReuse && _wifiClient->connected()) {
+    // drop leftovers of previous response on kept-alive connection
+    while (_wifiClient->available() > 0) {
+      _wifiClient->read();
+    }
+  } else {
+    _wifiClient->stop();
+    beforeConnect();
+    if (!_wifiClient->connect(_host.c_str(), _port)) {
+      finish(request, HTTPC_ERROR_CONNECTION_REFUSED);
+      return false;
+    }
+  }
+  request._state = HTTPRequest::State::Sending;
+  return true;
+}
+
+bool HTTPService::send(HTTPRequest &request) {
+  // at most one TCP segment per call, so writing does not wait
+  uint8_t buff[1024];
+  const uint8_t *data = buff;
+  size_t size;
+  if (request._sent < request._out.length()) {
+    data = (const uint8_t *)request._out.data() + request._sent;
+    size = std::min(sizeof(buff), request._out.length() - request._sent);
+  } else if (request._chunks && request._chunks->available() >= 0) {
+    size = request._chunks->readBytes((char *)buff, sizeof(buff));
+  } else {
+    request._state = HTTPRequest::State::ReceivingHeaders;
+    return true;
+  }
+  if (_wifiClient->write(data, size) != size) {
+    finish(request, request._sent < request._out.length()
+                        ? HTTPC_ERROR_SEND_HEADER_FAILED
+                        : HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    return false;
+  }
+  if (request._sent < request._out.length()) {
+    request._sent += size;
+  }
+  return true;
+}
+
+bool HTTPService::receiveHeaders(HTTPRequest &request) {
+  bool progress = false;
+  int c;
+  while (_wifiClient->available() > 0 && (c = _wifiClient->read()) >= 0) {
+    progress = true;
+    if (c != '\n') {
+      request._line.push_back((char)c);
+      continue;
+    }
+    std::string &line = request._line;
+    if (line.length() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (request._statusCode == 0) {
+      // status line
+      auto sp = line.find(' ');
+      request._statusCode =
+          line.compare(0, 5, "HTTP/") == 0 && sp != std::string::npos
+              ? atoi(line.c_str() + sp + 1)
+              : 0;
+      if (request._statusCode <= 0) {
+        finish(request, HTTPC_ERROR_NO_HTTP_SERVER);
+        return true;
+      }
+    } else if (line.empty()) {
+      if (request._statusCode == 100) {
+        request._statusCode = 0;
+        continue;
+      }
+      const int code = request._statusCode;
+      if (code == 204 || code == 304) {
+        request._bodySize = 0;
+      }
+      if (request._bodySize < 0 && !request._chunked) {
+        // body is terminated by closing connection
+        request._keepAlive = false;
+      }
+      if (request._bodySize == 0 ||
+          (request._streamResponse && code == request._expectedCode)) {
+        finish(request, code);
+      } else {
+        request._left = request._chunked ? -1 : request._bodySize;
+        request._state = HTTPRequest::State::ReceivingBody;
+      }
+      line.clear();
+      return true;
+    } else {
+      auto colon = line.find(':');
+      if (colon != std::string::npos) {
+        line[colon] = 0;
+        const char *name = line.c_str();
+        const char *value = name + colon + 1;
+        while (*value == ' ') {
+          value++;
+        }
+        if (strcasecmp(name, "Content-Length") == 0) {
+          request._bodySize = atoi(value);
+        } else if (strcasecmp(name, "Connection") == 0) {
+          request._keepAlive = strcasecmp(value, "close") != 0;
+        } else if (strcasecmp(name, TransferEncoding) == 0) {
+          request._chunked = strcasecmp(value, "chunked") == 0;
+        } else if (strcasecmp(name, RetryAfter) == 0) {
+          request._retryAfter = atoi(value);
+        }
+      }
+    }
+    line.clear();
+  }
+  return progress;
+}
+
+// States of chunked body parsing, positive _left is remaining data of chunk
+static const int ChunkSizeLine = -1;
+static const int ChunkEnd = -2;
+static const int ChunkTrailer = -3;
+
+bool HTTPService::receiveBody(HTTPRequest &request) {
+  bool progress = false;
+  int c;
+  // body of unexpected response is kept as error message
+  const bool keep = request._statusCode != request._expectedCode;
+  while (_wifiClient->available() > 0 && (c = _wifiClient->read()) >= 0) {
+    progress = true;
+    if (request._left > 0) {
+      if (keep) {
+        request._error.push_back((char)c);
+      }
+      if (--request._left == 0) {
+        if (!request._chunked) {
+          finish(request, request._statusCode);
+          return true;
+        }
+        request._left = ChunkEnd;
+      }
+      continue;
+    }
+    if (!request._chunked) {
+      // unknown size, read until connection is closed
+      if (keep) {
+        request._error.push_back((char)c);
+      }
+      continue;
+    }
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      request._line.push_back((char)c);
+      continue;
+    }
+    if (request._left == ChunkEnd) {
+      request._left = ChunkSizeLine;
+    } else if (request._left == ChunkTrailer) {
+      if (request._line.empty()) {
+        finish(request, request._statusCode);
+        return true;
+      }
+    } else {
+      request._left = (int)strtol(request._line.c_str(), nullptr, 16);
+      if (request._left == 0) {
+        request._left = ChunkTrailer;
+      }
+    }
+    request._line.clear();
+  }
+  if (!progress && !request._chunked && request._bodySize < 0 &&
+      !_wifiClient->connected()) {
+    finish(request, request._statusCode);
+    return true;
+  }
+  return progress;
+}
+
+void HTTPService::finish(HTTPRequest &request, int statusCode) {
+  request._statusCode = statusCode;
+  if (statusCode < 0) {
+    request._keepAlive = false;
+    request._error = HTTPClient::errorToString(statusCode).c_str();
+  } else if (statusCode == request._expectedCode) {
+    request._error.clear();
+  }
+  request._keepAlive = request._keepAlive && _httpOptions._connectionReuse;
+  const bool streamed = request._streamResponse && statusCode > 0 &&
+                        statusCode == request._expectedCode;
+  if (!request._keepAlive && !streamed) {
+    _wifiClient->stop();
+  }
+  _lastStatusCode = statusCode;
+  _lastRequestTime = _lastUseTime = millis();
+  _lastRetryAfter = statusCode >= 429 ? request._retryAfter : 0;
+  _pConnInfo->lastError = request._error;
+  INFLUXDB_CLIENT_DEBUG("[D] Async HTTP status code - %d\n", statusCode);
+  request._state = HTTPRequest::State::Done;
+  // callback may start another request
+  std::shared_ptr<HTTPRequest> done = _request;
+  _request.reset();
+  if (request._callback) {
+    request._callback(request);
+  }
+}
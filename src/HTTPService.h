@@ -31,10 +31,15 @@
 #if defined(ESP8266)
 # include <WiFiClientSecureBearSSL.h>
 # include <ESP8266HTTPClient.h>
-#elif defined(ESP32)
+#elif defined(ESP32) || defined(INFLUXDB_CLIENT_HOST)
 # include <HTTPClient.h>
 #else
-# error "This library currently supports only ESP8266 and ESP32."
+# error "This library currently supports only ESP8266, ESP32 and Linux host."
+#endif
+#if !defined(ESP8266)
+// HTTPClient of ESP8266 sends stream only of known size, others send stream
+// until it reports end, which allows body of unknown length
+# define INFLUXDB_CLIENT_CHUNKED_POST
 #endif
 #include <memory>
 #include <string>
@@ -43,8 +48,47 @@
 
 class Test;
 typedef std::function<bool(HTTPClient *client)> httpResponseCallback;
+// Provides next part of request body. Copies at most size bytes to buffer and
+// returns their number, 0 when the body is complete.
+typedef std::function<size_t(uint8_t *buffer, size_t size)> httpBodyProducer;
 extern const char *TransferEncoding;
 
+#if defined(ESP8266)
+typedef BearSSL::Session TLSSession;
+#endif
+#if defined(ESP8266) || defined(INFLUXDB_CLIENT_HOST)
+// Network client can resume TLS sessions
+# define INFLUXDB_CLIENT_TLS_SESSION
+#endif
+
+/**
+ * TLSState keeps TLS parameters negotiated with server: the result of Maximum Fragment Length probe (ESP8266)
+ * and the session for abbreviated handshake (ESP8266 and host). It is plain data, which can be copied e.g. to RTC
+ * memory before deep sleep. It contains session secrets, so it must be stored only where others cannot read it.
+ **/
+struct TLSState {
+    enum Mfln : uint8_t { MflnUnknown = 0, MflnSupported, MflnUnsupported };
+    // CRC of server URL the state belongs to, 0 if it is not bound
+    uint32_t serverId = 0;
+    // CRC of the whole state, set by seal()
+    uint32_t checksum = 0;
+    // Result of MFLN probe
+    Mfln mfln = MflnUnknown;
+    uint8_t reserved[3] = {0, 0, 0};
+#ifdef INFLUXDB_CLIENT_TLS_SESSION
+    // Session resumed by the next connection
+    TLSSession session;
+#endif
+    // Clears state and binds it to server
+    void bind(const std::string &serverUrl);
+    // Returns true if state belongs to server
+    bool belongsTo(const std::string &serverUrl) const;
+    // Sets checksum of state
+    void seal();
+    // Returns true if checksum matches, e.g. state was restored intact from memory kept during deep sleep
+    bool isValid() const;
+};
+
 struct ConnectionInfo {
     // Connection info
     std::string serverUrl;
@@ -64,8 +108,74 @@ struct ConnectionInfo {
     bool insecure;
     // Error message of last failed operation
     std::string lastError;
+    // TLS parameters shared by connections to server
+    TLSState tlsState;
 };
 
+class ChunkedStream;
+
+/**
+ * HTTPRequest is a handle of an asynchronous request started by
+ * HTTPService::beginPOST. The request is advanced by HTTPService::poll(),
+ * which never waits for the server. Only connecting, including TLS handshake,
+ * blocks, because the network clients provide just a blocking connect.
+ **/
+class HTTPRequest {
+friend class HTTPService;
+  public:
+    enum class State : uint8_t { Connecting, Sending, ReceivingHeaders, ReceivingBody, Done };
+    ~HTTPRequest();
+    // Returns current state
+    State getState() const { return _state; }
+    // Returns true when request has completed, successfully or not
+    bool isDone() const { return _state == State::Done; }
+    // Returns true when request has completed with the expected status code
+    bool isSuccess() const { return isDone() && _statusCode == _expectedCode; }
+    // Returns HTTP status code, negative HTTPC_ERROR_* value in case of connection error, 0 while in progress
+    int getStatusCode() const { return _statusCode; }
+    // Returns response body or description of error, if request failed
+    const std::string &getError() const { return _error; }
+    // Returns connection with response body, when request was started with streamResponse
+    WiFiClient *getStream() const { return _client; }
+    // Returns size of response body, -1 if not known
+    int getBodySize() const { return _bodySize; }
+    // Returns true if response body uses chunked transfer encoding
+    bool isChunked() const { return _chunked; }
+    // Returns true if connection can be used for the next request after reading response body
+    bool canReuse() const { return _keepAlive; }
+    // Returns value of Retry-After header of failed response, 0 if it was missing
+    int getRetryAfter() const { return _retryAfter; }
+  private:
+    HTTPRequest();
+    State _state = State::Connecting;
+    int _expectedCode = 0;
+    int _statusCode = 0;
+    // Request head, followed by data of body of known size
+    std::string _out;
+    size_t _sent = 0;
+    // Source of chunked body
+    httpBodyProducer _producer;
+    std::unique_ptr<ChunkedStream> _chunks;
+    // Completion callback
+    std::function<void(HTTPRequest &request)> _callback;
+    // Whether response body is left for the callback to read
+    bool _streamResponse = false;
+    WiFiClient *_client = nullptr;
+    // Response line being parsed
+    std::string _line;
+    int _bodySize = -1;
+    // Remaining bytes of body or chunk, or state of chunk parsing
+    int _left = 0;
+    bool _chunked = false;
+    bool _keepAlive = true;
+    int _retryAfter = 0;
+    std::string _error;
+    // millis() of the last progress, for timeout
+    uint32_t _lastActivity = 0;
+};
+
+typedef std::function<void(HTTPRequest &request)> httpRequestCallback;
+
 /**
  * HTTPService provides  HTTP methods for communicating with InfluxDBServer,
  * while taking care of Authorization and error handling
@@ -79,6 +189,8 @@ friend class Test;
     std::string _apiURL;
     // Last time in ms we made are a request to server
     uint32_t _lastRequestTime = 0;
+    // Time in ms when the last request of any kind finished, for idle timeout
+    uint32_t _lastUseTime = 0;
     // HTTP status code of last request to server
     int _lastStatusCode = 0;
     // Underlying HTTPClient instance 
@@ -88,16 +200,49 @@ friend class Test;
 #ifdef  ESP8266
     // Trusted cert chain
     std::unique_ptr<BearSSL::X509List> _cert;
+    // MFLN must be checked before the first connection
+    bool _checkMFLN = false;
 #endif
     // Store retry timeout suggested by server after last request
     int _lastRetryAfter = 0;     
      // HTTP options
     HTTPOptions _httpOptions;
+    // Server host, port and scheme parsed once from server URL
+    String _host;
+    uint16_t _port = 0;
+    bool _https = false;
+    // Path part of server URL, prepended to request URI
+    String _basePath;
+    // Length of server URL prefix of request URLs, 0 if URLs must be parsed by HTTPClient
+    size_t _baseLength = 0;
+    // Request URI buffer reused by requests
+    String _uri;
+    // Value of Authorization header, prepared once
+    String _authorization;
+    // Whether response headers must be registered before next request
+    bool _collectHeaders = true;
+    // Asynchronous request in progress
+    std::shared_ptr<HTTPRequest> _request;
+    // Shared with query results reading response from connection
+    std::shared_ptr<bool> _lease;
 protected:
+    // Splits server URL to host, port and path
+    void parseServerUrl();
+    // Prepares network client before connecting
+    void beforeConnect();
     // Sets request params
     bool beforeRequest(const char *url);
     // Handles response
     bool afterRequest(int expectedStatusCode, httpResponseCallback cb, bool modifyLastConnStatus = true);
+    // Prepares asynchronous request, returns nullptr if it cannot be started
+    std::shared_ptr<HTTPRequest> prepareRequest(const char *url, const char *contentType, int expectedCode, httpRequestCallback cb, const char *contentEncoding, bool streamResponse);
+    // Steps of asynchronous request. Return true if request made progress
+    bool connect(HTTPRequest &request);
+    bool send(HTTPRequest &request);
+    bool receiveHeaders(HTTPRequest &request);
+    bool receiveBody(HTTPRequest &request);
+    // Completes asynchronous request and calls its callback
+    void finish(HTTPRequest &request, int statusCode);
 public: 
     // Creates HTTPService instance
     // serverUrl - url of the InfluxDB 2 server (e.g. http://localhost:8086)
@@ -115,8 +260,30 @@ public:
     HTTPOptions &getHTTPOptions() { return _httpOptions; }
     // Performs HTTP POST by sending data. On success calls response call back  
     bool doPOST(const char *url, const char *data, const char *contentType, int expectedCode, httpResponseCallback cb);
-    // Performs HTTP POST by sending stream. On success calls response call back  
-    bool doPOST(const char *url, Stream *stream, const char *contentType, int expectedCode, httpResponseCallback cb);
+    // Performs HTTP POST by sending stream. contentEncoding is optional, e.g. gzip. On success calls response call back  
+    bool doPOST(const char *url, Stream *stream, const char *contentType, int expectedCode, httpResponseCallback cb, const char *contentEncoding = nullptr);
+#ifdef INFLUXDB_CLIENT_CHUNKED_POST
+    // Performs HTTP POST with body of unknown length, pulled from producer and sent using chunked transfer encoding.
+    // contentEncoding is optional, e.g. gzip. On success calls response call back
+    bool doPOST(const char *url, httpBodyProducer producer, const char *contentType, int expectedCode, httpResponseCallback cb, const char *contentEncoding = nullptr);
+#endif
+    // Starts asynchronous HTTP POST of data, which are copied. Request is advanced by poll(), cb is called on completion.
+    // If streamResponse is true, body of successful response is left in connection for cb to read.
+    // Returns request handle, nullptr if another request is in progress.
+    std::shared_ptr<HTTPRequest> beginPOST(const char *url, const char *data, const char *contentType, int expectedCode, httpRequestCallback cb, bool streamResponse = false);
+    // Starts asynchronous HTTP POST with body pulled from producer and sent using chunked transfer encoding.
+    // contentEncoding is optional, e.g. gzip. Otherwise as beginPOST above.
+    std::shared_ptr<HTTPRequest> beginPOST(const char *url, httpBodyProducer producer, const char *contentType, int expectedCode, httpRequestCallback cb, const char *contentEncoding = nullptr);
+    // Advances asynchronous request without waiting for server. Returns true while a request is in progress
+    bool poll();
+    // Returns true if an asynchronous request is in progress
+    bool isBusy() const { return _request != nullptr; }
+    // Returns handle keeping connection reserved for the holder, e.g. a query result reading response, until it is released
+    std::shared_ptr<void> lease() { return _lease; }
+    // Returns true if no request is in progress and no lease is held
+    bool isIdle() const { return !_request && _lease.use_count() == 1; }
+    // Closes kept-alive connection if service is idle longer than connection idle timeout. Returns true if it is idle that long
+    bool closeIdle();
     // Performs HTTP GET. On success calls response call back    
     bool doGET(const char *url, int expectedCode, httpResponseCallback cb);
     // Performs HTTP DELETE. On success calls response call back    
@@ -25,11 +25,10 @@
  * SOFTWARE.
 */
 #include "InfluxData.h"
-#include "util/helpers.h"
 
 void InfluxData::setTimestamp(long int seconds) 
 { 
-    _data->setTime(timeStampToString(seconds,9) + "000000000");
+    _data->setTime(seconds * 1000000000LL, WritePrecision::NS);
 }
 
  const std::string& InfluxData::toString() {  
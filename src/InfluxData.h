@@ -29,8 +29,10 @@
 class InfluxData : public Point {
  public:
   InfluxData(const std::string &measurement) : Point(measurement) {}
+  InfluxData(const PointSchema &schema) : Point(schema) {}
 
   void addValue(const std::string &key, float value) { addField(key, value); }
+  void addValue(const PointSchema::Field &field, float value) { addField(field, value); }
   void addValueString(const std::string &key, std::string value) { addField(key, value); }
   void setTimestamp(long int seconds);
   const std::string& toString();
@@ -28,11 +28,11 @@
 
 #include "Platform.h"
 #include "Version.h"
+#include "util/GzipStream.h"
 
 constexpr auto TooEarlyMessage =
     "Cannot send request yet because of applied retry strategy. Remaining ";
 
-static std::string escapeJSONString(const std::string &value);
 static std::string precisionToString(WritePrecision precision,
                                      uint8_t version = 2) {
   switch (precision) {
@@ -74,6 +74,24 @@ InfluxDBClient::InfluxDBClient(const std::string &serverUrl,
 
 void InfluxDBClient::setInsecure(bool value) { _connInfo.insecure = value; }
 
+TLSState InfluxDBClient::getTLSState() {
+  TLSState state = _connInfo.tlsState;
+  if (!state.belongsTo(_connInfo.serverUrl)) {
+    state.bind(_connInfo.serverUrl);
+  }
+  state.seal();
+  return state;
+}
+
+bool InfluxDBClient::setTLSState(const TLSState &state) {
+  if (!state.isValid() || !state.belongsTo(_connInfo.serverUrl)) {
+    _connInfo.lastError = "Invalid TLS state";
+    return false;
+  }
+  _connInfo.tlsState = state;
+  return true;
+}
+
 void InfluxDBClient::setConnectionParams(const std::string &serverUrl,
                                          const std::string &org,
                                          const std::string &bucket,
@@ -129,16 +147,29 @@ bool InfluxDBClient::init() {
     _connInfo.lastError = "Invalid URL scheme";
     return false;
   }
+  _pool.clear();
+  _temporary.clear();
   _service.reset(new HTTPService(&_connInfo));
+  _lastService = _service.get();
 
   setUrls();
 
   return true;
 }
 
-InfluxDBClient::~InfluxDBClient() { clean(); }
+InfluxDBClient::~InfluxDBClient() {
+  // ticker callback notifies the worker, which is destroyed first
+  _flushTicker.detach();
+  _worker.stop();
+  clean();
+}
 
-void InfluxDBClient::clean() { _buckets.reset(nullptr); }
+void InfluxDBClient::clean() {
+  _buckets.reset(nullptr);
+  _worker.lock();
+  _healthy = false;
+  _worker.unlock();
+}
 
 bool InfluxDBClient::setUrls() {
   if (!_service && !init()) {
@@ -172,22 +203,21 @@ bool InfluxDBClient::setUrls() {
       _queryUrl += "?";
       _queryUrl += auth;
     }
-    // on version 1.x /ping will by default return status code 204, without
-    // verbose
-    _validateUrl =
-        _connInfo.serverUrl +
-        (_connInfo.dbVersion == 2 ? "/health" : "/ping?verbose=true");
-    if (_connInfo.dbVersion == 1 && _connInfo.user.length() > 0 &&
-        _connInfo.password.length() > 0) {
-      _validateUrl.append("&u=");
-      _validateUrl.append(urlEncode(_connInfo.user.c_str()));
-      _validateUrl.append("&p=");
-      _validateUrl.append(urlEncode(_connInfo.password.c_str()));
-    }
     INFLUXDB_CLIENT_DEBUG("[D]  writeUrl: %s\n", _writeUrl.c_str());
     INFLUXDB_CLIENT_DEBUG("[D]  queryUrl: %s\n", _queryUrl.c_str());
-    INFLUXDB_CLIENT_DEBUG("[D]  validateUrl: %s\n", _validateUrl.c_str());
   }
+  // on version 1.x /ping will by default return status code 204, without
+  // verbose
+  _validateUrl = _connInfo.serverUrl +
+                 (_connInfo.dbVersion == 2 ? "/health" : "/ping?verbose=true");
+  if (_connInfo.dbVersion == 1 && _connInfo.user.length() > 0 &&
+      _connInfo.password.length() > 0) {
+    _validateUrl.append("&u=");
+    _validateUrl.append(urlEncode(_connInfo.user.c_str()));
+    _validateUrl.append("&p=");
+    _validateUrl.append(urlEncode(_connInfo.password.c_str()));
+  }
+  INFLUXDB_CLIENT_DEBUG("[D]  validateUrl: %s\n", _validateUrl.c_str());
   if (_writeOptions._writePrecision != WritePrecision::NoTime) {
     _writeUrl += "&precision=";
     _writeUrl +=
@@ -219,6 +249,24 @@ bool InfluxDBClient::setWriteOptions(WritePrecision precision,
 }
 
 bool InfluxDBClient::setWriteOptions(const WriteOptions &writeOptions) {
+  waitAsync();
+  // background task reads options and urls while writing
+  const bool background = _worker.isRunning();
+  if (background && !writeOptions._queueDir.empty()) {
+    _connInfo.lastError = "Persistent queue cannot be used with background flush";
+    return false;
+  }
+  if (background) {
+    setBackgroundFlush(false);
+  }
+  bool res = applyWriteOptions(writeOptions);
+  if (background) {
+    res = setBackgroundFlush(true) && res;
+  }
+  return res;
+}
+
+bool InfluxDBClient::applyWriteOptions(const WriteOptions &writeOptions) {
   if (_writeOptions._writePrecision != writeOptions._writePrecision) {
     _writeOptions._writePrecision = writeOptions._writePrecision;
     if (!setUrls()) {
@@ -238,6 +286,9 @@ bool InfluxDBClient::setWriteOptions(const WriteOptions &writeOptions) {
     _writeOptions._bufferSize = writeOptions._bufferSize;
     _writeBuffer->setBufferSize(_writeOptions._batchSize *
                                 _writeOptions._bufferSize);
+    if (_flushBuffer) {
+      _flushBuffer->setBufferSize(_writeBuffer->getBufferSize());
+    }
     INFLUXDB_CLIENT_DEBUG("[D] Changing buffer size to %d\n",
                           _writeOptions._bufferSize);
   }
@@ -247,16 +298,37 @@ bool InfluxDBClient::setWriteOptions(const WriteOptions &writeOptions) {
     _flushTicker.attach_ms(
         _writeOptions._flushInterval.count() * 1000,
         +[](InfluxDBClient *c) {
-          c->_writeBuffer->_write = true;
+          // runs in timer task, buffers can be swapped meanwhile
+          c->_flushRequested = true;
+          c->_worker.notify();
           INFLUXDB_CLIENT_DEBUG(
               "[D] Reached write flush interval, marked for writing\n");
         },
         this);
   }
 
+  _writeOptions._maxBatchBytes = writeOptions._maxBatchBytes;
   _writeOptions._retryInterval = writeOptions._retryInterval;
-  _writeOptions._defaultTags = writeOptions._defaultTags;
+  _writeOptions._maxRetryInterval = writeOptions._maxRetryInterval;
+  _writeOptions._maxRetryAttempts = writeOptions._maxRetryAttempts;
+  _writeOptions._retryJitter = writeOptions._retryJitter;
+  if (_writeOptions._defaultTags != writeOptions._defaultTags ||
+      _writeOptions._seriesCacheSize != writeOptions._seriesCacheSize) {
+    _writeOptions._defaultTags = writeOptions._defaultTags;
+    _writeOptions._seriesCacheSize = writeOptions._seriesCacheSize;
+    _seriesCache.reset(_writeOptions._seriesCacheSize);
+  }
   _writeOptions._useServerTimestamp = writeOptions._useServerTimestamp;
+  _writeOptions._healthCheckPolicy = writeOptions._healthCheckPolicy;
+  _writeOptions._healthCheckTTL = writeOptions._healthCheckTTL;
+  _writeOptions._queueSegmentSize = writeOptions._queueSegmentSize;
+  _writeOptions._queueSyncInterval = writeOptions._queueSyncInterval;
+  if (_writeOptions._queueDir != writeOptions._queueDir) {
+    _writeOptions._queueDir = writeOptions._queueDir;
+    if (!openQueue()) {
+      return false;
+    }
+  }
   return true;
 }
 
@@ -265,6 +337,17 @@ bool InfluxDBClient::setHTTPOptions(const HTTPOptions &httpOptions) {
     return false;
   }
   _service->setHTTPOptions(httpOptions);
+  for (auto &service : _pool) {
+    service->setHTTPOptions(httpOptions);
+  }
+  for (auto &service : _temporary) {
+    service->setHTTPOptions(HTTPOptions(httpOptions).connectionReuse(false));
+  }
+  if (_worker.isRunning()) {
+    // background service is created again with the new options
+    setBackgroundFlush(false);
+    return setBackgroundFlush(true);
+  }
   return true;
 }
 
@@ -279,7 +362,18 @@ BucketsClient *InfluxDBClient::getBucketsClient() {
 }
 
 void InfluxDBClient::resetBuffer() {
+  waitAsync();
+  // background task must not be sending while buffers are cleared
+  const bool background = _worker.isRunning();
+  if (background) {
+    setBackgroundFlush(false);
+  }
   _writeBuffer->clear();
+  updateQueue();
+  _retryCount = 0;
+  if (background) {
+    setBackgroundFlush(true);
+  }
   INFLUXDB_CLIENT_DEBUG("[D] Reset buffer: buffer Size: %d, batch size: %d\n",
                         _writeOptions._bufferSize, _writeOptions._batchSize);
 }
@@ -290,94 +384,492 @@ void InfluxDBClient::resizeBuffer(int size) {
   if (size > _writeOptions._bufferSize) {
     INFLUXDB_CLIENT_DEBUG("[D] Resizing buffer from %d to %d\n",
                           _writeOptions._bufferSize, size);
-    _writeBuffer->_buffer.clear();
-    _writeBuffer->_buffer.shrink_to_fit();
+    _writeBuffer->release();
+    updateQueue();
     _writeOptions._bufferSize = size;
   }
 }
 
-void InfluxDBClient::addZerosToTimestamp(Point &point, int zeroes) {
-  point._data->timeStamp.append(zeroes, '0');
-}
-
-void InfluxDBClient::checkPrecisions(Point &point) {
+void InfluxDBClient::checkPrecisions(const Point &point) {
+  auto &data = *point._data;
   if (_writeOptions._writePrecision != WritePrecision::NoTime) {
-    if (!point.hasTime()) {
-      point.setTime(_writeOptions._writePrecision);
-      // Check different write precisions
-    } else if (point._data->tsWritePrecision != WritePrecision::NoTime &&
-               point._data->tsWritePrecision != _writeOptions._writePrecision) {
-      int diff = int(point._data->tsWritePrecision) -
-                 int(_writeOptions._writePrecision);
-      if (diff > 0) {  // point has higher precision, cut
-        auto &timestamp = point._data->timeStamp;
-        timestamp.erase(timestamp.length() - diff * 3);
-      } else {  // point has lower precision, add zeroes
-        addZerosToTimestamp(point, diff * -3);
-      }
+    if (!data.hasTime()) {
+      data.setTime(_writeOptions._writePrecision);
+    } else {
+      data.convertTime(_writeOptions._writePrecision);
     }
     // check someone set WritePrecision on point and not on client. NS precision
     // is ok, cause it is default on server
-  } else if (point.hasTime() &&
-             point._data->tsWritePrecision != WritePrecision::NoTime &&
-             point._data->tsWritePrecision != WritePrecision::NS) {
-    int diff = int(WritePrecision::NS) - int(point._data->tsWritePrecision);
-    addZerosToTimestamp(point, diff * 3);
+  } else if (data.hasTime()) {
+    data.convertTime(WritePrecision::NS);
   }
 }
 
 bool InfluxDBClient::writePoint(Point &point, bool chkBuffer) {
-  if (point.hasFields()) {
-    checkPrecisions(point);
-    return writeRecord(pointToLineProtocol(point), chkBuffer);
+  return writePoints(&point, 1, chkBuffer);
+}
+
+size_t InfluxDBClient::preparePoint(const Point &point) {
+  if (!point.hasFields()) {
+    return 0;
   }
-  return false;
+  checkPrecisions(point);
+  const auto &data = *point._data;
+  return std::max(
+      data.lineLength(seriesKey(point), _writeOptions._useServerTimestamp),
+      data.getLineSize());
+}
+
+bool InfluxDBClient::appendPoint(const Point &point, bool chkBuffer) {
+  if (!point.hasFields()) {
+    return false;
+  }
+  // encode line directly into the write buffer
+  const auto &data = *point._data;
+  const std::string &key = seriesKey(point);
+  const size_t length =
+      data.lineLength(key, _writeOptions._useServerTimestamp);
+  if (chkBuffer && _writeBuffer->_write && !_worker.isRunning() &&
+      _writeBuffer->getLength() + length > _writeBuffer->getCapacity()) {
+    // write full batches before the line overwrites them
+    checkBuffer();
+  }
+  _writeBuffer->beginLine(length);
+  data.writeLine(*_writeBuffer, key, _writeOptions._useServerTimestamp);
+  if (_writeBuffer->endLine()) {
+    _writeBuffer->_write = true;
+    INFLUXDB_CLIENT_DEBUG("[D] Reached write batch size, marked for writing\n");
+  }
+  queueLastLine(length);
+  return true;
 }
 
+const std::string &InfluxDBClient::seriesKey(const Point &point) {
+  const auto &data = *point._data;
+  // series of points with own tags are merged and cached by the point
+  if (data.hasPlainSeries() && !_writeOptions._defaultTags.empty() &&
+      _seriesCache.getCapacity() > 0) {
+    return _seriesCache.get(data.measurement, _writeOptions._defaultTags);
+  }
+  return data.seriesKey(_writeOptions._defaultTags);
+}
+
+bool InfluxDBClient::streamPoint(const Point &point, bool chkBuffer) {
+  if (!point.hasFields()) {
+    return false;
+  }
+  checkPrecisions(point);
+  return writeRecord(
+      point._data->createLineProtocol(_writeOptions._defaultTags,
+                                      _writeOptions._useServerTimestamp),
+      chkBuffer);
+}
+
+#ifdef INFLUXDB_CLIENT_CHUNKED_POST
+// Collects line parts written by Point::Data::writeLine
+struct LineWriter {
+  std::string &line;
+  void write(const char *data, size_t length) { line.append(data, length); }
+};
+
+bool InfluxDBClient::streamPoints(std::function<const Point *()> next) {
+  if (!_service && !init()) {
+    return false;
+  }
+  std::string line;
+  // bytes of line already sent
+  size_t sent = 0;
+  bool allWritten = true;
+  // encodes next point with fields, returns false after the last point
+  auto nextLine = [&]() {
+    const Point *point;
+    while ((point = next())) {
+      if (!point->hasFields()) {
+        allWritten = false;
+        continue;
+      }
+      checkPrecisions(*point);
+      line.clear();
+      sent = 0;
+      LineWriter writer{line};
+      point->_data->writeLine(writer, seriesKey(*point),
+                              _writeOptions._useServerTimestamp);
+      return true;
+    }
+    return false;
+  };
+  if (!nextLine()) {
+    return false;
+  }
+  uint32_t points = 1;
+  auto producer = [&](uint8_t *buffer, size_t size) -> size_t {
+    size_t produced = 0;
+    while (produced < size) {
+      if (sent == line.length()) {
+        if (!nextLine()) {
+          break;
+        }
+        points++;
+      }
+      size_t n = std::min(size - produced, line.length() - sent);
+      memcpy(buffer + produced, line.data() + sent, n);
+      sent += n;
+      produced += n;
+    }
+    return produced;
+  };
+  INFLUXDB_CLIENT_DEBUG("[D] Streaming to %s\n", _writeUrl.c_str());
+  HTTPService *service = syncService();
+  if (!service->doPOST(_writeUrl.c_str(), producer, PSTR("text/plain"), 204,
+                       nullptr)) {
+    INFLUXDB_CLIENT_DEBUG("[D] error %d: %s\n", service->getLastStatusCode(),
+                          service->getLastErrorMessage().c_str());
+    return false;
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Streamed %d points\n", points);
+  return allWritten;
+}
+#endif  // INFLUXDB_CLIENT_CHUNKED_POST
+
 InfluxDBClient::Batch::Batch(const uint16_t points) : _bufferSize(points) {}
 
 InfluxDBClient::Batch::~Batch() { clear(); }
 
 void InfluxDBClient::Batch::clear() {
-  _buffer.clear();
+  _removed += _numPoints;
   _numPoints = 0;
+  _head = 0;
+  _length = 0;
+  _firstLine = 0;
   _write = false;
   INFLUXDB_CLIENT_DEBUG("[D] Cleared buffer\n");
 }
 
-bool InfluxDBClient::Batch::append(const char *line) {
+void InfluxDBClient::Batch::release() {
+  clear();
+  _data.reset();
+  _capacity = 0;
+}
+
+void InfluxDBClient::Batch::growLines() {
+  const uint32_t size = _linesCapacity ? _linesCapacity * 2 : _bufferSize + 1;
+  std::unique_ptr<uint32_t[]> lines{new uint32_t[size]};
+  for (uint32_t i = 0; i < _numPoints; i++) {
+    lines[i] = _lines[(_firstLine + i) % _linesCapacity];
+  }
+  _lines = std::move(lines);
+  _linesCapacity = size;
+  _firstLine = 0;
+}
+
+void InfluxDBClient::Batch::reserve(size_t size) {
+  if (size <= _capacity) {
+    return;
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Reserving buffer %d bytes\n", size);
+  // move content to the beginning of the new buffer
+  std::unique_ptr<char[]> data{new char[size]};
+  uint32_t len0, len1;
+  const char *span0 = getSpan(0, len0);
+  const char *span1 = getSpan(1, len1);
+  if (len0) memcpy(data.get(), span0, len0);
+  if (len1) memcpy(data.get() + len0, span1, len1);
+  for (uint32_t i = 0; i < _numPoints; i++) {
+    auto &offset = _lines[(_firstLine + i) % _linesCapacity];
+    offset = (offset + _capacity - _head) % _capacity;
+  }
+  _data = std::move(data);
+  _capacity = size;
+  _head = 0;
+}
+
+void InfluxDBClient::Batch::dropFirst() {
+  if (_numPoints == 0) {
+    return;
+  }
+  _removed++;
+  _firstLine = (_firstLine + 1) % _linesCapacity;
+  if (--_numPoints == 0) {
+    _head = 0;
+    _length = 0;
+    return;
+  }
+  uint32_t next = _lines[_firstLine];
+  _length -= (next + _capacity - _head) % _capacity;
+  _head = next;
+}
+
+bool InfluxDBClient::Batch::append(const char *line, size_t length) {
+  beginLine(length);
+  write(line, length);
+  return endLine();
+}
+
+void InfluxDBClient::Batch::beginLine(size_t length) {
   INFLUXDB_CLIENT_DEBUG("[D] numPoints: %d _bufferSize %d\n", _numPoints,
                         _bufferSize);
-  while (_numPoints > 0 && _buffer.length() + strlen(line) > _buffer.capacity()) {
-    _buffer.erase(0, _buffer.find_first_of('\n') + 1);
-    _numPoints--;
+  _lineLength = 0;
+  if (length == 0) {
+    return;
+  }
+  if (length > _capacity) {
+    // line cannot fit even into empty buffer
+    reserve(length);
+  }
+  while (_numPoints > 0 && _length + length > _capacity) {
+    dropFirst();
+  }
+  if (_numPoints == _linesCapacity) {
+    growLines();
+  }
+  _lineStart = (_head + _length) % _capacity;
+}
+
+void InfluxDBClient::Batch::write(const char *data, size_t length) {
+  if (length == 0) {
+    return;
+  }
+  uint32_t pos = (_lineStart + _lineLength) % _capacity;
+  size_t first = std::min<size_t>(length, _capacity - pos);
+  memcpy(_data.get() + pos, data, first);
+  if (first < length) {
+    memcpy(_data.get(), data + first, length - first);
+  }
+  _lineLength += length;
+}
+
+bool InfluxDBClient::Batch::endLine() {
+  if (_lineLength > 0) {
+    _lines[(_firstLine + _numPoints) % _linesCapacity] = _lineStart;
+    _numPoints++;
+    _length += _lineLength;
+    _lineLength = 0;
   }
-  _buffer.append(line);
-  _numPoints++;
   return isFull();
 }
 
+void InfluxDBClient::Batch::drop(uint32_t count) {
+  while (count-- > 0 && _numPoints > 0) {
+    dropFirst();
+  }
+}
+
+uint32_t InfluxDBClient::Batch::getLinesLength(uint32_t count) const {
+  if (count >= _numPoints) {
+    return _length;
+  }
+  return (_lines[(_firstLine + count) % _linesCapacity] + _capacity - _head) %
+         _capacity;
+}
+
+const char *InfluxDBClient::Batch::getSpan(int index, uint32_t &length) const {
+  const uint32_t toEnd = _capacity - _head;
+  if (index == 0) {
+    length = std::min(_length, toEnd);
+    return _data.get() + _head;
+  }
+  length = _length > toEnd ? _length - toEnd : 0;
+  return _data.get();
+}
+
+const char *InfluxDBClient::Batch::getLastLine(int index,
+                                               uint32_t &length) const {
+  if (_numPoints == 0) {
+    length = 0;
+    return _data.get();
+  }
+  const uint32_t start = _lines[(_firstLine + _numPoints - 1) % _linesCapacity];
+  const uint32_t lineLength = _length - getLinesLength(_numPoints - 1);
+  const uint32_t toEnd = _capacity - start;
+  if (index == 0) {
+    length = std::min(lineLength, toEnd);
+    return _data.get() + start;
+  }
+  length = lineLength > toEnd ? lineLength - toEnd : 0;
+  return _data.get();
+}
+
+void InfluxDBClient::Batch::appendLines(const Batch &other) {
+  // lines of other must fit at least into empty buffer
+  reserve(other._capacity);
+  BatchStreamer streamer(&other);
+  char buff[64];
+  for (uint32_t i = 0; i < other._numPoints; i++) {
+    uint32_t left = other.getLinesLength(i + 1) - other.getLinesLength(i);
+    beginLine(left);
+    while (left > 0) {
+      size_t n = streamer.readBytes(buff, std::min<size_t>(left, sizeof(buff)));
+      write(buff, n);
+      left -= n;
+    }
+    endLine();
+  }
+}
+
+InfluxDBClient::BatchStreamer::BatchStreamer(const Batch *batch)
+    : BatchStreamer(batch, batch->getLength()) {}
+
+InfluxDBClient::BatchStreamer::BatchStreamer(const Batch *batch,
+                                             uint32_t length)
+    : _batch(batch), _length(length), _read(0) {}
+
+int InfluxDBClient::BatchStreamer::available() { return _length - _read; }
+
+size_t InfluxDBClient::BatchStreamer::readBytes(char *buffer, size_t len) {
+  size_t read = 0;
+  uint32_t len0, len1;
+  const char *span0 = _batch->getSpan(0, len0);
+  const char *span1 = _batch->getSpan(1, len1);
+  len = std::min<size_t>(len, _length - _read);
+  if (_read < len0 && len > 0) {
+    read = std::min<size_t>(len, len0 - _read);
+    memcpy(buffer, span0 + _read, read);
+  }
+  if (read < len) {
+    memcpy(buffer + read, span1 + (_read + read - len0), len - read);
+    read = len;
+  }
+  _read += read;
+  return read;
+}
+
+#if defined(ESP8266)
+int InfluxDBClient::BatchStreamer::read(uint8_t *buffer, size_t len) {
+  return readBytes((char *)buffer, len);
+}
+#endif
+
+int InfluxDBClient::BatchStreamer::peek() {
+  if (_read >= _length) {
+    return -1;
+  }
+  uint32_t len0, len1;
+  const char *span0 = _batch->getSpan(0, len0);
+  const char *span1 = _batch->getSpan(1, len1);
+  return _read < len0 ? span0[_read] : span1[_read - len0];
+}
+
+int InfluxDBClient::BatchStreamer::read() {
+  int c = peek();
+  if (c >= 0) {
+    _read++;
+  }
+  return c;
+}
+
+size_t InfluxDBClient::BatchStreamer::write(uint8_t) { return 0; }
+
 bool InfluxDBClient::writeRecord(const std::string &record, bool chkBuffer) {
   if (_streamWrite) {
     auto statusCode = postData(record.c_str());
     return statusCode >= 200 && statusCode < 300;
   }
 
-  const auto bufferSize =
-      _writeOptions._bufferSize * _writeOptions._batchSize * record.capacity();
-  if (_writeBuffer->_buffer.capacity() < bufferSize) {
-    _writeBuffer->_buffer.reserve(bufferSize);
+  _worker.lock();
+  reserveBuffer(record.capacity());
+  const bool full = _writeBuffer->append(record.c_str(), record.length());
+  _worker.unlock();
+  queueLastLine(record.length());
+  return afterWrite(full, chkBuffer);
+}
+
+void InfluxDBClient::reserveBuffer(size_t lineSize) {
+  const size_t bufferSize =
+      _writeOptions._bufferSize * _writeOptions._batchSize * lineSize;
+  if (_writeBuffer->getCapacity() < bufferSize) {
+    _writeBuffer->reserve(bufferSize);
   }
+}
 
-  if (_writeBuffer->append(record.c_str())) {
+bool InfluxDBClient::afterWrite(bool full, bool chkBuffer) {
+  if (full) {
+    _worker.lock();
     _writeBuffer->_write = true;
+    _worker.unlock();
     INFLUXDB_CLIENT_DEBUG("[D] Reached write batch size, marked for writing\n");
   }
   INFLUXDB_CLIENT_DEBUG("[D] done\n");
+  if (_worker.isRunning()) {
+    // never wait for server, background task writes full buffer
+    if (full) {
+      _worker.notify();
+    }
+    return true;
+  }
   return (chkBuffer) ? checkBuffer() : true;
 }
 
+bool InfluxDBClient::openQueue() {
+  _queue.reset();
+  if (_writeOptions._queueDir.empty()) {
+    return true;
+  }
+  if (!_writeBuffer->isEmpty()) {
+    _connInfo.lastError = "Persistent queue must be set before writing";
+    return false;
+  }
+  _writeBuffer->takeRemoved();
+  std::unique_ptr<FileQueue> queue{new FileQueue(
+      _writeOptions._queueDir, _writeOptions._queueSegmentSize,
+      _writeOptions._queueSyncInterval)};
+  auto replay = [this](const char *line, size_t length) {
+    reserveBuffer(length);
+    _writeBuffer->append(line, length);
+  };
+  if (!queue->open(replay)) {
+    _connInfo.lastError = "Cannot open persistent queue";
+    return false;
+  }
+  _queue = std::move(queue);
+  // lines not fitting into buffer are dropped also from queue
+  updateQueue();
+  if (!_writeBuffer->isEmpty()) {
+    _writeBuffer->_write = true;
+    INFLUXDB_CLIENT_DEBUG("[D] Replayed %d points, marked for writing\n",
+                          _writeBuffer->getNumPoints());
+  }
+  return true;
+}
+
+void InfluxDBClient::queueLastLine(size_t length) {
+  updateQueue();
+  if (!_queue || length == 0) {
+    return;
+  }
+  uint32_t len0, len1;
+  const char *span0 = _writeBuffer->getLastLine(0, len0);
+  const char *span1 = _writeBuffer->getLastLine(1, len1);
+  if (!_queue->beginRecord(len0 + len1) || !_queue->write(span0, len0) ||
+      !_queue->write(span1, len1) || !_queue->endRecord()) {
+    // queue would not match buffer anymore
+    INFLUXDB_CLIENT_DEBUG("[E] Persistent queue write failed, disabling it\n");
+    _connInfo.lastError = "Persistent queue write failed";
+    _queue.reset();
+  }
+}
+
+void InfluxDBClient::updateQueue() {
+  const uint32_t removed = _writeBuffer->takeRemoved();
+  if (_queue && removed > 0) {
+    _queue->pop(removed);
+  }
+}
+
 bool InfluxDBClient::checkBuffer() {
+  if (_worker.isRunning()) {
+    _worker.lock();
+    const bool write = _writeBuffer->_write;
+    _worker.unlock();
+    if (write) {
+      _worker.notify();
+    }
+    return true;
+  }
+  takeFlushRequest();
+  if (_asyncFlush) {
+    // buffer is flushed when asynchronous flush completes
+    return true;
+  }
   if (_writeBuffer->_write) {
     INFLUXDB_CLIENT_DEBUG("[D] Flushing buffer\n");
     return flushBufferInternal();
@@ -385,38 +877,436 @@ bool InfluxDBClient::checkBuffer() {
   return false;
 }
 
-bool InfluxDBClient::flushBuffer() { return flushBufferInternal(); }
+bool InfluxDBClient::flushBuffer() {
+  if (_worker.isRunning()) {
+    _worker.lock();
+    _writeBuffer->_write = true;
+    _worker.unlock();
+    _worker.notify();
+    // wait until background task writes everything or fails
+    while (!isBufferEmpty() && canSendRequest()) {
+      delay(1);
+    }
+    return isBufferEmpty();
+  }
+  return flushBufferInternal();
+}
+
+bool InfluxDBClient::flushBufferAsync(FlushCallback callback) {
+  if (!_service && !init()) {
+    return false;
+  }
+  if (_worker.isRunning() || _queue || _streamWrite) {
+    _connInfo.lastError =
+        "Asynchronous flush cannot be used with background flush, persistent "
+        "queue or stream write";
+    return false;
+  }
+  if (_asyncFlush || !idleService()) {
+    _connInfo.lastError = "Request in progress";
+    return false;
+  }
+  if (!canSendRequest()) {
+    _connInfo.lastError = TooEarlyMessage;
+    _connInfo.lastError += std::to_string(getRemainingRetryTime());
+    _connInfo.lastError.push_back('s');
+    return false;
+  }
+  if (_writeBuffer->isEmpty()) {
+    if (callback) {
+      callback(true);
+    }
+    return true;
+  }
+  // points written while requests are in progress go to the other buffer
+  if (!_flushBuffer) {
+    _flushBuffer.reset(new Batch(_writeBuffer->getBufferSize()));
+  }
+  _writeBuffer.swap(_flushBuffer);
+  _writeBuffer->_write = false;
+  _flushBuffer->_write = false;
+  _asyncFlush = true;
+  _asyncFlushFailed = false;
+  _flushCallback = callback;
+  return sendAsyncBatch();
+}
+
+bool InfluxDBClient::sendAsyncBatch() {
+  HTTPService *service = idleService();
+  if (!service) {
+    _connInfo.lastError = "Request in progress";
+    finishAsyncFlush(false);
+    return false;
+  }
+  uint32_t length;
+  const uint32_t lines = nextBatch(*_flushBuffer, length);
+  // sources live in the producer, which lives as long as the request
+  std::shared_ptr<BatchStreamer> streamer(
+      new BatchStreamer(_flushBuffer.get(), length));
+  httpBodyProducer producer;
+  const uint8_t level = service->getHTTPOptions()._compressionLevel;
+  if (level > 0) {
+    std::shared_ptr<GzipStream> gzip(
+        new GzipStream(streamer.get(), nullptr, level));
+    producer = [streamer, gzip](uint8_t *buffer, size_t size) {
+      return gzip->readBytes((char *)buffer, size);
+    };
+  } else {
+    producer = [streamer](uint8_t *buffer, size_t size) {
+      return streamer->readBytes((char *)buffer, size);
+    };
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Async write of %d points to %s\n", lines,
+                        _writeUrl.c_str());
+  auto request = service->beginPOST(
+      _writeUrl.c_str(), producer, PSTR("text/plain"), 204,
+      [this, lines](HTTPRequest &request) { asyncBatchDone(request, lines); },
+      level > 0 ? PSTR("gzip") : nullptr);
+  if (!request) {
+    finishAsyncFlush(false);
+    return false;
+  }
+  return true;
+}
+
+void InfluxDBClient::asyncBatchDone(HTTPRequest &request, uint32_t lines) {
+  const int statusCode = request.getStatusCode();
+  // any HTTP response means the server is reachable
+  updateHealth(statusCode > 0, millis());
+  INFLUXDB_CLIENT_DEBUG("[D] Async write of %d points: %d\n", lines,
+                        statusCode);
+  if (statusCode >= 200 && statusCode < 300) {
+    dropLines(*_flushBuffer, lines);
+    resetRetryCount();
+  } else if (isRetryable(statusCode)) {
+    retryableFailure(*_flushBuffer, lines, request.getRetryAfter());
+    finishAsyncFlush(false);
+    return;
+  } else {
+    INFLUXDB_CLIENT_DEBUG("[W] Dropping %d points rejected by server\n",
+                          lines);
+    dropLines(*_flushBuffer, lines);
+    _asyncFlushFailed = true;
+  }
+  if (_flushBuffer->isEmpty()) {
+    finishAsyncFlush(!_asyncFlushFailed);
+  } else {
+    sendAsyncBatch();
+  }
+}
+
+void InfluxDBClient::finishAsyncFlush(bool success) {
+  if (!_flushBuffer->isEmpty()) {
+    // unwritten lines are older than lines written meanwhile
+    const bool write = _writeBuffer->_write || !_flushBuffer->isEmpty();
+    _flushBuffer->appendLines(*_writeBuffer);
+    _writeBuffer.swap(_flushBuffer);
+    _writeBuffer->_write = write;
+  }
+  _flushBuffer->clear();
+  _asyncFlush = false;
+  FlushCallback callback = _flushCallback;
+  _flushCallback = nullptr;
+  if (callback) {
+    callback(success);
+  }
+}
+
+bool InfluxDBClient::poll() {
+  if (!_service) {
+    return false;
+  }
+  bool busy = _service->poll();
+  // callbacks may add services to the pool
+  for (size_t i = 0; i < _pool.size(); i++) {
+    busy = _pool[i]->poll() || busy;
+  }
+  closeIdleConnections();
+  return busy;
+}
+
+HTTPService *InfluxDBClient::idleService() {
+  HTTPService *service = nullptr;
+  if (_service->isIdle()) {
+    service = _service.get();
+  } else {
+    const size_t size = _service->getHTTPOptions()._connectionPoolSize - 1;
+    for (size_t i = 0; i < _pool.size() && i < size; i++) {
+      if (_pool[i]->isIdle()) {
+        service = _pool[i].get();
+        break;
+      }
+    }
+    if (!service && _pool.size() < size) {
+      INFLUXDB_CLIENT_DEBUG("[D] Opening connection %d\n", _pool.size() + 2);
+      service = new HTTPService(&_connInfo);
+      service->setHTTPOptions(_service->getHTTPOptions());
+      _pool.emplace_back(service);
+    }
+  }
+  if (service) {
+    _lastService = service;
+  }
+  return service;
+}
+
+HTTPService *InfluxDBClient::syncService() {
+  closeIdleConnections();
+  HTTPService *service = idleService();
+  if (!service) {
+    waitAsync();
+    service = idleService();
+  }
+  if (!service) {
+    // all connections are reserved by query results, which read responses
+    // from them
+    for (auto &temporary : _temporary) {
+      if (temporary->isIdle()) {
+        service = temporary.get();
+        break;
+      }
+    }
+    if (!service) {
+      INFLUXDB_CLIENT_DEBUG("[D] Opening temporary connection\n");
+      service = new HTTPService(&_connInfo);
+      // closed once the request is done
+      service->setHTTPOptions(
+          HTTPOptions(_service->getHTTPOptions()).connectionReuse(false));
+      _temporary.emplace_back(service);
+    }
+    _lastService = service;
+  }
+  return service;
+}
+
+void InfluxDBClient::closeIdleConnections() {
+  _service->closeIdle();
+  for (auto &service : _pool) {
+    service->closeIdle();
+  }
+}
+
+void InfluxDBClient::waitAsync() {
+  while (poll()) {
+    yield();
+  }
+}
+
+bool InfluxDBClient::isBufferFull() const {
+  _worker.lock();
+  bool full = _writeBuffer->isFull();
+  _worker.unlock();
+  return full;
+}
+
+bool InfluxDBClient::isBufferEmpty() const {
+  _worker.lock();
+  bool empty =
+      _writeBuffer->isEmpty() && (!_flushBuffer || _flushBuffer->isEmpty());
+  _worker.unlock();
+  return empty;
+}
 
 bool InfluxDBClient::flushBufferInternal() {
+  if (!_service && !init()) {
+    return false;
+  }
+  waitAsync();
+  // during retry interval nothing is sent, lines overwritten meanwhile are
+  // removed from queue by its sync interval
+  const bool sending = canSendRequest();
+  auto success = flushBatch(*_writeBuffer, syncService());
+  updateQueue();
+  if (_queue && sending) {
+    _queue->sync();
+  }
+  return success;
+}
+
+bool InfluxDBClient::flushBatch(Batch &batch, HTTPService *service) {
   if (!canSendRequest()) {
     INFLUXDB_CLIENT_DEBUG("[D] Still in retry interval, %d ticks remaining\n",
                           getRemainingRetryTime());
     return false;
   }
 
-  auto success{false};
-  if (validateConnection()) {
-    // send all batches, It could happen there was long network outage and
-    // buffer is full
-    auto statusCode = postData(_writeBuffer->_buffer.c_str());
-    // retry on unsuccessful connection or retryable status codes
-    success = statusCode >= 200 && statusCode < 300;
+  if (batch.isEmpty()) {
+    return true;
   }
-  INFLUXDB_CLIENT_DEBUG("[D] Last Write: %s\n",
-                        (success) ? "Success" : "Failure");
-  // advance even on message failure x e <300
-  switch (success) {
-    case true:
-      _writeBuffer->clear();
-      break;
-    case false:
-      _nextRetry =
-          std::chrono::steady_clock::now() + _writeOptions._retryInterval;
+
+  if (needsHealthCheck() && !validateConnection(service)) {
+    // counts as a failed attempt to write the next batch
+    uint32_t length;
+    retryableFailure(batch, nextBatch(batch, length),
+                     service->getLastRetryAfter());
+    return false;
+  }
+  // It could happen there was long network outage and buffer is full. Send it
+  // in batches and remove each one accepted by server.
+  auto success{true};
+  while (!batch.isEmpty()) {
+    uint32_t length;
+    const uint32_t lines = nextBatch(batch, length);
+    BatchStreamer streamer(&batch, length);
+    auto statusCode = postData(service, &streamer);
+    // any HTTP response means the server is reachable
+    updateHealth(statusCode > 0, service->getLastRequestTime());
+    INFLUXDB_CLIENT_DEBUG("[D] Write of %d points: %d\n", lines, statusCode);
+    if (statusCode >= 200 && statusCode < 300) {
+      dropLines(batch, lines);
+      resetRetryCount();
+      continue;
+    }
+    success = false;
+    if (isRetryable(statusCode)) {
+      retryableFailure(batch, lines, service->getLastRetryAfter());
       break;
+    }
+    // server will not accept this batch, continue with the next one
+    INFLUXDB_CLIENT_DEBUG("[W] Dropping %d points rejected by server\n", lines);
+    dropLines(batch, lines);
   }
   return success;
 }
 
+void InfluxDBClient::dropLines(Batch &batch, uint32_t lines) {
+  _worker.lock();
+  batch.drop(lines);
+  if (batch.isEmpty()) {
+    batch.clear();
+  }
+  _worker.unlock();
+}
+
+uint32_t InfluxDBClient::backgroundFlush() {
+  _worker.lock();
+  takeFlushRequest();
+  if (_flushBuffer->isEmpty() && _writeBuffer->_write) {
+    // producers continue with the empty buffer
+    _writeBuffer.swap(_flushBuffer);
+    _writeBuffer->_write = false;
+    _flushBuffer->_write = false;
+  }
+  _worker.unlock();
+  if (_flushBuffer->isEmpty()) {
+    return Worker::Forever;
+  }
+  const auto next = getNextRetry();
+  const auto now = std::chrono::steady_clock::now();
+  if (next <= now) {
+    flushBatch(*_flushBuffer, _flushService.get());
+    // swap again or wait for retry
+    return 0;
+  }
+  auto left =
+      std::chrono::duration_cast<std::chrono::milliseconds>(next - now);
+  return std::max<int64_t>(left.count(), 1);
+}
+
+bool InfluxDBClient::setBackgroundFlush(bool enable) {
+  if (enable == _worker.isRunning()) {
+    return true;
+  }
+  waitAsync();
+  if (!enable) {
+    _worker.stop();
+    // lines being written by the task are older
+    const bool write = _writeBuffer->_write || !_flushBuffer->isEmpty();
+    _flushBuffer->appendLines(*_writeBuffer);
+    _writeBuffer.swap(_flushBuffer);
+    _writeBuffer->_write = write;
+    _flushBuffer.reset();
+    _flushService.reset();
+    return true;
+  }
+  if (!_service && !init()) {
+    return false;
+  }
+  if (_streamWrite || _queue) {
+    _connInfo.lastError =
+        "Background flush cannot be used with stream write or persistent "
+        "queue";
+    return false;
+  }
+  _flushConnInfo = _connInfo;
+  _flushService.reset(new HTTPService(&_flushConnInfo));
+  _flushService->setHTTPOptions(_service->getHTTPOptions());
+  _flushBuffer.reset(new Batch(_writeBuffer->getBufferSize()));
+  if (!_worker.start([this]() { return backgroundFlush(); },
+                     "influxdb-flush", 8192, 1)) {
+    _flushService.reset();
+    _flushBuffer.reset();
+    _connInfo.lastError = "Background flush is not supported on this platform";
+    return false;
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Background flush started\n");
+  _worker.notify();
+  return true;
+}
+
+uint32_t InfluxDBClient::nextBatch(const Batch &batch, uint32_t &length) const {
+  uint32_t lines = std::min<uint32_t>(
+      std::max<uint16_t>(_writeOptions._batchSize, 1), batch.getNumPoints());
+  length = batch.getLinesLength(lines);
+  if (_writeOptions._maxBatchBytes > 0) {
+    while (lines > 1 && length > _writeOptions._maxBatchBytes) {
+      length = batch.getLinesLength(--lines);
+    }
+  }
+  return lines;
+}
+
+bool InfluxDBClient::isRetryable(int statusCode) {
+  // connection errors, too many requests and server errors
+  return statusCode <= 0 || statusCode == 429 || statusCode >= 500;
+}
+
+void InfluxDBClient::retryableFailure(Batch &batch, uint32_t lines,
+                                      int retryAfter) {
+  _worker.lock();
+  if (_retryCount < UINT16_MAX) {
+    _retryCount++;
+  }
+  const bool drop = _writeOptions._maxRetryAttempts > 0 &&
+                    _retryCount > _writeOptions._maxRetryAttempts;
+  if (drop) {
+    _retryCount = 0;
+  }
+  const uint16_t attempt = _retryCount;
+  _worker.unlock();
+  if (drop) {
+    INFLUXDB_CLIENT_DEBUG("[W] Max retry attempts reached, dropping %d points\n",
+                          lines);
+    dropLines(batch, lines);
+  }
+  scheduleRetry(attempt, retryAfter);
+}
+
+void InfluxDBClient::scheduleRetry(uint16_t attempt, int retryAfter) {
+  using namespace std::chrono;
+  uint32_t delayMs = 0;
+  if (retryAfter > 0) {
+    delayMs = retryAfter * 1000;
+  } else {
+    // exponential backoff: retryInterval * 2^(attempt-1), up to max interval
+    const uint32_t maxMs =
+        duration_cast<milliseconds>(_writeOptions._maxRetryInterval).count();
+    uint32_t ceilMs =
+        duration_cast<milliseconds>(_writeOptions._retryInterval).count();
+    for (uint16_t i = 1; i < attempt && ceilMs < maxMs; i++) {
+      ceilMs *= 2;
+    }
+    if (ceilMs > maxMs) {
+      ceilMs = maxMs;
+    }
+    delayMs = _writeOptions._retryJitter ? random(ceilMs + 1) : ceilMs;
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Attempt %d, retry in %dms\n", attempt, delayMs);
+  _worker.lock();
+  _nextRetry = steady_clock::now() + milliseconds(delayMs);
+  _worker.unlock();
+}
+
 const std::string &InfluxDBClient::pointToLineProtocol(Point &point) {
   return point.createLineProtocol(_writeOptions._defaultTags,
                                   _writeOptions._useServerTimestamp);
@@ -426,18 +1316,56 @@ bool InfluxDBClient::validateConnection() {
   if (!_service && !init()) {
     return false;
   }
+  return validateConnection(syncService());
+}
 
+bool InfluxDBClient::validateConnection(HTTPService *service) {
   INFLUXDB_CLIENT_DEBUG("[D] Validating connection to %s\n",
                         _validateUrl.c_str());
 
-  if (!_service->doGET(_validateUrl.c_str(), 200, nullptr)) {
-    INFLUXDB_CLIENT_DEBUG("[D] error %d: %s\n", _service->getLastStatusCode(),
-                          _service->getLastErrorMessage().c_str());
+  if (!service->doGET(_validateUrl.c_str(), 200, nullptr)) {
+    INFLUXDB_CLIENT_DEBUG("[D] error %d: %s\n", service->getLastStatusCode(),
+                          service->getLastErrorMessage().c_str());
+    updateHealth(false, millis());
     return false;
   }
+  updateHealth(true, millis());
   return true;
 }
 
+bool InfluxDBClient::needsHealthCheck() const {
+  switch (_writeOptions._healthCheckPolicy) {
+    case HealthCheckPolicy::Never:
+      return false;
+    case HealthCheckPolicy::OnFailureOrIdle: {
+      _worker.lock();
+      const bool healthy = _healthy;
+      const uint32_t lastHealthyTime = _lastHealthyTime;
+      _worker.unlock();
+      return !healthy ||
+             millis() - lastHealthyTime >=
+                 (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                     _writeOptions._healthCheckTTL)
+                     .count();
+    }
+    default:
+      return true;
+  }
+}
+
+void InfluxDBClient::updateHealth(bool healthy, uint32_t time) {
+  _worker.lock();
+  if (healthy != _healthy) {
+    INFLUXDB_CLIENT_DEBUG("[D] Connection is %s\n",
+                          healthy ? "healthy" : "failing");
+  }
+  _healthy = healthy;
+  if (healthy) {
+    _lastHealthyTime = time;
+  }
+  _worker.unlock();
+}
+
 int InfluxDBClient::postData(const char *data) {
   if (!_service && !init()) {
     return 0;
@@ -445,16 +1373,48 @@ int InfluxDBClient::postData(const char *data) {
   if (data) {
     INFLUXDB_CLIENT_DEBUG("[D] Writing to %s\n", _writeUrl.c_str());
     // INFLUXDB_CLIENT_DEBUG("[D] Sending:\n%s\n", data);
-    if (!_service->doPOST(_writeUrl.c_str(), data, PSTR("text/plain"), 204,
-                          nullptr)) {
-      INFLUXDB_CLIENT_DEBUG("[D] error %d: %s\n", _service->getLastStatusCode(),
-                            _service->getLastErrorMessage().c_str());
+    HTTPService *service = syncService();
+    if (!service->doPOST(_writeUrl.c_str(), data, PSTR("text/plain"), 204,
+                         nullptr)) {
+      INFLUXDB_CLIENT_DEBUG("[D] error %d: %s\n", service->getLastStatusCode(),
+                            service->getLastErrorMessage().c_str());
     }
-    return _service->getLastStatusCode();
+    return service->getLastStatusCode();
   }
   return 0;
 }
 
+int InfluxDBClient::postData(HTTPService *service, BatchStreamer *streamer) {
+  INFLUXDB_CLIENT_DEBUG("[D] Writing to %s\n", _writeUrl.c_str());
+  bool ok;
+  const uint8_t level = service->getHTTPOptions()._compressionLevel;
+  if (level > 0) {
+    GzipStream gzip(
+        streamer, [streamer]() { streamer->reset(); }, level);
+#ifdef INFLUXDB_CLIENT_CHUNKED_POST
+    // chunked body needs no size, data are compressed only once
+    ok = service->doPOST(
+        _writeUrl.c_str(),
+        [&gzip](uint8_t *buffer, size_t size) {
+          return gzip.readBytes((char *)buffer, size);
+        },
+        PSTR("text/plain"), 204, nullptr, PSTR("gzip"));
+#else
+    ok = service->doPOST(_writeUrl.c_str(), &gzip, PSTR("text/plain"), 204,
+                         nullptr, PSTR("gzip"));
+#endif
+    INFLUXDB_CLIENT_DEBUG("[D] Compressed %d bytes\n", gzip.getSourceSize());
+  } else {
+    ok = service->doPOST(_writeUrl.c_str(), streamer, PSTR("text/plain"), 204,
+                         nullptr);
+  }
+  if (!ok) {
+    INFLUXDB_CLIENT_DEBUG("[D] error %d: %s\n", service->getLastStatusCode(),
+                          service->getLastErrorMessage().c_str());
+  }
+  return service->getLastStatusCode();
+}
+
 void InfluxDBClient::setStreamWrite(bool enable) {
   _streamWrite = enable;
   _writeBuffer->clear();
@@ -462,8 +1422,7 @@ void InfluxDBClient::setStreamWrite(bool enable) {
     case true:
       _writeOptions._batchSize = 1;
       _writeOptions._bufferSize = 1;
-      _writeBuffer->_buffer.reserve(0);
-      _writeBuffer->_buffer.shrink_to_fit();
+      _writeBuffer->release();
       break;
     case false:
       break;
@@ -476,18 +1435,78 @@ constexpr char QueryDialect[] PROGMEM =
 
 constexpr char Params[] PROGMEM = R"(,"params": {)";
 
+std::string InfluxDBClient::queryBody(const std::string &fluxQuery,
+                                      QueryParams &params) {
+  auto queryEsc = escapeJSONString(fluxQuery);
+  std::string body;
+  body.reserve(150 + queryEsc.length() + params.size() * 30);
+  body = R"({"type":"flux","query":")";
+  body += queryEsc;
+  body += R"(",)";
+  body += QueryDialect;
+  if (params.size()) {
+    body += Params;
+    body += params.jsonString(0);
+    for (auto i = 1; i < params.size(); i++) {
+      body += ",";
+      body += params.jsonString(i);
+    }
+    body += '}';
+  }
+  body += '}';
+  return body;
+}
+
+bool InfluxDBClient::queryAsync(const std::string &fluxQuery,
+                                QueryCallback callback) {
+  return queryAsync(fluxQuery, QueryParams(), callback);
+}
+
+bool InfluxDBClient::queryAsync(const std::string &fluxQuery,
+                                QueryParams params, QueryCallback callback) {
+  if (!canSendRequest()) {
+    _connInfo.lastError = TooEarlyMessage;
+    _connInfo.lastError += std::to_string(getRemainingRetryTime());
+    _connInfo.lastError.push_back('s');
+    return false;
+  }
+  if (!_service && !init()) {
+    return false;
+  }
+  HTTPService *service = idleService();
+  if (!service) {
+    _connInfo.lastError = "Request in progress";
+    return false;
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Async query to %s\n", _queryUrl.c_str());
+  std::string body = queryBody(fluxQuery, params);
+  auto request = service->beginPOST(
+      _queryUrl.c_str(), body.c_str(), PSTR("application/json"), 200,
+      [this, service, callback](HTTPRequest &request) {
+        if (!request.isSuccess()) {
+          scheduleRetry(1, request.getRetryAfter());
+          callback(FluxQueryResult(request.getError()));
+          return;
+        }
+        // connection is reserved until the result is closed
+        HttpStreamScanner *scanner = new HttpStreamScanner(
+            request.getStream(), request.getBodySize(), request.isChunked(),
+            request.canReuse(), service->lease());
+        callback(FluxQueryResult(new CsvReader(scanner)));
+      },
+      true);
+  return request != nullptr;
+}
+
 FluxQueryResult InfluxDBClient::query(const std::string &fluxQuery) {
   return query(fluxQuery, QueryParams());
 }
 
 FluxQueryResult InfluxDBClient::query(const std::string &fluxQuery,
                                       QueryParams params) {
-  if (_nextRetry != std::chrono::steady_clock::time_point::min() &&
-      _nextRetry < std::chrono::steady_clock::now()) {
-    auto left{std::to_string(
-        (std::chrono::steady_clock::now() - _nextRetry).count())};
-    INFLUXDB_CLIENT_DEBUG("[W] Cannot query yet, pause %ds, %ss yet\n",
-                          _writeOptions._retryInterval.count(), left);
+  if (!canSendRequest()) {
+    auto left{std::to_string(getRemainingRetryTime())};
+    INFLUXDB_CLIENT_DEBUG("[W] Cannot query yet, %ss left\n", left.c_str());
     // retry after period didn't run out yet
     std::string mess{TooEarlyMessage};
     mess.append(left);
@@ -500,26 +1519,11 @@ FluxQueryResult InfluxDBClient::query(const std::string &fluxQuery,
   INFLUXDB_CLIENT_DEBUG("[D] Query to %s\n", _queryUrl.c_str());
   INFLUXDB_CLIENT_DEBUG("[D] JSON query:\n%s\n", fluxQuery.c_str());
 
-  auto queryEsc = escapeJSONString(fluxQuery);
-  std::string body;
-  body.reserve(150 + queryEsc.length() + params.size() * 30);
-  body = R"({"type":"flux","query":")";
-  body += queryEsc;
-  body += R"(",)";
-  body += QueryDialect;
-  if (params.size()) {
-    body += Params;
-    body += params.jsonString(0);
-    for (auto i = 1; i < params.size(); i++) {
-      body += ",";
-      body += params.jsonString(i);
-    }
-    body += '}';
-  }
-  body += '}';
+  std::string body = queryBody(fluxQuery, params);
   CsvReader *reader = nullptr;
   INFLUXDB_CLIENT_DEBUG("[D] Query: %s\n", body.c_str());
-  if (_service->doPOST(
+  HTTPService *service = syncService();
+  if (service->doPOST(
           _queryUrl.c_str(), body.c_str(), PSTR("application/json"), 200,
           [&](HTTPClient *httpClient) {
             bool chunked = false;
@@ -530,56 +1534,15 @@ FluxQueryResult InfluxDBClient::query(const std::string &fluxQuery,
               chunked = header == "chunked";
             }
             INFLUXDB_CLIENT_DEBUG("[D] chunked: %s\n", bool2string(chunked));
+            // connection is reserved until the result is closed
             HttpStreamScanner *scanner =
-                new HttpStreamScanner(httpClient, chunked);
+                new HttpStreamScanner(httpClient, chunked, service->lease());
             reader = new CsvReader(scanner);
             return false;
           })) {
     return FluxQueryResult(reader);
   } else {
-    _nextRetry =
-        std::chrono::steady_clock::now() + _writeOptions._retryInterval;
-    return FluxQueryResult(_service->getLastErrorMessage());
-  }
-}
-
-static std::string escapeJSONString(const std::string &value) {
-  std::string ret;
-  ret.reserve(value.length() + value.length() / 10);
-  // most probably we will escape just double quotes
-  for (char c : value) {
-    switch (c) {
-      case '"':
-        ret.append("\\\"");
-        break;
-      case '\\':
-        ret.append("\\\\");
-        break;
-      case '\b':
-        ret.append("\\b");
-        break;
-      case '\f':
-        ret.append("\\f");
-        break;
-      case '\n':
-        ret.append("\\n");
-        break;
-      case '\r':
-        ret.append("\\r");
-        break;
-      case '\t':
-        ret.append("\\t");
-        break;
-      default:
-        if (c <= '\x1f') {
-          ret.append("\\u");
-          char buf[3 + 8 * sizeof(unsigned int)];
-          sprintf(buf, "\\u%04u", c);
-          ret.append(buf);
-        } else {
-          ret.push_back(c);
-        }
-    }
+    scheduleRetry(1, service->getLastRetryAfter());
+    return FluxQueryResult(service->getLastErrorMessage());
   }
-  return ret;
 }
@@ -34,10 +34,14 @@
 #include "HTTPService.h"
 #include "Options.h"
 #include "Point.h"
+#include "PointPool.h"
 #include "Version.h"
 #include "WritePrecision.h"
 #include "query/FluxParser.h"
 #include "query/Params.h"
+#include "util/FileQueue.h"
+#include "util/SeriesCache.h"
+#include "util/Worker.h"
 #include "util/debug.h"
 #include "util/helpers.h"
 
@@ -47,8 +51,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 class Test;
 
@@ -62,6 +68,11 @@ class InfluxDBClient {
   friend class Test;
 
  public:
+  // Called when asynchronous flush completes. success is true if all lines
+  // were written
+  typedef std::function<void(bool success)> FlushCallback;
+  // Called with result of asynchronous query
+  typedef std::function<void(FluxQueryResult result)> QueryCallback;
   // Creates InfluxDBClient unconfigured instance.
   // Call to setConnectionParams is required to set up client
   InfluxDBClient();
@@ -92,6 +103,14 @@ class InfluxDBClient {
   // setInsecure must be called before calling any method initiating a
   // connection to server.
   void setInsecure(bool value = true);
+  // Returns TLS state negotiated with server: session for abbreviated
+  // handshake and the result of Maximum Fragment Length probe. It can be kept
+  // e.g. in RTC memory and restored by setTLSState after deep sleep.
+  TLSState getTLSState();
+  // Restores TLS state returned by getTLSState. State of another server or
+  // damaged state is refused.
+  // Returns true if state was restored
+  bool setTLSState(const TLSState &state);
   // Sets custom write options.
   // Must be called before calling any method initiating a connection to server.
   // precision - timestamp precision of written data
@@ -164,6 +183,48 @@ class InfluxDBClient {
   // Writes record represented by Point to buffer
   // Returns true if successful, false in case of any error
   bool writePoint(Point &point, bool chkBuffer = true);
+  // Writes count points to buffer in one pass. Buffer is reserved once and
+  // checked for flushing after all points are written; full batches are
+  // flushed earlier only when they would be overwritten. Points without
+  // timestamp get current time like by writePoint.
+  // Returns true if all points are written, false if a point has no fields or
+  // in case of any error
+  bool writePoints(const Point *points, size_t count, bool chkBuffer = true) {
+    return writePoints(points, points + count, chkBuffer);
+  }
+  // Writes range of points, e.g. of std::vector<Point>, as writePoints above
+  template <class Iterator>
+  bool writePoints(Iterator first, Iterator last, bool chkBuffer = true) {
+    bool written = true;
+    if (_streamWrite) {
+#ifdef INFLUXDB_CLIENT_CHUNKED_POST
+      // all points are sent in one request
+      return streamPoints([&first, &last]() -> const Point * {
+        return first != last ? &*first++ : nullptr;
+      });
+#else
+      for (Iterator it = first; it != last; ++it) {
+        written = streamPoint(*it, chkBuffer) && written;
+      }
+      return written;
+#endif
+    }
+    size_t lineSize = 0;
+    for (Iterator it = first; it != last; ++it) {
+      lineSize = std::max(lineSize, preparePoint(*it));
+    }
+    if (lineSize == 0) {
+      return false;
+    }
+    _worker.lock();
+    reserveBuffer(lineSize);
+    for (Iterator it = first; it != last; ++it) {
+      written = appendPoint(*it, chkBuffer) && written;
+    }
+    const bool full = _writeBuffer->_write;
+    _worker.unlock();
+    return afterWrite(full, chkBuffer) && written;
+  }
   // Sends Flux query and returns FluxQueryResult object for subsequently
   // reading flux query response. Use FluxQueryResult::next() method to iterate
   // over lines of the query result. Always call of FluxQueryResult::close()
@@ -178,13 +239,31 @@ class InfluxDBClient {
   // Forces writing of all points in buffer, even the batch is not full.
   // Returns true if successful, false in case of any error
   bool flushBuffer();
+  // Starts writing all points in buffer without waiting for the server.
+  // Requests are advanced by poll() and callback is called when all points
+  // are written or writing fails. Points written meanwhile stay in buffer for
+  // the next flush. Cannot be used with background flush, persistent queue or
+  // stream write.
+  // Returns false if flush cannot be started, e.g. another one is in progress
+  bool flushBufferAsync(FlushCallback callback = nullptr);
+  // Sends Flux query without waiting for the server. Request is advanced by
+  // poll() and callback gets the result when the response starts to arrive.
+  // Rows are then read from the result as from query().
+  // Returns false if query cannot be sent, e.g. another request is in progress
+  bool queryAsync(const std::string &fluxQuery, QueryCallback callback);
+  // Sends Flux query with params without waiting, as queryAsync above
+  bool queryAsync(const std::string &fluxQuery, QueryParams params,
+                  QueryCallback callback);
+  // Advances asynchronous flush or query without blocking. Call it repeatedly,
+  // e.g. from loop(). Returns true while a request is in progress
+  bool poll();
   // Returns true if points buffer is full. Useful when server is overloaded and
   // we may want increase period of write points or decrease number of points
-  bool isBufferFull() const { return _writeBuffer->isFull(); };
+  bool isBufferFull() const;
   // Returns true if buffer is empty. Useful when going to sleep and check if
   // there is sth in write buffer (it can happens when batch size if bigger than
   // 1). Call flushBuffer() then.
-  bool isBufferEmpty() const { return _writeBuffer->isEmpty(); };
+  bool isBufferEmpty() const;
   // Checks points buffer status and flushes if number of points reached batch
   // size or flush interval runs out. Returns true if anything is flushed
   // successfully, false if not
@@ -194,7 +273,7 @@ class InfluxDBClient {
   // Returns HTTP status of last request to server. Useful for advanced handling
   // of failures.
   int getLastStatusCode() const {
-    return _service ? _service->getLastStatusCode() : 0;
+    return _lastService ? _lastService->getLastStatusCode() : 0;
   }
   // Returns last response when operation failed
   std::string getLastErrorMessage() const { return _connInfo.lastError; }
@@ -205,12 +284,17 @@ class InfluxDBClient {
   // overloaded and retry strategy is applied. Use getRemainingRetryTime() to
   // get wait time in such case.
   bool canSendRequest() {
-    return _nextRetry <= std::chrono::steady_clock::now();
+    return getNextRetry() <= std::chrono::steady_clock::now();
   }
   // Returns remaining wait time in seconds when retry strategy is applied.
   uint32_t getRemainingRetryTime() {
-    if (canSendRequest()) return 0;
-    return (std::chrono::steady_clock::time_point::min() - _nextRetry).count();
+    const auto next = getNextRetry();
+    const auto now = std::chrono::steady_clock::now();
+    // no retry pending is time_point::min(), difference would overflow
+    if (next <= now) return 0;
+    auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(next - now);
+    return (left.count() + 999) / 1000;
   };
   // Returns sub-client for managing buckets
   BucketsClient *getBucketsClient();
@@ -221,7 +305,13 @@ class InfluxDBClient {
   // Returns true if HTTP connection is kept open (connection reuse must be set
   // to true)
   bool isConnected() const { return _service && _service->isConnected(); }
-
+  // Enables/disables flushing in a background task (ESP32 and host only).
+  // Writes then only append to buffer and never wait for server. While the
+  // task sends full buffer, new points are appended to a second buffer.
+  // flushBuffer() waits until buffers are written or write fails. Write and
+  // HTTP options must be set before. Cannot be used with persistent queue.
+  // Returns false if not supported.
+  bool setBackgroundFlush(bool enable = true);
  protected:
   // Checks params and sets up security, if needed.
   // Returns true in case of success, otherwise false
@@ -230,25 +320,123 @@ class InfluxDBClient {
   void clean();
 
  protected:
+  // Batch keeps lines to write in a fixed size byte ring buffer. Start offsets
+  // of lines are kept in a separate ring, so the oldest line is dropped in
+  // constant time when there is no space for a new line.
   class Batch {
     friend class Test;
 
    private:
+    // Number of lines when batch is full
     uint32_t _bufferSize{0};
+    // Number of lines in buffer
     uint32_t _numPoints{0};
+    // Ring buffer of line bytes
+    std::unique_ptr<char[]> _data;
+    // Size of the ring buffer
+    uint32_t _capacity{0};
+    // Offset of the oldest line in the ring buffer
+    uint32_t _head{0};
+    // Number of used bytes
+    uint32_t _length{0};
+    // Ring of line start offsets
+    std::unique_ptr<uint32_t[]> _lines;
+    // Size of the ring of line offsets
+    uint32_t _linesCapacity{0};
+    // Index of the oldest line in _lines
+    uint32_t _firstLine{0};
+    // Offset of the line being written
+    uint32_t _lineStart{0};
+    // Bytes written to the line being written
+    uint32_t _lineLength{0};
+    // Number of lines removed since the last takeRemoved()
+    uint32_t _removed{0};
+
+   protected:
+    // Removes the oldest line
+    void dropFirst();
+    // Doubles size of the ring of line offsets
+    void growLines();
 
    public:
     std::atomic<bool> _write{false};
-    std::string _buffer;
     Batch(const uint16_t points = 1);
     ~Batch();
-    bool append(const char *line);
+    // Appends line, the oldest lines are dropped if there is no space.
+    // Returns true if batch is full
+    bool append(const char *line, size_t length);
+    bool append(const char *line) { return append(line, strlen(line)); }
+    // Makes space for a line of length bytes at the end of the buffer. The
+    // oldest lines are dropped if there is no space. Line is filled by write()
+    // and finished by endLine().
+    void beginLine(size_t length);
+    // Copies data to the line started by beginLine. Total written length must
+    // not exceed the length passed to beginLine.
+    void write(const char *data, size_t length);
+    // Finishes line started by beginLine.
+    // Returns true if batch is full
+    bool endLine();
     void clear();
+    // Makes capacity of the buffer at least size bytes. Keeps content.
+    void reserve(size_t size);
+    // Frees allocated memory
+    void release();
     bool isFull() const { return _numPoints >= _bufferSize; }
-    bool isEmpty() const { return _buffer.empty(); }
+    bool isEmpty() const { return _numPoints == 0; }
     void setBufferSize(const uint32_t points = 1) { _bufferSize = points; };
-    uint32_t getBufferSize() { return _bufferSize; };
-    uint32_t getNumPoints() { return _numPoints; };
+    uint32_t getBufferSize() const { return _bufferSize; };
+    uint32_t getNumPoints() const { return _numPoints; };
+    // Returns size of the ring buffer in bytes
+    uint32_t getCapacity() const { return _capacity; }
+    // Returns number of bytes of all lines
+    uint32_t getLength() const { return _length; }
+    // Returns number of bytes of the first count lines
+    uint32_t getLinesLength(uint32_t count) const;
+    // Removes the first count lines
+    void drop(uint32_t count);
+    // Returns first (index 0) or second (index 1) contiguous part of data.
+    // The second part is non-empty only when data wraps around the end of
+    // the ring buffer.
+    const char *getSpan(int index, uint32_t &length) const;
+    // Returns first or second contiguous part of the last line
+    const char *getLastLine(int index, uint32_t &length) const;
+    // Appends all lines of other batch
+    void appendLines(const Batch &other);
+    // Returns number of lines removed, either written, dropped or overwritten,
+    // since the last call
+    uint32_t takeRemoved() {
+      uint32_t removed = _removed;
+      _removed = 0;
+      return removed;
+    }
+  };
+
+  // Streams content of a batch without copying it into a single buffer
+  class BatchStreamer : public Stream {
+   private:
+    const Batch *_batch;
+    // Total bytes to stream
+    uint32_t _length;
+    // Bytes already read
+    uint32_t _read;
+
+   public:
+    // Streams all lines
+    BatchStreamer(const Batch *batch);
+    // Streams the first length bytes
+    BatchStreamer(const Batch *batch, uint32_t length);
+    virtual ~BatchStreamer(){};
+    // Stream overrides
+    virtual int available() override;
+    virtual int read() override;
+#if defined(ESP8266)
+    virtual int read(uint8_t *buffer, size_t len) override;
+#endif
+    virtual size_t readBytes(char *buffer, size_t len) override;
+    virtual void flush() override{};
+    virtual int peek() override;
+    virtual size_t write(uint8_t data) override;
+    void reset() { _read = 0; }
   };
 
   ConnectionInfo _connInfo;
@@ -266,29 +454,155 @@ class InfluxDBClient {
   Ticker _flushTicker;
   // HTTP operations object
   std::unique_ptr<HTTPService> _service;
+  // Additional HTTP operations objects of connection pool, used when _service
+  // is busy
+  std::vector<std::unique_ptr<HTTPService>> _pool;
+  // HTTP operations objects without connection reuse, used for synchronous
+  // requests when all pooled connections are reserved by query results
+  std::vector<std::unique_ptr<HTTPService>> _temporary;
+  // Service of the last request, _service or one of _pool or _temporary
+  HTTPService *_lastService = nullptr;
   // Bucket sub-client
   std::unique_ptr<BucketsClient> _buckets;
+  // Persistent copy of buffered lines, if enabled
+  std::unique_ptr<FileQueue> _queue;
+  // Series keys of measurements joined with default tags
+  SeriesCache _seriesCache;
+  // Background flush task
+  Worker _worker;
+  // Buffer being written by the background task
+  std::unique_ptr<Batch> _flushBuffer;
+  // Connection info of the background task
+  ConnectionInfo _flushConnInfo;
+  // HTTP operations object of the background task
+  std::unique_ptr<HTTPService> _flushService;
   // Write using buffer or stream
   bool _streamWrite = false;
+  // Set by flush ticker, moved to write buffer by the flushing side
+  std::atomic<bool> _flushRequested{false};
+  // Retry and health state below is shared with the background task, it is
+  // accessed under _worker lock
   // next retry time
   std::chrono::steady_clock::time_point _nextRetry{
       std::chrono::steady_clock::time_point::min()};
+  // Number of consecutive failed write attempts
+  uint16_t _retryCount = 0;
+  // true if the last request reached the server
+  bool _healthy = false;
+  // Asynchronous flush is in progress, sending lines of _flushBuffer
+  bool _asyncFlush = false;
+  // Some lines of asynchronous flush were rejected by server
+  bool _asyncFlushFailed = false;
+  // Callback of asynchronous flush in progress
+  FlushCallback _flushCallback;
+  // millis() of the last request that reached the server
+  uint32_t _lastHealthyTime = 0;
 
  protected:
   // Sends POST request with data in body
   int postData(const char *data);
+  // Sends POST request with content of batch in body, compressed if enabled
+  int postData(HTTPService *service, BatchStreamer *streamer);
+  // Validates connection using service
+  bool validateConnection(HTTPService *service);
   // Sets cached InfluxDB server API URLs
   bool setUrls();
   // Resize the buffer to the required size
   void resizeBuffer(int size);
+  // Allocates write buffer for lines of lineSize bytes, if not yet done
+  void reserveBuffer(size_t lineSize);
+  // Marks buffer for writing if full and optionally flushes it
+  bool afterWrite(bool full, bool chkBuffer);
+  // Adjusts timestamp of point. Returns size of buffer line needed for the
+  // point, 0 if it has no fields
+  size_t preparePoint(const Point &point);
+  // Encodes prepared point into write buffer and marks it for writing when
+  // batch is full. Must be called locked. Returns false if point has no fields
+  bool appendPoint(const Point &point, bool chkBuffer);
+  // Writes point by streaming
+  bool streamPoint(const Point &point, bool chkBuffer);
+#ifdef INFLUXDB_CLIENT_CHUNKED_POST
+  // Writes points returned by next, until it returns nullptr, in one chunked
+  // request. Lines are encoded one by one while the request is sent.
+  // Returns true if all points are written
+  bool streamPoints(std::function<const Point *()> next);
+#endif
+  // Returns series key of point joined with default tags
+  const std::string &seriesKey(const Point &point);
+  // Opens persistent queue and replays stored lines into buffer
+  bool openQueue();
+  // Appends the last buffered line of length bytes to persistent queue
+  void queueLastLine(size_t length);
+  // Removes lines no longer buffered from persistent queue
+  void updateQueue();
   // Writes all points in buffer, with respect to the batch size, and in case of
   // success clears the buffer.
   // Returns true if successful, false in case of any error
   bool flushBufferInternal();
-  // Checks precision of point and modifies if needed
-  void checkPrecisions(Point &point);
-  // helper which adds zeroes to timestamp of point to increase precision
-  static void addZerosToTimestamp(Point &point, int zeroes);
+  // Sends the next batch of asynchronous flush. Returns false if it cannot
+  // be sent
+  bool sendAsyncBatch();
+  // Handles response to batch of lines sent asynchronously
+  void asyncBatchDone(HTTPRequest &request, uint32_t lines);
+  // Returns unwritten lines to write buffer and calls flush callback
+  void finishAsyncFlush(bool success);
+  // Waits until asynchronous requests complete
+  void waitAsync();
+  // Creates JSON body of query request
+  std::string queryBody(const std::string &fluxQuery, QueryParams &params);
+  // Writes all points of batch using service
+  bool flushBatch(Batch &batch, HTTPService *service);
+  // Removes the first lines of batch, which can be shared with background task
+  void dropLines(Batch &batch, uint32_t lines);
+  // Job of the background task, returns milliseconds to wait
+  uint32_t backgroundFlush();
+  // Returns number of lines of the next batch to send, sets length in bytes
+  uint32_t nextBatch(const Batch &batch, uint32_t &length) const;
+  // Returns true if write with the status code should be retried
+  static bool isRetryable(int statusCode);
+  // Handles failed write of lines of batch that will be retried
+  void retryableFailure(Batch &batch, uint32_t lines, int retryAfter);
+  // Sets time of the next request after a failure. Uses retryAfter [s] sent by
+  // server, or exponential backoff for the given attempt number
+  void scheduleRetry(uint16_t attempt, int retryAfter);
+  // Returns time of the next allowed request
+  std::chrono::steady_clock::time_point getNextRetry() const {
+    _worker.lock();
+    auto nextRetry = _nextRetry;
+    _worker.unlock();
+    return nextRetry;
+  }
+  // Clears count of failed write attempts after a successful write
+  void resetRetryCount() {
+    _worker.lock();
+    _retryCount = 0;
+    _worker.unlock();
+  }
+  // Marks write buffer for writing if flush ticker fired. Called by the
+  // flushing side, under _worker lock while background task runs
+  void takeFlushRequest() {
+    if (_flushRequested.exchange(false)) {
+      _writeBuffer->_write = true;
+    }
+  }
+  // Sets write options, background task must not be running
+  bool applyWriteOptions(const WriteOptions &writeOptions);
+  // Returns idle service of connection pool, creating one if the pool is not
+  // full. Returns nullptr if all connections are busy
+  HTTPService *idleService();
+  // Returns service for a synchronous request. Waits for asynchronous requests
+  // if all connections are busy, uses a temporary connection if they are
+  // reserved by query results
+  HTTPService *syncService();
+  // Closes connections idle longer than connection idle timeout
+  void closeIdleConnections();
+  // Returns true if connection should be validated before writing, according
+  // to the health check policy
+  bool needsHealthCheck() const;
+  // Records result of a request. time is millis() of the request
+  void updateHealth(bool healthy, uint32_t time);
+  // Checks precision of point and converts its timestamp if needed
+  void checkPrecisions(const Point &point);
 };
 
 #endif  //_INFLUXDB_CLIENT_H_
\ No newline at end of file
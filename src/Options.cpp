@@ -27,12 +27,23 @@
 #include <Arduino.h>
 #include "Options.h"
 #include "util/helpers.h"
+#include "util/Tags.h"
 
 WriteOptions& WriteOptions::addDefaultTag(const std::string &name, const std::string &value) { 
-    escapeKey(_defaultTags, _defaultTags.length(), name);
-    _defaultTags.push_back('=');
-    escapeKey(_defaultTags, _defaultTags.length(), value);
-    _defaultTags.push_back(',');
+    std::string key, val;
+    escapeKey(key, 0, name);
+    escapeKey(val, 0, value);
+    // keep default tags sorted by key and unique
+    TagList tags;
+    setTags(tags, _defaultTags);
+    setTag(tags, key, val);
+    _defaultTags.clear();
+    for (const auto &tag : tags) {
+        _defaultTags.append(tag.key);
+        _defaultTags.push_back('=');
+        _defaultTags.append(tag.value);
+        _defaultTags.push_back(',');
+    }
 
     return *this; 
 }
@@ -37,6 +37,19 @@ class HTTPService;
 class Influxdb;
 class Test;
 
+/**
+ * HealthCheckPolicy controls when server health is probed before writing
+ */
+enum class HealthCheckPolicy : uint8_t {
+  // Validate connection before every write
+  Always = 0,
+  // Validate connection only after a failure or when no request succeeded
+  // within the health check TTL
+  OnFailureOrIdle,
+  // Never validate connection before writing
+  Never
+};
+
 /**
  * WriteOptions holds write related options
  */
@@ -50,6 +63,9 @@ private:
     // Number of points that will be written to the databases at once. 
     // Default 1 (immediate write, no batching)
     uint16_t _batchSize;
+    // Maximum size of a write request in bytes. Batch is split if it exceeds the size.
+    // Default 0 - no limit
+    uint32_t _maxBatchBytes;
     // Write buffer size - maximum number _batchSize buffers to keep.
     // When max size is reached, oldest records are overwritten.
     // Default 5
@@ -60,20 +76,56 @@ private:
     // Default retry interval in sec, if not sent to server. Default 5s. 
     // Setting to zero disables retrying.
     std::chrono::seconds _retryInterval;
+    // Maximum retry interval in sec. Retry interval is doubled on each failed attempt up to this value.
+    // Default 300s
+    std::chrono::seconds _maxRetryInterval;
+    // Maximum number of failed write attempts, after that buffer is discarded. 
+    // Default 0 - retry until points are overwritten by new ones
+    uint16_t _maxRetryAttempts;
+    // Randomize retry interval in range 0 - current retry interval (full jitter), so devices don't retry at the same time.
+    // Default true
+    bool _retryJitter;
     // Default tags. Default tags are added to every written point. 
-    // There cannot be the same tags in the default tags and among the tags included with a point.
+    // Escaped tags sorted by key, each followed by comma. A tag of a point replaces the default tag with the same key.
     std::string _defaultTags;
     //  Let server assign timestamp in given precision. Do not sent timestamp.
     bool _useServerTimestamp;
+    // When to validate connection before writing.
+    // Default HealthCheckPolicy::OnFailureOrIdle
+    HealthCheckPolicy _healthCheckPolicy;
+    // Time since the last successful request after which connection is validated again.
+    // Default 60s
+    std::chrono::seconds _healthCheckTTL;
+    // Directory of the persistent write queue. Buffered lines are also stored there and replayed after restart.
+    // Default empty - buffer is kept only in memory
+    std::string _queueDir;
+    // Size of a persistent queue segment file in bytes.
+    // Default 16384
+    uint32_t _queueSegmentSize;
+    // Number of lines written to persistent queue after which it is flushed to storage.
+    // Default 10
+    uint16_t _queueSyncInterval;
+    // Number of measurements whose series key with default tags is cached by client.
+    // Default 8
+    uint8_t _seriesCacheSize;
 public:
  WriteOptions()
      : _writePrecision(WritePrecision::NoTime),
        _batchSize(1),
+       _maxBatchBytes(0),
        _bufferSize(5),
        _flushInterval(std::chrono::seconds{60}),
        _retryInterval(std::chrono::seconds{5}),
+       _maxRetryInterval(std::chrono::seconds{300}),
+       _maxRetryAttempts(0),
+       _retryJitter(true),
 
-       _useServerTimestamp(false) {}
+       _useServerTimestamp(false),
+       _healthCheckPolicy(HealthCheckPolicy::OnFailureOrIdle),
+       _healthCheckTTL(std::chrono::seconds{60}),
+       _queueSegmentSize(16384),
+       _queueSyncInterval(10),
+       _seriesCacheSize(8) {}
  // Sets timestamp precision. If timestamp precision is set, but a point does
  // not have a timestamp, timestamp is automatically assigned from the device
  // clock. If useServerTimestamp is set to true, timestamp is not sent, only
@@ -83,6 +135,9 @@ public:
    return *this; }
     // Sets number of points that will be written to the databases at once. Points are added one by one and when number reaches batch size there are sent to server.
     WriteOptions& batchSize(uint16_t batchSize) { _batchSize = batchSize; return *this; }
+    // Sets maximum size of a write request in bytes. Batch with more bytes is sent in several requests.
+    // Zero means no limit.
+    WriteOptions& maxBatchBytes(uint32_t maxBatchBytes) { _maxBatchBytes = maxBatchBytes; return *this; }
     // Sets size of the write buffer to control maximum number of record to keep in case of write failures.
     // When max size is reached, oldest records are overwritten.
     WriteOptions& bufferSize(uint16_t bufferSize) { _bufferSize = bufferSize; return *this; }
@@ -97,13 +152,41 @@ public:
       _retryInterval = retryIntervalSec;
       return *this;
     }
-    // Adds new default tag. Default tags are added to every written point. 
-    // There cannot be the same tag in the default tags and in the tags included with a point.
+    // Sets maximum retry interval in sec. Retry interval grows exponentially with each failed attempt up to this value.
+    // Retry-After header sent by server takes precedence.
+    WriteOptions& maxRetryInterval(std::chrono::seconds maxRetryIntervalSec) {
+      _maxRetryInterval = maxRetryIntervalSec;
+      return *this;
+    }
+    // Sets maximum number of failed write attempts, after that buffered points are discarded.
+    // Zero means retrying until points are overwritten by new ones.
+    WriteOptions& maxRetryAttempts(uint16_t maxRetryAttempts) { _maxRetryAttempts = maxRetryAttempts; return *this; }
+    // Enables randomizing of retry interval (full jitter). Prevents many devices from retrying at the same moment.
+    WriteOptions& retryJitter(bool retryJitter) { _retryJitter = retryJitter; return *this; }
+    // Adds new default tag, or replaces value of the default tag with the same name. Default tags are added to every written point. 
+    // A tag of a point replaces the default tag with the same name.
     WriteOptions& addDefaultTag(const std::string &name, const std::string &value);
     // Clears default tag list
     WriteOptions& clearDefaultTags() { _defaultTags.clear(); return *this; }
     // If timestamp precision is set and useServerTimestamp  is true, timestamp from point is not sent, or assigned.
     WriteOptions& useServerTimestamp(bool useServerTimestamp) { _useServerTimestamp = useServerTimestamp; return *this; }
+    // Sets when connection is validated before writing. See HealthCheckPolicy.
+    WriteOptions& healthCheckPolicy(HealthCheckPolicy policy) { _healthCheckPolicy = policy; return *this; }
+    // Sets time since the last successful request after which connection is validated again.
+    // Used with HealthCheckPolicy::OnFailureOrIdle.
+    WriteOptions& healthCheckTTL(std::chrono::seconds healthCheckTTL) { _healthCheckTTL = healthCheckTTL; return *this; }
+    // Enables persistent write queue in directory dir (on LittleFS on device, which must be mounted).
+    // Buffered lines are appended to segment files of segmentSize bytes, flushed to storage every syncInterval lines,
+    // and replayed into buffer when the options are set after restart. Empty dir disables the queue.
+    WriteOptions& persistentQueue(const std::string &dir, uint32_t segmentSize = 16384, uint16_t syncInterval = 10) {
+      _queueDir = dir;
+      _queueSegmentSize = segmentSize;
+      _queueSyncInterval = syncInterval;
+      return *this;
+    }
+    // Sets number of measurements whose series key, measurement joined with default tags, is kept by client
+    // for points without own tags. The least recently written measurement is replaced. Zero disables the cache.
+    WriteOptions& seriesCacheSize(uint8_t size) { _seriesCacheSize = size; return *this; }
 };
 
 /**
@@ -121,15 +204,35 @@ private:
     // Timeout [ms] for reading server response.
     // Default 5000ms  
     int _httpReadTimeout;
+    // Gzip compression level of written data, 1 (fastest) - 9 (best).
+    // Default 0 - no compression
+    uint8_t _compressionLevel;
+    // Maximum number of connections used by the client at the same time.
+    // Default 1
+    uint8_t _connectionPoolSize;
+    // Timeout [ms] after which an unused kept-alive connection is closed.
+    // Default 0 - connection is kept until server closes it
+    uint32_t _connectionIdleTimeout;
 public:
     HTTPOptions():
         _connectionReuse(false),
-        _httpReadTimeout(5000) {
+        _httpReadTimeout(5000),
+        _compressionLevel(0),
+        _connectionPoolSize(1),
+        _connectionIdleTimeout(0) {
         }
     // Set true if HTTP connection should be kept open. Usable for frequent writes.
     HTTPOptions& connectionReuse(bool connectionReuse) { _connectionReuse = connectionReuse; return *this; }
     // Sets timeout after which HTTP stops reading
     HTTPOptions& httpReadTimeout(int httpReadTimeoutMs) { _httpReadTimeout = httpReadTimeoutMs; return *this; }
+    // Sets gzip compression level of written data, 1 (fastest) - 9 (best). Zero disables compression.
+    // Data are compressed on the fly in a small window, without buffering the whole request.
+    HTTPOptions& compressionLevel(uint8_t compressionLevel) { _compressionLevel = compressionLevel > 9 ? 9 : compressionLevel; return *this; }
+    // Sets maximum number of connections used at the same time, e.g. for writing while a query result is being read
+    // or for asynchronous write and query in parallel. Additional connections are opened only when the others are busy.
+    HTTPOptions& connectionPoolSize(uint8_t connectionPoolSize) { _connectionPoolSize = connectionPoolSize ? connectionPoolSize : 1; return *this; }
+    // Sets time after which kept-alive connection, which is not used, is closed. Zero keeps connection until server closes it.
+    HTTPOptions& connectionIdleTimeout(uint32_t connectionIdleTimeoutMs) { _connectionIdleTimeout = connectionIdleTimeoutMs; return *this; }
 };
 
 #endif //_OPTIONS_H_
@@ -12,6 +12,9 @@
 #elif defined(ESP32)
 # define INFLUXDB_CLIENT_PLATFORM "ESP32"
 # define INFLUXDB_CLIENT_PLATFORM_VERSION  STR(ARDUINO_ESP32_GIT_DESC)
+#elif defined(INFLUXDB_CLIENT_HOST)
+# define INFLUXDB_CLIENT_PLATFORM "Linux"
+# define INFLUXDB_CLIENT_PLATFORM_VERSION  STR(ARDUINO_HOST_GIT_DESC)
 #endif
 
 #endif //_PLATFORM_H_
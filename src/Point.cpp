@@ -27,6 +27,11 @@
 
 #include "Point.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "util/NumberFormat.h"
 #include "util/helpers.h"
 
 Point::Point(const std::string& measurement, const size_t lineSize) {
@@ -35,12 +40,17 @@ Point::Point(const std::string& measurement, const size_t lineSize) {
   _data = std::make_shared<Data>(m, lineSize);
 }
 
+Point::Point(const PointSchema& schema, const size_t lineSize)
+    : _data(std::make_shared<Data>("", lineSize)) {
+  _data->schema = schema;
+}
+
 Point::~Point() {}
 
 Point::Data::Data(const std::string& _measurement, const size_t _lineSize)
-    : measurement(_measurement), tsWritePrecision(WritePrecision::NoTime) {
-  line.reserve(_lineSize);
-}
+    : lineSize(_lineSize),
+      measurement(_measurement),
+      tsWritePrecision(WritePrecision::NoTime) {}
 
 Point::Data::~Data() {}
 
@@ -54,20 +64,70 @@ Point& Point::operator=(const Point& other) {
 }
 
 Point& Point::addTag(const std::string& name, const std::string& value) {
-  escapeKey(_data->tags, _data->tags.length(), name);
-  escapeKey(_data->tags, _data->tags.length(), value);
-  _data->tags.push_back(',');  // add a comma and pop it off later if required
-
+  _data->setTag(name, value);
   return *this;
 }
 
+void Point::Data::setTag(const std::string& name, const std::string& value) {
+  Tag tag;
+  if (!spareTags.empty()) {
+    // reuse strings of a cleared tag
+    tag = std::move(spareTags.back());
+    spareTags.pop_back();
+    tag.key.clear();
+    tag.value.clear();
+  }
+  escapeKey(tag.key, 0, name);
+  escapeKey(tag.value, 0, value);
+  if (tags.empty()) {
+    // avoids reallocation for the usual number of tags
+    tags.reserve(4);
+  }
+  ::setTag(tags, tag);
+  seriesValid = false;
+}
+
+void Point::Data::clearTags() {
+  for (auto& tag : tags) {
+    spareTags.push_back(std::move(tag));
+  }
+  tags.clear();
+  seriesValid = false;
+}
+
+void Point::Data::reset() {
+  measurement.clear();
+  clearTags();
+  clearFields();
+  clearTime();
+  schema = PointSchema();
+}
+
+const std::string& Point::Data::seriesKey(const std::string& incTags) const {
+  if (schema.isDefined() && tags.empty()) {
+    return schema.prefix(incTags);
+  }
+  if (!schema.isDefined() && tags.empty() && incTags.empty()) {
+    return measurement;
+  }
+  if (!seriesValid || seriesTags != incTags) {
+    series = schema.isDefined() ? schema.getMeasurement() : measurement;
+    static const TagList noTags;
+    appendTags(series, incTags,
+               schema.isDefined() ? schema.getTags() : noTags, tags);
+    seriesTags = incTags;
+    seriesValid = true;
+  }
+  return series;
+}
+
 Point& Point::addField(const std::string& name, long long value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setIntField(name, value);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, unsigned long long value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setUIntField(name, value);
   return *this;
 }
 
@@ -75,158 +135,431 @@ Point& Point::addField(const std::string& name,
                        const __FlashStringHelper* pstr) {
   std::unique_ptr<char[]> buff{new char[strlen_P((PGM_P)pstr) + 1]};
   strcpy_P(buff.get(), (PGM_P)pstr);
-  _data->addField(name, buff.get());
+  _data->setStringField(name, buff.get());
   return *this;
 }
 
 Point& Point::addField(const std::string& name, float value,
                        int decimalPlaces) {
-  if (!isnan(value))
-    _data->addField(name, String(value, decimalPlaces).c_str());
+  _data->setFloatField(name, value, decimalPlaces);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, double value,
                        int decimalPlaces) {
-  if (!isnan(value))
-    _data->addField(name, String(value, decimalPlaces).c_str());
+  _data->setFloatField(name, value, decimalPlaces);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, char value) {
-  _data->addField(name, std::string{value});
+  _data->setStringField(name, std::string(1, value));
   return *this;
 }
 
 Point& Point::addField(const std::string& name, unsigned char value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setUIntField(name, value);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, int value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setIntField(name, value);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, unsigned int value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setUIntField(name, value);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, long value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setIntField(name, value);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, unsigned long value) {
-  _data->addField(name, std::to_string(value) + "i");
+  _data->setUIntField(name, value);
   return *this;
 }
 
 Point& Point::addField(const std::string& name, bool value) {
-  _data->addField(name, bool2string(value));
+  const char* str = bool2string(value);
+  _data->setField(name, str, strlen(str));
   return *this;
 }
 
 Point& Point::addField(const std::string& name, const std::string& value) {
-  _data->addField(name, value, true);
+  _data->setStringField(name, value);
   return *this;
 }
 
-void Point::Data::addField(const std::string& name, const std::string& value,
-                           const bool quote) {
-  escapeKey(fields, fields.length(), name);
-  fields.push_back('=');
-  if (quote) escapeValue(fields, fields.length(), value);
-  else fields.append(value);
-  fields.push_back(',');  // add a comma and pop it off later if required
+Point& Point::addField(const std::string& name, const char* value) {
+  _data->setStringField(name, value);
+  return *this;
 }
 
-const std::string& Point::toLineProtocol(const std::string& includeTags) {
-  return createLineProtocol(includeTags);
+Point& Point::addField(const PointSchema::Field& field, float value,
+                       int decimalPlaces) {
+  _data->setFloatField(field, value, decimalPlaces);
+  return *this;
 }
 
-const std::string& Point::createLineProtocol(const std::string& incTags,
-                                             const bool excludeTimestamp) {
-  return _data->createLineProtocol(incTags, excludeTimestamp);
+Point& Point::addField(const PointSchema::Field& field, double value,
+                       int decimalPlaces) {
+  _data->setFloatField(field, value, decimalPlaces);
+  return *this;
 }
 
-const std::string& Point::Data::createLineProtocol(
-    const std::string& incTags, const bool excludeTimestamp) {
-  line.assign(measurement);
-  if (!incTags.empty()) {
-    line.push_back(',');
-    line.append(incTags);
-    line.pop_back();  // pop off the last comma
+Point& Point::addField(const PointSchema::Field& field, int value) {
+  _data->setIntField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field, unsigned int value) {
+  _data->setUIntField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field, long value) {
+  _data->setIntField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field, unsigned long value) {
+  _data->setUIntField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field, long long value) {
+  _data->setIntField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field,
+                       unsigned long long value) {
+  _data->setUIntField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field, bool value) {
+  const char* str = bool2string(value);
+  _data->setField(field, str, strlen(str));
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field,
+                       const std::string& value) {
+  _data->setStringField(field, value);
+  return *this;
+}
+
+Point& Point::addField(const PointSchema::Field& field, const char* value) {
+  _data->setStringField(field, value);
+  return *this;
+}
+
+Point::Data::Field& Point::Data::fieldByKey(const std::string& key) {
+  fieldsValid = false;
+  for (size_t i = 0; i < fieldCount; i++) {
+    if (fieldList[i].key == key) {
+      return fieldList[i];
+    }
+  }
+  if (fieldCount == fieldList.size()) {
+    if (fieldList.empty()) {
+      // avoids reallocation for the usual number of fields
+      fieldList.reserve(4);
+    }
+    fieldList.emplace_back();
   }
+  Field& f = fieldList[fieldCount++];
+  f.key.assign(key);
+  return f;
+}
 
-  if (!tags.empty()) {
-    line.push_back(',');
-    line.append(tags);
-    line.pop_back();
+void Point::Data::removeFieldByKey(const std::string& key) {
+  for (size_t i = 0; i < fieldCount; i++) {
+    if (fieldList[i].key == key) {
+      // keeps order of other fields, strings of removed one are reused
+      std::rotate(fieldList.begin() + i, fieldList.begin() + i + 1,
+                  fieldList.begin() + fieldCount);
+      fieldCount--;
+      fieldsValid = false;
+      return;
+    }
   }
+}
+
+const std::string& Point::Data::escapedKey(const std::string& name) {
+  keyBuffer.clear();
+  escapeKey(keyBuffer, 0, name);
+  keyBuffer.push_back('=');
+  return keyBuffer;
+}
+
+Point::Data::Field& Point::Data::field(const std::string& name) {
+  return fieldByKey(escapedKey(name));
+}
+
+Point::Data::Field& Point::Data::field(const PointSchema::Field& field) {
+  return fieldByKey(field._key);
+}
+
+void Point::Data::removeField(const std::string& name) {
+  removeFieldByKey(escapedKey(name));
+}
+
+void Point::Data::removeField(const PointSchema::Field& field) {
+  removeFieldByKey(field._key);
+}
+
+template <class Key>
+void Point::Data::setField(const Key& key, const char* value, size_t length) {
+  Field& f = field(key);
+  f.kind = FieldKind::Text;
+  f.text.assign(value, length);
+  f.formatted = true;
+}
+
+template <class Key>
+void Point::Data::setStringField(const Key& key, const std::string& value) {
+  Field& f = field(key);
+  f.kind = FieldKind::Text;
+  f.text.clear();
+  escapeValue(f.text, 0, value);
+  f.formatted = true;
+}
 
-  if (!fields.empty()) {
-    line.push_back(' ');
-    line.append(fields);
-    line.pop_back();
+template <class Key>
+void Point::Data::setIntField(const Key& key, long long value) {
+  Field& f = field(key);
+  f.kind = FieldKind::Int;
+  f.value.i = value;
+  f.formatted = false;
+}
+
+template <class Key>
+void Point::Data::setUIntField(const Key& key, unsigned long long value) {
+  Field& f = field(key);
+  f.kind = FieldKind::UInt;
+  f.value.u = value;
+  f.formatted = false;
+}
+
+template <class Key>
+void Point::Data::setFloatField(const Key& key, float value,
+                                int decimalPlaces) {
+  if (!std::isfinite(value)) {
+    removeField(key);
+    return;
   }
+  Field& f = field(key);
+  f.kind = FieldKind::Float;
+  f.value.f = value;
+  f.decimalPlaces = std::max(decimalPlaces, -1);
+  f.formatted = false;
+}
 
-  if (!timeStamp.empty() && !excludeTimestamp) {
-    line.push_back(' ');
-    line.append(timeStamp);
+template <class Key>
+void Point::Data::setFloatField(const Key& key, double value,
+                                int decimalPlaces) {
+  if (!std::isfinite(value)) {
+    removeField(key);
+    return;
   }
+  Field& f = field(key);
+  f.kind = FieldKind::Double;
+  f.value.d = value;
+  f.decimalPlaces = std::max(decimalPlaces, -1);
+  f.formatted = false;
+}
+
+void Point::Data::clearFields() {
+  fieldCount = 0;
+  fieldsValid = false;
+}
 
-  line.push_back('\n');
+const std::string& Point::Data::formatFields() const {
+  if (fieldsValid) {
+    return fields;
+  }
+  fields.clear();
+  for (size_t i = 0; i < fieldCount; i++) {
+    const Field& f = fieldList[i];
+    if (!f.formatted) {
+      char buff[FloatBufferSize];
+      size_t length = 0;
+      switch (f.kind) {
+        case FieldKind::Int:
+          length = formatInt(buff, f.value.i);
+          buff[length++] = 'i';
+          break;
+        case FieldKind::UInt:
+          length = formatUInt(buff, f.value.u);
+          buff[length++] = 'i';
+          break;
+        case FieldKind::Float:
+          length = formatFloat(buff, f.value.f, f.decimalPlaces);
+          break;
+        case FieldKind::Double:
+          length = formatDouble(buff, f.value.d, f.decimalPlaces);
+          break;
+        case FieldKind::Text:
+          break;
+      }
+      f.text.assign(buff, length);
+      f.formatted = true;
+    }
+    fields.append(f.key);
+    fields.append(f.text);
+    fields.push_back(',');  // add a comma and pop it off later if required
+  }
+  fieldsValid = true;
+  return fields;
+}
+
+const std::string& Point::toLineProtocol(const std::string& includeTags) {
+  return createLineProtocol(includeTags);
+}
 
+const std::string& Point::createLineProtocol(const std::string& incTags,
+                                             const bool excludeTimestamp) {
+  return _data->createLineProtocol(incTags, excludeTimestamp);
+}
+
+// Appends written data to string
+struct StringWriter {
+  std::string& str;
+  void write(const char* data, size_t length) { str.append(data, length); }
+};
+
+const std::string& Point::Data::createLineProtocol(
+    const std::string& incTags, const bool excludeTimestamp) {
+  line.clear();
+  line.reserve(std::max(lineSize, lineProtocolLength(incTags, excludeTimestamp)));
+  StringWriter writer{line};
+  writeLineProtocol(writer, incTags, excludeTimestamp);
   return line;
 }
 
+size_t Point::Data::lineLength(const std::string& key,
+                               const bool excludeTimestamp) const {
+  // new line
+  size_t length = key.length() + 1;
+  // space replaces trailing comma of fields
+  length += formatFields().length();
+  if (timeSet && !excludeTimestamp) {
+    length += formatTime().length() + 1;
+  }
+  return length;
+}
+
 Point& Point::setTime(WritePrecision precision) {
+  _data->setTime(precision);
+  return *this;
+}
+
+void Point::Data::setTime(WritePrecision precision) {
   struct timeval tv;
   gettimeofday(&tv, NULL);
 
   switch (precision) {
     case WritePrecision::NS:
-      setTime(getTimeStamp(&tv, 9));
+      setTime(getTimeStamp(&tv, 9), precision);
       break;
     case WritePrecision::US:
-      setTime(getTimeStamp(&tv, 6));
+      setTime(getTimeStamp(&tv, 6), precision);
       break;
     case WritePrecision::MS:
-      setTime(getTimeStamp(&tv, 3));
+      setTime(getTimeStamp(&tv, 3), precision);
       break;
     case WritePrecision::S:
-      setTime(getTimeStamp(&tv, 0));
+      setTime(getTimeStamp(&tv, 0), precision);
       break;
     case WritePrecision::NoTime:
-      setTime("");
+      clearTime();
       break;
   }
-  _data->tsWritePrecision = precision;
-  return *this;
 }
 
 Point& Point::setTime(unsigned long long timestamp) {
-  return setTime(timeStampToString(timestamp));
+  _data->setTime(timestamp, WritePrecision::NoTime);
+  return *this;
+}
+
+Point& Point::setTime(unsigned long long timestamp, WritePrecision precision) {
+  _data->setTime(timestamp, precision);
+  return *this;
 }
 
 Point& Point::setTime(const std::string& timestamp) {
-  _data->setTime(timestamp);
+  const char* str = timestamp.c_str();
+  char* end = nullptr;
+  long long value = strtoll(str, &end, 10);
+  if (timestamp.empty() || *end) {
+    _data->clearTime();
+  } else {
+    _data->setTime(value, WritePrecision::NoTime);
+  }
   return *this;
 }
 
-void Point::Data::setTime(const std::string& timestamp) {
-  timeStamp.assign(timestamp);
+void Point::Data::setTime(long long timestamp, WritePrecision precision) {
+  this->timestamp = timestamp;
+  tsWritePrecision = precision;
+  timeSet = true;
+  timeStampValid = false;
+}
+
+void Point::Data::clearTime() {
+  timestamp = 0;
+  tsWritePrecision = WritePrecision::NoTime;
+  timeSet = false;
+  timeStampValid = false;
+}
+
+void Point::Data::convertTime(WritePrecision precision) {
+  if (!timeSet || tsWritePrecision == WritePrecision::NoTime ||
+      precision == WritePrecision::NoTime || precision == tsWritePrecision) {
+    return;
+  }
+  // each precision step is 1000 times finer
+  static const long long factors[] = {1LL, 1000LL, 1000000LL, 1000000000LL};
+  int diff = int(precision) - int(tsWritePrecision);
+  if (diff > 0) {
+    timestamp *= factors[diff];
+  } else {
+    long long factor = factors[-diff];
+    long long remainder = timestamp % factor;
+    timestamp /= factor;
+    // rounds towards past also for times before epoch
+    if (remainder < 0) {
+      timestamp--;
+    }
+  }
+  tsWritePrecision = precision;
+  timeStampValid = false;
+}
+
+const std::string& Point::Data::formatTime() const {
+  if (!timeStampValid) {
+    if (timeSet) {
+      char buff[IntBufferSize];
+      timeStamp.assign(buff, formatInt(buff, timestamp));
+    } else {
+      timeStamp.clear();
+    }
+    timeStampValid = true;
+  }
+  return timeStamp;
 }
 
 Point& Point::clearFields() {
-  _data->fields.clear();
-  _data->timeStamp.clear();
+  _data->clearFields();
+  _data->clearTime();
   return *this;
 }
 
 Point& Point::clearTags() {
-  _data->tags.clear();
+  _data->clearTags();
   return *this;
 }
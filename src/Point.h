@@ -31,7 +31,9 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "PointSchema.h"
 #include "WritePrecision.h"
 #include "util/helpers.h"
 
@@ -41,15 +43,25 @@
  */
 class Point {
   friend class InfluxDBClient;
+  friend class PointPool;
+  friend class Test;
 
  public:
   Point(const std::string& measurement, const size_t lineSize = 128);
+  // Creates point with measurement and fixed tags of the schema, which are
+  // written without escaping them again
+  Point(const PointSchema& schema, const size_t lineSize = 128);
   Point(const Point& other);
   Point& operator=(const Point& other);
   virtual ~Point();
-  // Adds string tag
+  // Adds string tag or replaces value of the tag with the same name
   Point& addTag(const std::string& name, const std::string& value);
-  // Add field with various types
+  // Add field with various types. Adding a field already present replaces its
+  // value. Values are formatted when line protocol is created, only fields
+  // changed since then are formatted again. Float values are rounded to
+  // decimalPlaces, negative decimalPlaces writes the shortest representation
+  // that converts back to the same value. NaN and infinity are not added and
+  // remove the field if present.
   Point& addField(const std::string& name, float value, int decimalPlaces = 2);
   Point& addField(const std::string& name, double value, int decimalPlaces = 2);
   Point& addField(const std::string& name, char value);
@@ -60,9 +72,30 @@ class Point {
   Point& addField(const std::string& name, unsigned long value);
   Point& addField(const std::string& name, bool value);
   Point& addField(const std::string& name, const std::string& value);
+  Point& addField(const std::string& name, const char* value);
   Point& addField(const std::string& name, const __FlashStringHelper* pstr);
   Point& addField(const std::string& name, long long value);
   Point& addField(const std::string& name, unsigned long long value);
+  // Add field with key escaped by a schema
+  Point& addField(const PointSchema::Field& field, float value,
+                  int decimalPlaces = 2);
+  Point& addField(const PointSchema::Field& field, double value,
+                  int decimalPlaces = 2);
+  Point& addField(const PointSchema::Field& field, int value);
+  Point& addField(const PointSchema::Field& field, unsigned int value);
+  Point& addField(const PointSchema::Field& field, long value);
+  Point& addField(const PointSchema::Field& field, unsigned long value);
+  Point& addField(const PointSchema::Field& field, long long value);
+  Point& addField(const PointSchema::Field& field, unsigned long long value);
+  Point& addField(const PointSchema::Field& field, bool value);
+  Point& addField(const PointSchema::Field& field, const std::string& value);
+  Point& addField(const PointSchema::Field& field, const char* value);
+  // Sets field of any type accepted by addField, replacing value of the
+  // field with the same key
+  template <class Key, class... Value>
+  Point& setField(const Key& key, const Value&... value) {
+    return addField(key, value...);
+  }
   // Set timestamp to `now()` and store it in specified precision, nanoseconds
   // by default. Date and time must be already set. See `configTime` in the
   // device API
@@ -70,8 +103,12 @@ class Point {
   // Set timestamp in offset since epoch (1.1.1970). Correct precision must be
   // set InfluxDBClient::setWriteOptions.
   Point& setTime(unsigned long long timestamp);
+  // Set timestamp in offset since epoch in the given precision. It is
+  // converted to the write precision of the client when written.
+  Point& setTime(unsigned long long timestamp, WritePrecision precision);
   // Set timestamp in offset since epoch (1.1.1970 00:00:00). Correct precision
-  // must be set InfluxDBClient::setWriteOptions.
+  // must be set InfluxDBClient::setWriteOptions. A string that is not an
+  // integer clears the timestamp.
   Point& setTime(const std::string& timestamp);
 
   // Clear all fields. Useful for reusing point
@@ -82,7 +119,7 @@ class Point {
 
   // True if a point contains at least one field. Points without a field cannot
   // be written to db
-  bool hasFields() const { return !_data->fields.empty(); }
+  bool hasFields() const { return _data->hasFields(); }
 
   // True if a point contains at least one tag
   bool hasTags() const { return !_data->tags.empty(); }
@@ -93,28 +130,169 @@ class Point {
   // Creates line protocol with optionally added tags
   const std::string& toLineProtocol(const std::string& includeTags = "");
 
-  // returns current timestamp
-  std::string& getTime() const { return _data->timeStamp; }
+  // returns current timestamp formatted as in line protocol
+  const std::string& getTime() const { return _data->formatTime(); }
+  // returns current timestamp, in precision set by setTime
+  long long getTimestamp() const { return _data->timestamp; }
 
  protected:
   class Data {
    private:
     std::string line;
+    // Initial capacity of line, reserved on first use
+    size_t lineSize;
+    // Kind of field value
+    enum class FieldKind : uint8_t { Int, UInt, Float, Double, Text };
+    // Field with its value, formatted when line protocol is created
+    struct Field {
+      // escaped key followed by '='
+      std::string key;
+      // formatted value, Text values are formatted when set
+      mutable std::string text;
+      mutable bool formatted;
+      FieldKind kind;
+      int8_t decimalPlaces;
+      union {
+        long long i;
+        unsigned long long u;
+        float f;
+        double d;
+      } value;
+    };
+    // Fields in order of adding. Entries after fieldCount are cleared, their
+    // strings are reused by new fields
+    std::vector<Field> fieldList;
+    size_t fieldCount = 0;
+    // Escaped key of field being set
+    std::string keyBuffer;
+    // Cached formatted fields, each followed by comma
+    mutable std::string fields;
+    mutable bool fieldsValid = false;
+    // Returns field with escaped key followed by '=', added if not present
+    Field& fieldByKey(const std::string& key);
+    void removeFieldByKey(const std::string& key);
+    // Escapes name into keyBuffer and appends '='
+    const std::string& escapedKey(const std::string& name);
+    // Cached formatted timestamp
+    mutable std::string timeStamp;
+    mutable bool timeStampValid = false;
+    // Cached series key, measurement and tags merged with default tags
+    mutable std::string series;
+    // Default tags the series was merged with
+    mutable std::string seriesTags;
+    mutable bool seriesValid = false;
 
    public:
     Data(const std::string& _measurement, const size_t lineSize);
     ~Data();
-    std::string measurement, tags, fields, timeStamp;
+    std::string measurement;
+    // Timestamp in tsWritePrecision. With NoTime precision it is written as
+    // set, in precision of the client
+    long long timestamp = 0;
+    bool timeSet = false;
+    // Escaped tags sorted by key
+    TagList tags;
+    // Cleared tags, whose strings are reused by new tags
+    TagList spareTags;
     WritePrecision tsWritePrecision;
-    void addField(const std::string& name, const std::string& value,
-                  const bool quote = false);
-    void setTime(const std::string& timestamp);
-    bool hasTime() const { return !timeStamp.empty(); }
+    // Schema providing measurement and fixed tags, if set
+    PointSchema schema;
+    // Returns field with the key, added if not present. Value must be set.
+    Field& field(const std::string& name);
+    Field& field(const PointSchema::Field& field);
+    // Removes field with the key
+    void removeField(const std::string& name);
+    void removeField(const PointSchema::Field& field);
+    // Sets field with unquoted value of given length. Key is either a name or
+    // a schema field
+    template <class Key>
+    void setField(const Key& key, const char* value, size_t length);
+    // Sets field with quoted and escaped string value
+    template <class Key>
+    void setStringField(const Key& key, const std::string& value);
+    // Sets integer field
+    template <class Key>
+    void setIntField(const Key& key, long long value);
+    template <class Key>
+    void setUIntField(const Key& key, unsigned long long value);
+    // Sets float or double field, removes it for NaN and infinity
+    template <class Key>
+    void setFloatField(const Key& key, float value, int decimalPlaces);
+    template <class Key>
+    void setFloatField(const Key& key, double value, int decimalPlaces);
+    bool hasFields() const { return fieldCount > 0; }
+    void clearFields();
+    // Returns formatted fields, each followed by comma. Only fields changed
+    // since the last call are formatted.
+    const std::string& formatFields() const;
+    void setTime(long long timestamp, WritePrecision precision);
+    // Sets current time in the precision, clears time for NoTime
+    void setTime(WritePrecision precision);
+    void clearTime();
+    // Converts timestamp to the precision by integer arithmetic. Timestamp
+    // without precision is kept as it is.
+    void convertTime(WritePrecision precision);
+    // Returns formatted timestamp, empty if not set
+    const std::string& formatTime() const;
+    void setTag(const std::string& name, const std::string& value);
+    void clearTags();
+    // Clears all data, keeping allocated memory
+    void reset();
+    // Preallocates formatted fields for pooled points
+    void reserveFields(size_t size) { fields.reserve(size); }
+    // Returns canonical series key: measurement and tags merged with default
+    // tags, sorted by key and without duplicates. Tags of the point replace
+    // default tags. incTags is a list of escaped tags, each followed by comma.
+    // The key is cached until tags or default tags change.
+    const std::string& seriesKey(const std::string& incTags) const;
+    bool hasTime() const { return timeSet; }
+    // True if point has neither tags nor schema, so its series key is the
+    // measurement joined with default tags
+    bool hasPlainSeries() const { return tags.empty() && !schema.isDefined(); }
     const std::string& createLineProtocol(const std::string& incTags,
                                           const bool excludeTimestamp = false);
+    // Returns length of line protocol, including new line, written by
+    // writeLineProtocol
+    size_t lineProtocolLength(const std::string& incTags,
+                              const bool excludeTimestamp = false) const {
+      return lineLength(seriesKey(incTags), excludeTimestamp);
+    }
+    // Writes line protocol, ended by new line, part by part to writer, which
+    // must have method write(const char *data, size_t length). incTags is a
+    // list of escaped tags, each followed by comma.
+    template <class Writer>
+    void writeLineProtocol(Writer& writer, const std::string& incTags,
+                           const bool excludeTimestamp = false) const {
+      writeLine(writer, seriesKey(incTags), excludeTimestamp);
+    }
+    // Returns length of line with the series key, as written by writeLine
+    size_t lineLength(const std::string& key,
+                      const bool excludeTimestamp = false) const;
+    // Writes line protocol with the series key, resolved by caller
+    template <class Writer>
+    void writeLine(Writer& writer, const std::string& key,
+                   const bool excludeTimestamp = false) const {
+      writer.write(key.data(), key.length());
+      const std::string& fields = formatFields();
+      if (!fields.empty()) {
+        writer.write(" ", 1);
+        writer.write(fields.data(), fields.length() - 1);
+      }
+      if (timeSet && !excludeTimestamp) {
+        const std::string& time = formatTime();
+        writer.write(" ", 1);
+        writer.write(time.data(), time.length());
+      }
+      writer.write("\n", 1);
+    }
+    // Returns reserved size of line
+    size_t getLineSize() const { return lineSize; }
   };
   std::shared_ptr<Data> _data;
 
+  // Creates point using existing data
+  Point(const std::shared_ptr<Data>& data) : _data(data) {}
+
  protected:
   // Creates line protocol string
   const std::string& createLineProtocol(const std::string& incTags,
@@ -0,0 +1,71 @@
+/**
+ *
+ * PointPool.cpp: Pool of points reusing their memory
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "PointPool.h"
+
+PointPool::PointPool(size_t size, size_t lineSize) : _lineSize(lineSize) {
+  _points.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    _points.push_back(std::make_shared<Point::Data>("", lineSize));
+    _points.back()->reserveFields(lineSize);
+  }
+}
+
+std::shared_ptr<Point::Data>& PointPool::next() {
+  // data referenced only by the pool are free
+  for (size_t i = 0; i < _points.size(); i++) {
+    auto& data = _points[(_next + i) % _points.size()];
+    if (data.use_count() == 1) {
+      _next = (_next + i + 1) % _points.size();
+      data->reset();
+      return data;
+    }
+  }
+  _points.push_back(std::make_shared<Point::Data>("", _lineSize));
+  _points.back()->reserveFields(_lineSize);
+  _next = 0;
+  return _points.back();
+}
+
+Point PointPool::acquire(const std::string& measurement) {
+  auto& data = next();
+  escapeKey(data->measurement, 0, measurement, false);
+  return Point(data);
+}
+
+Point PointPool::acquire(const PointSchema& schema) {
+  auto& data = next();
+  data->schema = schema;
+  return Point(data);
+}
+
+size_t PointPool::used() const {
+  size_t count = 0;
+  for (auto& data : _points) {
+    count += data.use_count() > 1;
+  }
+  return count;
+}
@@ -0,0 +1,70 @@
+/**
+ *
+ * PointPool.h: Pool of points reusing their memory
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _POINT_POOL_H_
+#define _POINT_POOL_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Point.h"
+
+/**
+ * PointPool keeps data of points, including their strings, allocated and
+ * recycles them. A point acquired from the pool is returned to it when the
+ * point and all its copies are destroyed. Points written repeatedly from the
+ * pool, with names short enough for the small string optimization or defined
+ * by a PointSchema, don't allocate memory once the pool is warmed up.
+ * Pool is not thread safe, points must be acquired and released by the same
+ * task.
+ */
+class PointPool {
+  friend class Test;
+
+ public:
+  // Creates pool of size points, each reserving lineSize for line protocol
+  PointPool(size_t size, size_t lineSize = 128);
+  // Returns cleared point with measurement. If all points are in use, the
+  // pool grows.
+  Point acquire(const std::string& measurement);
+  // Returns cleared point with measurement and tags of schema
+  Point acquire(const PointSchema& schema);
+  // Returns number of points, both free and in use
+  size_t size() const { return _points.size(); }
+  // Returns number of points in use
+  size_t used() const;
+
+ private:
+  // Returns cleared free data
+  std::shared_ptr<Point::Data>& next();
+  std::vector<std::shared_ptr<Point::Data>> _points;
+  size_t _lineSize;
+  // Position where search for a free point starts
+  size_t _next = 0;
+};
+
+#endif  //_POINT_POOL_H_
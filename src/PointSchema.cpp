@@ -0,0 +1,66 @@
+/**
+ *
+ * PointSchema.cpp: Measurement, tags and field keys escaped once for many points
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "PointSchema.h"
+
+#include "util/helpers.h"
+
+PointSchema::PointSchema(const std::string& measurement)
+    : _data(std::make_shared<Data>()) {
+  escapeKey(_data->measurement, 0, measurement, false);
+  _data->series = _data->measurement;
+}
+
+PointSchema& PointSchema::addTag(const std::string& name,
+                                 const std::string& value) {
+  std::string key, val;
+  escapeKey(key, 0, name);
+  escapeKey(val, 0, value);
+  setTag(_data->tags, key, val);
+  _data->series = _data->measurement;
+  appendTags(_data->series, _data->tags);
+  _data->prefixTags.clear();
+  return *this;
+}
+
+PointSchema::Field PointSchema::field(const std::string& name) const {
+  std::string key;
+  escapeKey(key, 0, name);
+  key.push_back('=');
+  return Field(key);
+}
+
+const std::string& PointSchema::prefix(const std::string& defaultTags) const {
+  if (defaultTags.empty()) {
+    return _data->series;
+  }
+  if (_data->prefixTags != defaultTags) {
+    _data->prefix = _data->measurement;
+    appendTags(_data->prefix, defaultTags, _data->tags, TagList());
+    _data->prefixTags = defaultTags;
+  }
+  return _data->prefix;
+}
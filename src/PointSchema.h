@@ -0,0 +1,99 @@
+/**
+ *
+ * PointSchema.h: Measurement, tags and field keys escaped once for many points
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _POINT_SCHEMA_H_
+#define _POINT_SCHEMA_H_
+
+#include <memory>
+#include <string>
+
+#include "util/Tags.h"
+
+class Point;
+class Test;
+
+/**
+ * PointSchema defines the measurement, the fixed tags and the field keys of a
+ * series written repeatedly. They are escaped once, when the schema is
+ * defined, so points created from the schema only format field values and
+ * timestamp. The schema should be fully defined before points are created
+ * from it. It can be shared by points, but not by threads.
+ */
+class PointSchema {
+  friend class Point;
+  friend class Test;
+
+ public:
+  // Field key escaped by the schema
+  class Field {
+    friend class Point;
+    friend class PointSchema;
+
+   public:
+    Field() {}
+    const std::string& getKey() const { return _key; }
+
+   private:
+    Field(const std::string& key) : _key(key) {}
+    // escaped key followed by '='
+    std::string _key;
+  };
+
+  PointSchema(const std::string& measurement);
+  // Adds fixed tag or replaces value of the tag with the same name
+  PointSchema& addTag(const std::string& name, const std::string& value);
+  // Escapes field key. Use the returned field for adding values to points
+  Field field(const std::string& name) const;
+  // Returns escaped measurement and tags sorted by key
+  const std::string& getSeries() const { return _data->series; }
+  // Returns series merged with escaped default tags, each followed by comma.
+  // Fixed tags replace default tags with the same key. The result is cached
+  // until called with different default tags.
+  const std::string& prefix(const std::string& defaultTags) const;
+  // Returns escaped measurement
+  const std::string& getMeasurement() const { return _data->measurement; }
+  // Returns fixed tags
+  const TagList& getTags() const { return _data->tags; }
+
+ private:
+  // Schema not defined, used by points without schema
+  PointSchema() {}
+  bool isDefined() const { return _data != nullptr; }
+
+  struct Data {
+    std::string measurement;
+    TagList tags;
+    // escaped measurement and sorted fixed tags
+    std::string series;
+    // series merged with default tags
+    std::string prefix;
+    // default tags the prefix was merged with, empty if prefix is not valid
+    std::string prefixTags;
+  };
+  std::shared_ptr<Data> _data;
+};
+
+#endif  //_POINT_SCHEMA_H_
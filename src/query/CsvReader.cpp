@@ -60,7 +60,7 @@ bool CsvReader::next() {
          return false;
      }
     CsvParsingState state = CsvParsingState::UnquotedField;
-    std::vector<std::string> fields {};
+    std::vector<std::string> fields {""};
     size_t i = 0; // index of the current field
     for (auto& c : _scanner->getLine()) {
          switch (state) {
@@ -93,10 +93,7 @@ void FluxQueryResult::clearValues() {
 }
 
 void FluxQueryResult::clearColumns() {
-    std::for_each(_data->_columnNames.begin(), _data->_columnNames.end(), [](std::string &value){ value = (const char *)nullptr; });
     _data->_columnNames.clear();
-
-    std::for_each(_data->_columnDatatypes.begin(), _data->_columnDatatypes.end(), [](std::string &value){ value = (const char *)nullptr; });
     _data->_columnDatatypes.clear();
 }
 
@@ -27,6 +27,7 @@
 
 #include "FluxTypes.h"
 #include "util/helpers.h"
+#include "util/NumberFormat.h"
 
 const char	*FluxDatatypeString     = "string";
 const char	*FluxDatatypeDouble     = "double";
@@ -51,10 +52,10 @@ const char *FluxLong::getType() {
 }
 
 char *FluxLong::jsonString() {
-    int len  =_rawValue.length()+3+getNumLength(value)+2;
+    int len  =_rawValue.length()+3+getNumLength(value);
     char *json = new char[len+1];
-    snprintf_P(json, len, PSTR(R"("%s":%ld)"), _rawValue.c_str(),
-               value);
+    int prefix = snprintf_P(json, len+1, PSTR(R"("%s":)"), _rawValue.c_str());
+    json[prefix + formatInt(json + prefix, value)] = 0;
     return json;
 }
 
@@ -67,9 +68,10 @@ const char *FluxUnsignedLong::getType() {
 }
 
 char *FluxUnsignedLong::jsonString() {
-  int len  =_rawValue.length()+3+getNumLength(value)+2;
+  int len  =_rawValue.length()+3+countDigits(value);
   char *json = new char[len+1];
-  snprintf_P(json, len, PSTR(R"("%s":%lu)"), _rawValue.c_str(), value);
+  int prefix = snprintf_P(json, len+1, PSTR(R"("%s":)"), _rawValue.c_str());
+  json[prefix + formatUInt(json + prefix, value)] = 0;
   return json;
 }
 
@@ -31,8 +31,10 @@
 #include "util/debug.h"
 #include "util/helpers.h"
 
-HttpStreamScanner::HttpStreamScanner(HTTPClient *client, bool chunked)
+HttpStreamScanner::HttpStreamScanner(HTTPClient *client, bool chunked,
+                                     std::shared_ptr<void> lease)
     : _client(client),
+      _lease(lease),
       _stream(client->getStreamPtr()),
       _len(client->getSize()),
       _chunked(chunked),
@@ -41,8 +43,27 @@ HttpStreamScanner::HttpStreamScanner(HTTPClient *client, bool chunked)
                         bool2string(_chunked), _len);
 }
 
+HttpStreamScanner::HttpStreamScanner(WiFiClient *connection, int len,
+                                     bool chunked, bool keepAlive,
+                                     std::shared_ptr<void> lease)
+    : _client(nullptr),
+      _connection(connection),
+      _keepAlive(keepAlive),
+      _lease(lease),
+      _stream(connection),
+      _len(len),
+      _chunked(chunked),
+      _chunkHeader(chunked) {
+  INFLUXDB_CLIENT_DEBUG("[D] HttpStreamScanner: chunked: %s, size: %d\n",
+                        bool2string(_chunked), _len);
+}
+
+bool HttpStreamScanner::connected() {
+  return _client ? _client->connected() : _connection->connected();
+}
+
 bool HttpStreamScanner::next() {
-    while(_client->connected() && (_len > 0 || _len == -1)) {
+    while(connected() && (_len > 0 || _len == -1)) {
         _line = _stream->readStringUntil('\n').c_str();
         INFLUXDB_CLIENT_DEBUG("[D] HttpStreamScanner: line: %s\n", _line.c_str());
         ++_linesNum;
@@ -75,6 +96,10 @@ bool HttpStreamScanner::next() {
             if(_chunkLen == 0) { //last chunk
                 _error = 0;
                 _line.clear();
+                if(_connection && !_ended) { //empty line after the last chunk
+                    _stream->readStringUntil('\n');
+                    _ended = true;
+                }
                 return false;
             } else {
                 continue;
@@ -88,10 +113,11 @@ bool HttpStreamScanner::next() {
         if(_len > 0) {
             _len -= r;
             INFLUXDB_CLIENT_DEBUG("[D] HttpStreamScanner new len: %d\n", _len);
+            _ended = _len == 0;
         }
         return true;
     }
-    if(!_client->connected() && ( (_chunked && _chunkLen > 0) || (!_chunked && _len > 0))) { //report error only if we didn't went to 
+    if(!connected() && ( (_chunked && _chunkLen > 0) || (!_chunked && _len > 0))) { //report error only if we didn't went to 
         _error = HTTPC_ERROR_CONNECTION_LOST;
         INFLUXDB_CLIENT_DEBUG("HttpStreamScanner connection lost\n");
     } 
@@ -99,5 +125,10 @@ bool HttpStreamScanner::next() {
 }
 
 void HttpStreamScanner::close() {
-    _client->end();
+    if(_client) {
+        _client->end();
+    } else if(!_keepAlive || !_ended) {
+        _connection->stop();
+    }
+    _lease.reset();
 }
\ No newline at end of file
@@ -29,10 +29,11 @@
 
 #if defined(ESP8266)
 # include <ESP8266HTTPClient.h>
-#elif defined(ESP32)
+#elif defined(ESP32) || defined(INFLUXDB_CLIENT_HOST)
 # include <HTTPClient.h>
 #endif //ESP8266
 
+#include <memory>
 #include <string>
 
 /** 
@@ -43,14 +44,25 @@
  */ 
 class HttpStreamScanner {
 public:
-    HttpStreamScanner(HTTPClient *client, bool chunked);
+    // lease, if set, keeps connection reserved until close or deletion
+    HttpStreamScanner(HTTPClient *client, bool chunked, std::shared_ptr<void> lease = nullptr);
+    // Scans response body of len bytes (-1 if unknown) read directly from connection.
+    // On close, connection is kept open only if keepAlive and the body was read completely
+    HttpStreamScanner(WiFiClient *connection, int len, bool chunked, bool keepAlive, std::shared_ptr<void> lease = nullptr);
     bool next();
     void close();
     std::string getLine() const { return _line; };
     int getError() const { return _error; }
     int getLinesNum() const {return _linesNum; }
 private:
+    bool connected();
     HTTPClient *_client;
+    WiFiClient *_connection = nullptr;
+    bool _keepAlive = false;
+    // Reservation of connection, released on close
+    std::shared_ptr<void> _lease;
+    // Whole body was read
+    bool _ended = false;
     Stream *_stream = nullptr;
     int _len;
     bool _chunked;
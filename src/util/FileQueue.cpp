@@ -0,0 +1,483 @@
+/**
+ *
+ * FileQueue.cpp: Durable queue of lines in segment files
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "FileQueue.h"
+
+#include "debug.h"
+#include "helpers.h"
+
+#if defined(INFLUXDB_CLIENT_HOST)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FILE_QUEUE_POSIX
+#elif defined(ESP8266) || \
+    (defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2)
+#include <LittleFS.h>
+#define FILE_QUEUE_LITTLEFS
+#endif
+
+#include <algorithm>
+#include <vector>
+
+static const char SegmentSuffix[] = ".q";
+// Size of record length and CRC
+static const uint32_t RecordOverhead = 8;
+// Size of cursor slot: generation, segment, offset, CRC
+static const uint32_t CursorSize = 16;
+
+static void putLE32(uint8_t *buf, uint32_t value) {
+  buf[0] = value;
+  buf[1] = value >> 8;
+  buf[2] = value >> 16;
+  buf[3] = value >> 24;
+}
+
+static uint32_t getLE32(const uint8_t *buf) {
+  return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+/**
+ * QueueFile is a minimal file API over LittleFS or POSIX stdio.
+ **/
+class QueueFile {
+ public:
+  ~QueueFile() { close(); }
+  // mode - "r", "w" or "a"
+  bool open(const std::string &path, const char *mode);
+  size_t read(uint8_t *buf, size_t len);
+  size_t write(const uint8_t *buf, size_t len);
+  size_t size();
+  // Flushes written data to storage
+  bool sync();
+  void close();
+  static bool exists(const std::string &path);
+  static bool mkdir(const std::string &path);
+  static bool remove(const std::string &path);
+  // Makes created and deleted files of the directory durable
+  static void syncDir(const std::string &path);
+  // Calls callback for each file name in the directory
+  static void list(const std::string &path,
+                   std::function<void(const char *name)> callback);
+
+ private:
+#if defined(FILE_QUEUE_LITTLEFS)
+  File _file;
+#elif defined(FILE_QUEUE_POSIX)
+  FILE *_file = nullptr;
+#endif
+};
+
+#if defined(FILE_QUEUE_LITTLEFS)
+
+bool QueueFile::open(const std::string &path, const char *mode) {
+  _file = LittleFS.open(path.c_str(), mode);
+  return (bool)_file;
+}
+
+size_t QueueFile::read(uint8_t *buf, size_t len) {
+  return _file.read(buf, len);
+}
+
+size_t QueueFile::write(const uint8_t *buf, size_t len) {
+  return _file.write(buf, len);
+}
+
+size_t QueueFile::size() { return _file.size(); }
+
+bool QueueFile::sync() {
+  // commits LittleFS file, data survive power loss
+  _file.flush();
+  return true;
+}
+
+void QueueFile::close() {
+  if (_file) {
+    _file.close();
+  }
+}
+
+bool QueueFile::exists(const std::string &path) {
+  return LittleFS.exists(path.c_str());
+}
+
+bool QueueFile::mkdir(const std::string &path) {
+  return LittleFS.mkdir(path.c_str());
+}
+
+bool QueueFile::remove(const std::string &path) {
+  return LittleFS.remove(path.c_str());
+}
+
+void QueueFile::syncDir(const std::string &) {}
+
+void QueueFile::list(const std::string &path,
+                     std::function<void(const char *name)> callback) {
+  File dir = LittleFS.open(path.c_str(), "r");
+  if (!dir || !dir.isDirectory()) {
+    return;
+  }
+  File file = dir.openNextFile();
+  while (file) {
+    // older cores return full path
+    const char *name = file.name();
+    const char *slash = strrchr(name, '/');
+    callback(slash ? slash + 1 : name);
+    file = dir.openNextFile();
+  }
+}
+
+#elif defined(FILE_QUEUE_POSIX)
+
+bool QueueFile::open(const std::string &path, const char *mode) {
+  const char *m = mode[0] == 'r' ? "rb" : mode[0] == 'w' ? "wb" : "ab";
+  _file = fopen(path.c_str(), m);
+  return _file != nullptr;
+}
+
+size_t QueueFile::read(uint8_t *buf, size_t len) {
+  return fread(buf, 1, len, _file);
+}
+
+size_t QueueFile::write(const uint8_t *buf, size_t len) {
+  return fwrite(buf, 1, len, _file);
+}
+
+size_t QueueFile::size() {
+  struct stat st;
+  fflush(_file);
+  return fstat(fileno(_file), &st) == 0 ? st.st_size : 0;
+}
+
+bool QueueFile::sync() {
+  return fflush(_file) == 0 && fsync(fileno(_file)) == 0;
+}
+
+void QueueFile::close() {
+  if (_file) {
+    fclose(_file);
+    _file = nullptr;
+  }
+}
+
+bool QueueFile::exists(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0;
+}
+
+bool QueueFile::mkdir(const std::string &path) {
+  return ::mkdir(path.c_str(), 0755) == 0;
+}
+
+bool QueueFile::remove(const std::string &path) {
+  return ::remove(path.c_str()) == 0;
+}
+
+void QueueFile::syncDir(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    fsync(fd);
+    ::close(fd);
+  }
+}
+
+void QueueFile::list(const std::string &path,
+                     std::function<void(const char *name)> callback) {
+  DIR *dir = opendir(path.c_str());
+  if (!dir) {
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    callback(entry->d_name);
+  }
+  closedir(dir);
+}
+
+#else  // no filesystem
+
+bool QueueFile::open(const std::string &, const char *) { return false; }
+size_t QueueFile::read(uint8_t *, size_t) { return 0; }
+size_t QueueFile::write(const uint8_t *, size_t) { return 0; }
+size_t QueueFile::size() { return 0; }
+bool QueueFile::sync() { return false; }
+void QueueFile::close() {}
+bool QueueFile::exists(const std::string &) { return false; }
+bool QueueFile::mkdir(const std::string &) { return false; }
+bool QueueFile::remove(const std::string &) { return false; }
+void QueueFile::syncDir(const std::string &) {}
+void QueueFile::list(const std::string &,
+                     std::function<void(const char *name)>) {}
+
+#endif
+
+FileQueue::FileQueue(const std::string &dir, uint32_t segmentSize,
+                     uint16_t syncInterval)
+    : _dir(dir), _segmentSize(segmentSize), _syncInterval(syncInterval) {
+  if (endsWith(_dir, "/")) {
+    _dir.erase(_dir.length() - 1);
+  }
+}
+
+FileQueue::~FileQueue() {
+  if (_opened) {
+    sync();
+  }
+}
+
+std::string FileQueue::segmentPath(uint32_t seq) const {
+  char name[16];
+  snprintf(name, sizeof(name), "/%08x", (unsigned int)seq);
+  return _dir + name + SegmentSuffix;
+}
+
+bool FileQueue::open(ReplayCallback callback) {
+  if (!QueueFile::exists(_dir) && !QueueFile::mkdir(_dir)) {
+    INFLUXDB_CLIENT_DEBUG("[E] Cannot create queue directory %s\n",
+                          _dir.c_str());
+    return false;
+  }
+  _opened = true;
+  uint32_t cursorSeq = 0, cursorOffset = 0;
+  readCursor(cursorSeq, cursorOffset);
+  std::vector<uint32_t> seqs;
+  QueueFile::list(_dir, [&seqs](const char *name) {
+    if (endsWith(name, SegmentSuffix)) {
+      seqs.push_back(strtoul(name, nullptr, 16));
+    }
+  });
+  std::sort(seqs.begin(), seqs.end());
+  _nextSeq = cursorSeq;
+  for (auto seq : seqs) {
+    _nextSeq = std::max(_nextSeq, seq + 1);
+    uint32_t records = 0;
+    if (seq >= cursorSeq) {
+      const uint32_t offset = seq == cursorSeq ? cursorOffset : 0;
+      if (_segments.empty()) {
+        _headOffset = offset;
+      }
+      records = replaySegment(seq, offset, callback);
+    }
+    if (records > 0) {
+      _segments.push_back(Segment{seq, records});
+    } else {
+      // fully removed or damaged segment
+      QueueFile::remove(segmentPath(seq));
+    }
+  }
+  INFLUXDB_CLIENT_DEBUG("[D] Queue %s: replayed %d records\n", _dir.c_str(),
+                        size());
+  return true;
+}
+
+uint32_t FileQueue::replaySegment(uint32_t seq, uint32_t offset,
+                                  ReplayCallback &callback) {
+  QueueFile file;
+  if (!file.open(segmentPath(seq), "r")) {
+    return 0;
+  }
+  uint32_t left = file.size();
+  uint8_t buf[4];
+  // skip removed records
+  while (offset > 0 && left > 0) {
+    size_t n = file.read(buf, std::min<uint32_t>(offset, sizeof(buf)));
+    if (n == 0) {
+      return 0;
+    }
+    offset -= n;
+    left -= n;
+  }
+  uint32_t records = 0;
+  std::unique_ptr<char[]> data;
+  uint32_t dataSize = 0;
+  while (left >= RecordOverhead) {
+    if (file.read(buf, 4) != 4) {
+      break;
+    }
+    const uint32_t length = getLE32(buf);
+    if (length > left - RecordOverhead) {
+      // torn record
+      break;
+    }
+    if (length > dataSize) {
+      data.reset(new char[length]);
+      dataSize = length;
+    }
+    if (file.read((uint8_t *)data.get(), length) != length ||
+        file.read(buf, 4) != 4 ||
+        getLE32(buf) != updateCrc32(0, (const uint8_t *)data.get(), length)) {
+      INFLUXDB_CLIENT_DEBUG("[W] Damaged record in queue segment %x\n", seq);
+      break;
+    }
+    left -= length + RecordOverhead;
+    _records.push_back(length + RecordOverhead);
+    records++;
+    callback(data.get(), length);
+  }
+  return records;
+}
+
+bool FileQueue::readCursor(uint32_t &seq, uint32_t &offset) {
+  bool found = false;
+  for (int slot = 0; slot < 2; slot++) {
+    QueueFile file;
+    uint8_t buf[CursorSize];
+    if (!file.open(_dir + (slot ? "/head1" : "/head0"), "r") ||
+        file.read(buf, CursorSize) != CursorSize ||
+        getLE32(buf + 12) != updateCrc32(0, buf, 12)) {
+      continue;
+    }
+    const uint32_t gen = getLE32(buf);
+    if (!found || gen > _cursorGen) {
+      _cursorGen = gen;
+      seq = getLE32(buf + 4);
+      offset = getLE32(buf + 8);
+      found = true;
+    }
+  }
+  return found;
+}
+
+bool FileQueue::writeCursor() {
+  uint8_t buf[CursorSize];
+  _cursorGen++;
+  putLE32(buf, _cursorGen);
+  putLE32(buf + 4, _segments.empty() ? _nextSeq : _segments.front().seq);
+  putLE32(buf + 8, _headOffset);
+  putLE32(buf + 12, updateCrc32(0, buf, 12));
+  _unsyncedPops = 0;
+  // slot with the older cursor is overwritten, a torn write leaves the other
+  QueueFile file;
+  return file.open(_dir + ((_cursorGen & 1) ? "/head1" : "/head0"), "w") &&
+         file.write(buf, CursorSize) == CursorSize && file.sync();
+}
+
+bool FileQueue::startSegment() {
+  _file.reset(new QueueFile);
+  if (!_file->open(segmentPath(_nextSeq), "a")) {
+    INFLUXDB_CLIENT_DEBUG("[E] Cannot create queue segment %x\n", _nextSeq);
+    _file.reset();
+    return false;
+  }
+  QueueFile::syncDir(_dir);
+  _segments.push_back(Segment{_nextSeq++, 0});
+  _fileSize = 0;
+  return true;
+}
+
+bool FileQueue::beginRecord(size_t length) {
+  if (!_opened) {
+    return false;
+  }
+  if (_file && _fileSize > 0 && _fileSize + length > _segmentSize) {
+    if (!sync()) {
+      return false;
+    }
+    _file.reset();
+  }
+  if (!_file && !startSegment()) {
+    return false;
+  }
+  uint8_t buf[4];
+  putLE32(buf, length);
+  _recordLeft = length;
+  _recordSize = length + RecordOverhead;
+  _recordCrc = 0;
+  return _file->write(buf, 4) == 4;
+}
+
+bool FileQueue::write(const char *data, size_t length) {
+  if (!_file || length > _recordLeft) {
+    return false;
+  }
+  _recordCrc = updateCrc32(_recordCrc, (const uint8_t *)data, length);
+  _recordLeft -= length;
+  return _file->write((const uint8_t *)data, length) == length;
+}
+
+bool FileQueue::endRecord() {
+  if (!_file || _recordLeft > 0) {
+    return false;
+  }
+  uint8_t buf[4];
+  putLE32(buf, _recordCrc);
+  if (_file->write(buf, 4) != 4) {
+    return false;
+  }
+  _fileSize += _recordSize;
+  _records.push_back(_recordSize);
+  _segments.back().records++;
+  if (++_unsynced >= _syncInterval) {
+    return sync();
+  }
+  return true;
+}
+
+bool FileQueue::pop(uint32_t count) {
+  count = std::min(count, size());
+  if (count == 0) {
+    return true;
+  }
+  std::vector<uint32_t> removed;
+  _unsyncedPops = std::min<uint32_t>(_unsyncedPops + count, UINT16_MAX);
+  while (count-- > 0) {
+    _headOffset += _records.front();
+    _records.pop_front();
+    if (--_segments.front().records == 0) {
+      removed.push_back(_segments.front().seq);
+      if (_file && _segments.size() == 1) {
+        _file.reset();
+        _unsynced = 0;
+      }
+      _segments.pop_front();
+      _headOffset = 0;
+    }
+  }
+  // cursor is kept in memory until sync. A stale cursor only replays removed
+  // records again, but it must not point to a deleted segment
+  if (removed.empty() && _unsyncedPops < _syncInterval) {
+    return true;
+  }
+  // cursor first, segments left by a crash in between are removed on open
+  bool res = writeCursor();
+  for (auto seq : removed) {
+    QueueFile::remove(segmentPath(seq));
+  }
+  return res;
+}
+
+bool FileQueue::sync() {
+  bool res = true;
+  if (_file && _unsynced > 0) {
+    _unsynced = 0;
+    res = _file->sync();
+  }
+  if (_unsyncedPops > 0) {
+    res = writeCursor() && res;
+  }
+  return res;
+}
@@ -0,0 +1,138 @@
+/**
+ *
+ * FileQueue.h: Durable queue of lines in segment files
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _INFLUXDB_CLIENT_FILE_QUEUE_H_
+#define _INFLUXDB_CLIENT_FILE_QUEUE_H_
+
+#include <Arduino.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+class Test;
+class QueueFile;
+
+/**
+ * FileQueue is a durable FIFO of records kept in segment files in a
+ * directory, on LittleFS on the device, or in a plain directory on host.
+ *
+ * Records are appended sequentially to the newest segment and flushed to
+ * storage after every syncInterval records, or by sync(). A record is stored
+ * as 4 bytes length, data and 4 bytes CRC-32 of data, so a record torn by a
+ * crash or power loss is detected and ignored during replay. Position of the
+ * oldest record is kept by a cursor written alternately into two slot files,
+ * after every syncInterval removed records, by sync() or when a segment is
+ * deleted. Records removed after the last cursor write are replayed again.
+ * Segment files are deleted once all their records are removed. Segments
+ * from previous runs are never appended to.
+ **/
+class FileQueue {
+  friend class Test;
+
+ public:
+  // Receives replayed record
+  typedef std::function<void(const char *data, size_t length)> ReplayCallback;
+  // dir - directory for queue files, it is created if it does not exist
+  // segmentSize - bytes after which a new segment file is started
+  // syncInterval - number of records after which data are flushed to storage
+  FileQueue(const std::string &dir, uint32_t segmentSize = 16384,
+            uint16_t syncInterval = 10);
+  ~FileQueue();
+  // Opens queue and passes all stored records to callback, the oldest first.
+  // Returns false if the directory cannot be used
+  bool open(ReplayCallback callback);
+  // Starts a record of length bytes. Record is filled by write() and finished
+  // by endRecord()
+  bool beginRecord(size_t length);
+  // Appends data to the record started by beginRecord
+  bool write(const char *data, size_t length);
+  // Finishes record started by beginRecord. Total written length must match
+  // the length passed to beginRecord
+  bool endRecord();
+  // Appends record
+  bool push(const char *data, size_t length) {
+    return beginRecord(length) && write(data, length) && endRecord();
+  }
+  // Removes count oldest records
+  bool pop(uint32_t count);
+  // Flushes appended records and position of the oldest one to storage
+  bool sync();
+  // Returns number of records
+  uint32_t size() const { return _records.size(); }
+  const std::string &getDir() const { return _dir; }
+
+ protected:
+  struct Segment {
+    uint32_t seq;
+    // Number of records not yet removed
+    uint32_t records;
+  };
+  // Returns path of the segment file
+  std::string segmentPath(uint32_t seq) const;
+  // Reads records of the segment from offset. Returns number of valid records
+  uint32_t replaySegment(uint32_t seq, uint32_t offset,
+                         ReplayCallback &callback);
+  // Reads the newest valid cursor. Returns false if there is none
+  bool readCursor(uint32_t &seq, uint32_t &offset);
+  // Stores position of the oldest record
+  bool writeCursor();
+  // Starts a new segment file
+  bool startSegment();
+
+ private:
+  std::string _dir;
+  uint32_t _segmentSize;
+  uint16_t _syncInterval;
+  // Segments with records, the last one can be open for appending
+  std::deque<Segment> _segments;
+  // Sizes of records in bytes, including length and CRC
+  std::deque<uint32_t> _records;
+  // Offset of the oldest record in the first segment
+  uint32_t _headOffset = 0;
+  // Sequence number of the next segment
+  uint32_t _nextSeq = 0;
+  // Generation of the last written cursor
+  uint32_t _cursorGen = 0;
+  // Segment open for appending
+  std::unique_ptr<QueueFile> _file;
+  // Bytes written to the open segment
+  uint32_t _fileSize = 0;
+  // Records appended since the last sync
+  uint16_t _unsynced = 0;
+  // Records removed since the cursor was written
+  uint16_t _unsyncedPops = 0;
+  // Remaining bytes of the record being written
+  uint32_t _recordLeft = 0;
+  // Stored size of the record being written
+  uint32_t _recordSize = 0;
+  // CRC of the record being written
+  uint32_t _recordCrc = 0;
+  bool _opened = false;
+};
+
+#endif  //_INFLUXDB_CLIENT_FILE_QUEUE_H_
@@ -0,0 +1,344 @@
+/**
+ *
+ * GzipStream.cpp: Streaming gzip compressor
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "GzipStream.h"
+
+#include "helpers.h"
+
+// History window size, maximal match distance
+static const uint16_t WindowSize = 1024;
+static const uint16_t WindowMask = WindowSize - 1;
+static const uint16_t MinMatch = 3;
+static const uint16_t MaxMatch = 258;
+static const uint16_t HashBits = 9;
+static const uint16_t HashSize = 1 << HashBits;
+static const uint16_t Nil = 0xFFFF;
+
+// Base lengths of length codes 257-285
+static const uint16_t LengthBase[] PROGMEM = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+// Base distances of distance codes 0-19 (distance up to WindowSize)
+static const uint16_t DistanceBase[] PROGMEM = {
+    1,  2,  3,  4,  5,   7,   9,   13,  17,  25,
+    33, 49, 65, 97, 129, 193, 257, 385, 513, 769};
+// Huffman codes are written starting from the most significant bit
+static uint16_t reverseBits(uint16_t code, uint8_t bits) {
+  uint16_t r = 0;
+  for (uint8_t i = 0; i < bits; i++) {
+    r = (r << 1) | (code & 1);
+    code >>= 1;
+  }
+  return r;
+}
+
+// Extra bits of length code, index from 0 (code 257)
+static uint8_t lengthExtraBits(uint8_t index) {
+  return (index < 8 || index == 28) ? 0 : (index - 4) / 4;
+}
+
+// Extra bits of distance code
+static uint8_t distanceExtraBits(uint8_t code) {
+  return code < 4 ? 0 : (code - 2) / 2;
+}
+
+GzipStream::GzipStream(Stream *source, RewindCallback rewind, int level)
+    : _source(source),
+      _rewind(rewind),
+      _window(new uint8_t[2 * WindowSize]),
+      _head(new uint16_t[HashSize]),
+      _prev(new uint16_t[WindowSize]),
+      _size(-1) {
+  if (level < 1) level = 1;
+  if (level > 9) level = 9;
+  _maxChain = 1 << (level - 1);
+  restart();
+}
+
+void GzipStream::restart() {
+  _state = State::Header;
+  _pos = _end = 0;
+  _srcEof = false;
+  _srcSize = 0;
+  _crc = 0;
+  _bitBuf = 0;
+  _bitCount = 0;
+  _outPos = _outLen = 0;
+  _read = 0;
+  for (uint16_t i = 0; i < HashSize; i++) {
+    _head[i] = Nil;
+  }
+}
+
+int GzipStream::available() {
+  if (_size < 0) {
+    // compress everything once to find out the size
+    uint32_t size = 0;
+    while (produce()) {
+      size += _outLen - _outPos;
+      _outPos = _outLen = 0;
+    }
+    _size = size;
+    if (_rewind) {
+      _rewind();
+    }
+    restart();
+  }
+  return _size - _read;
+}
+
+size_t GzipStream::readBytes(char *buffer, size_t len) {
+  size_t read = 0;
+  while (read < len) {
+    if (_outPos == _outLen) {
+      _outPos = _outLen = 0;
+      if (!produce()) {
+        break;
+      }
+    }
+    size_t n = _outLen - _outPos;
+    if (n > len - read) {
+      n = len - read;
+    }
+    memcpy(buffer + read, _out + _outPos, n);
+    _outPos += n;
+    read += n;
+  }
+  _read += read;
+  return read;
+}
+
+#if defined(ESP8266)
+int GzipStream::read(uint8_t *buffer, size_t len) {
+  return readBytes((char *)buffer, len);
+}
+#endif
+
+int GzipStream::peek() {
+  if (_outPos == _outLen) {
+    _outPos = _outLen = 0;
+    if (!produce()) {
+      return -1;
+    }
+  }
+  return _out[_outPos];
+}
+
+int GzipStream::read() {
+  int c = peek();
+  if (c >= 0) {
+    _outPos++;
+    _read++;
+  }
+  return c;
+}
+
+size_t GzipStream::write(uint8_t) { return 0; }
+
+bool GzipStream::produce() {
+  // each step produces at most 10 bytes
+  while (_state != State::Done && _outLen < sizeof(_out) - 10) {
+    switch (_state) {
+      case State::Header: {
+        // magic, deflate, no flags, no mtime, no extra flags, unknown OS
+        static const uint8_t header[] PROGMEM = {0x1f, 0x8b, 8, 0, 0,
+                                                 0,    0,    0, 0, 0xff};
+        memcpy_P(_out + _outLen, header, sizeof(header));
+        _outLen += sizeof(header);
+        // single final block with fixed Huffman codes
+        putBits(1, 1);
+        putBits(1, 2);
+        _state = State::Body;
+      } break;
+      case State::Body: {
+        if (_end - _pos < MaxMatch && !_srcEof) {
+          fill();
+        }
+        if (_pos >= _end) {
+          putSymbol(256);
+          // align to byte
+          if (_bitCount > 0) {
+            putByte(_bitBuf & 0xFF);
+          }
+          _bitCount = 0;
+          _bitBuf = 0;
+          _state = State::Trailer;
+          break;
+        }
+        uint16_t distance = 0, length = 0;
+        if (_end - _pos >= MinMatch) {
+          length = findMatch(distance);
+          insert(_pos);
+        }
+        if (length >= MinMatch) {
+          putMatch(length, distance);
+          for (uint16_t i = 1; i < length; i++) {
+            _pos++;
+            if (_end - _pos >= MinMatch) {
+              insert(_pos);
+            }
+          }
+          _pos++;
+        } else {
+          putSymbol(_window[_pos++]);
+        }
+      } break;
+      case State::Trailer:
+        putLE32(_crc);
+        putLE32(_srcSize);
+        _state = State::Done;
+        break;
+      case State::Done:
+        break;
+    }
+  }
+  return _outLen > _outPos;
+}
+
+void GzipStream::fill() {
+  if (_end == 2 * WindowSize) {
+    slide();
+  }
+  while (_end < 2 * WindowSize) {
+    int avail = _source->available();
+    if (avail <= 0) {
+      _srcEof = true;
+      break;
+    }
+    size_t len = 2 * WindowSize - _end;
+    if ((size_t)avail < len) {
+      len = avail;
+    }
+    size_t n = _source->readBytes((char *)_window.get() + _end, len);
+    if (n == 0) {
+      _srcEof = true;
+      break;
+    }
+    _crc = updateCrc32(_crc, _window.get() + _end, n);
+    _srcSize += n;
+    _end += n;
+  }
+}
+
+void GzipStream::slide() {
+  memcpy(_window.get(), _window.get() + WindowSize, WindowSize);
+  _pos -= WindowSize;
+  _end -= WindowSize;
+  for (uint16_t i = 0; i < HashSize; i++) {
+    _head[i] = _head[i] != Nil && _head[i] >= WindowSize ? _head[i] - WindowSize
+                                                         : Nil;
+  }
+  for (uint16_t i = 0; i < WindowSize; i++) {
+    _prev[i] = _prev[i] != Nil && _prev[i] >= WindowSize ? _prev[i] - WindowSize
+                                                         : Nil;
+  }
+}
+
+static inline uint16_t hash(const uint8_t *p) {
+  return ((p[0] << 5) ^ (p[1] << 2) ^ p[2]) & (HashSize - 1);
+}
+
+void GzipStream::insert(uint16_t pos) {
+  uint16_t h = hash(_window.get() + pos);
+  _prev[pos & WindowMask] = _head[h];
+  _head[h] = pos;
+}
+
+uint16_t GzipStream::findMatch(uint16_t &distance) {
+  const uint8_t *data = _window.get();
+  const uint16_t limit = _pos > WindowSize ? _pos - WindowSize : 0;
+  uint16_t maxLength = _end - _pos;
+  if (maxLength > MaxMatch) {
+    maxLength = MaxMatch;
+  }
+  uint16_t best = 0;
+  uint16_t chain = _maxChain;
+  uint16_t candidate = _head[hash(data + _pos)];
+  while (candidate != Nil && candidate >= limit && candidate < _pos &&
+         chain-- > 0) {
+    if (data[candidate + best] == data[_pos + best]) {
+      uint16_t length = 0;
+      while (length < maxLength &&
+             data[candidate + length] == data[_pos + length]) {
+        length++;
+      }
+      if (length > best) {
+        best = length;
+        distance = _pos - candidate;
+        if (length == maxLength) {
+          break;
+        }
+      }
+    }
+    candidate = _prev[candidate & WindowMask];
+  }
+  return best;
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t bits) {
+  _bitBuf |= value << _bitCount;
+  _bitCount += bits;
+  while (_bitCount >= 8) {
+    putByte(_bitBuf & 0xFF);
+    _bitBuf >>= 8;
+    _bitCount -= 8;
+  }
+}
+
+void GzipStream::putSymbol(uint16_t symbol) {
+  if (symbol < 144) {
+    putBits(reverseBits(0x30 + symbol, 8), 8);
+  } else if (symbol < 256) {
+    putBits(reverseBits(0x190 + symbol - 144, 9), 9);
+  } else if (symbol < 280) {
+    putBits(reverseBits(symbol - 256, 7), 7);
+  } else {
+    putBits(reverseBits(0xC0 + symbol - 280, 8), 8);
+  }
+}
+
+void GzipStream::putMatch(uint16_t length, uint16_t distance) {
+  uint8_t index = 28;
+  while (pgm_read_word(&LengthBase[index]) > length) {
+    index--;
+  }
+  putSymbol(257 + index);
+  putBits(length - pgm_read_word(&LengthBase[index]), lengthExtraBits(index));
+  uint8_t code = 19;
+  while (pgm_read_word(&DistanceBase[code]) > distance) {
+    code--;
+  }
+  putBits(reverseBits(code, 5), 5);
+  putBits(distance - pgm_read_word(&DistanceBase[code]),
+          distanceExtraBits(code));
+}
+
+void GzipStream::putLE32(uint32_t value) {
+  for (uint8_t i = 0; i < 4; i++) {
+    putByte(value & 0xFF);
+    value >>= 8;
+  }
+}
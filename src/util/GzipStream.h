@@ -0,0 +1,118 @@
+/**
+ *
+ * GzipStream.h: Streaming gzip compressor
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _INFLUXDB_CLIENT_GZIP_STREAM_H_
+#define _INFLUXDB_CLIENT_GZIP_STREAM_H_
+
+#include <Arduino.h>
+
+#include <functional>
+#include <memory>
+
+/**
+ * GzipStream reads data from a source stream and provides it gzip compressed.
+ * Compression runs incrementally in a small fixed window, so neither the
+ * source nor the compressed data are ever held in memory as a whole. Uses
+ * LZ77 with fixed Huffman codes, which suits repetitive line protocol well.
+ *
+ * Content length must be known before sending, so the first call of
+ * available() compresses the whole source to count bytes and then rewinds the
+ * source using the rewind callback.
+ **/
+class GzipStream : public Stream {
+ public:
+  // Rewinds source stream to the beginning
+  typedef std::function<void()> RewindCallback;
+  // level - 1 (fastest) to 9 (best compression)
+  GzipStream(Stream *source, RewindCallback rewind, int level = 6);
+  virtual ~GzipStream(){};
+  // Stream overrides
+  virtual int available() override;
+  virtual int read() override;
+#if defined(ESP8266)
+  virtual int read(uint8_t *buffer, size_t len) override;
+#endif
+  virtual size_t readBytes(char *buffer, size_t len) override;
+  virtual void flush() override{};
+  virtual int peek() override;
+  virtual size_t write(uint8_t data) override;
+  // Returns number of bytes read from source so far
+  uint32_t getSourceSize() const { return _srcSize; }
+
+ protected:
+  enum class State : uint8_t { Header, Body, Trailer, Done };
+  // Resets compressor to the beginning of data
+  void restart();
+  // Compresses next part of data into output buffer.
+  // Returns false if all data has been produced
+  bool produce();
+  // Reads data from source into window
+  void fill();
+  // Moves window by half
+  void slide();
+  // Adds string at position to hash chains
+  void insert(uint16_t pos);
+  // Finds longest match of string at _pos. Returns length, sets distance
+  uint16_t findMatch(uint16_t &distance);
+  void putBits(uint32_t value, uint8_t bits);
+  void putSymbol(uint16_t symbol);
+  void putMatch(uint16_t length, uint16_t distance);
+  void putByte(uint8_t b) { _out[_outLen++] = b; }
+  void putLE32(uint32_t value);
+
+ private:
+  Stream *_source;
+  RewindCallback _rewind;
+  // Maximum number of hash chain entries to check
+  uint16_t _maxChain;
+  State _state;
+  // Source data, two halves of history window
+  std::unique_ptr<uint8_t[]> _window;
+  // Last position for each hash
+  std::unique_ptr<uint16_t[]> _head;
+  // Previous position with the same hash
+  std::unique_ptr<uint16_t[]> _prev;
+  // Current position in window
+  uint16_t _pos;
+  // End of valid data in window
+  uint16_t _end;
+  bool _srcEof;
+  uint32_t _srcSize;
+  uint32_t _crc;
+  // Pending bits
+  uint32_t _bitBuf;
+  uint8_t _bitCount;
+  // Compressed data ready to be read
+  uint8_t _out[64];
+  uint8_t _outPos;
+  uint8_t _outLen;
+  // Total size of compressed data, -1 if not known yet
+  int32_t _size;
+  // Compressed bytes read
+  uint32_t _read;
+};
+
+#endif  //_INFLUXDB_CLIENT_GZIP_STREAM_H_
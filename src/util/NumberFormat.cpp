@@ -0,0 +1,562 @@
+/**
+ *
+ * NumberFormat.cpp: Formatting numbers for line protocol without heap use
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "NumberFormat.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// Shortest representation is found by the Grisu2 algorithm (Florian Loitsch,
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers").
+// It uses only 64-bit integer arithmetic, which is cheap compared to floating
+// point emulation on cores without FPU. Output always converts back to the
+// same value and is the shortest one in the vast majority of cases.
+
+namespace {
+
+// Floating point number f * 2^e with 64-bit significand
+struct DiyFp {
+  uint64_t f;
+  int e;
+};
+
+// Returns x - y, both must have the same exponent and x >= y
+inline DiyFp sub(const DiyFp &x, const DiyFp &y) { return {x.f - y.f, x.e}; }
+
+// Returns x * y rounded to 64 bits
+DiyFp mul(const DiyFp &x, const DiyFp &y) {
+  const uint64_t xLo = x.f & 0xFFFFFFFFu;
+  const uint64_t xHi = x.f >> 32;
+  const uint64_t yLo = y.f & 0xFFFFFFFFu;
+  const uint64_t yHi = y.f >> 32;
+  const uint64_t p0 = xLo * yLo;
+  const uint64_t p1 = xLo * yHi;
+  const uint64_t p2 = xHi * yLo;
+  const uint64_t p3 = xHi * yHi;
+  uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+  // round up
+  q += uint64_t{1} << 31;
+  return {p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32), x.e + y.e + 64};
+}
+
+DiyFp normalize(DiyFp x) {
+  while ((x.f >> 63) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+// Normalized value and its boundaries, halfway to the neighbour values
+struct Boundaries {
+  DiyFp w;
+  DiyFp minus;
+  DiyFp plus;
+};
+
+// Value must be finite and positive
+template <typename T>
+Boundaries computeBoundaries(T value) {
+  constexpr int precision = std::numeric_limits<T>::digits;
+  constexpr int bias = std::numeric_limits<T>::max_exponent - 1 + precision - 1;
+  constexpr int minExp = 1 - bias;
+  constexpr uint64_t hiddenBit = uint64_t{1} << (precision - 1);
+  typedef typename std::conditional<precision == 24, uint32_t, uint64_t>::type
+      Bits;
+  Bits bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint64_t e = bits >> (precision - 1);
+  const uint64_t f = bits & (hiddenBit - 1);
+  const DiyFp v = e == 0 ? DiyFp{f, minExp}
+                         : DiyFp{f + hiddenBit, int(e) - bias};
+  // the lower neighbour is closer, when significand is power of two
+  const bool lowerCloser = f == 0 && e > 1;
+  const DiyFp plus = normalize(DiyFp{2 * v.f + 1, v.e - 1});
+  DiyFp minus = lowerCloser ? DiyFp{4 * v.f - 1, v.e - 2}
+                            : DiyFp{2 * v.f - 1, v.e - 1};
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+  return {normalize(v), minus, plus};
+}
+
+// Normalized power of ten, c = f * 2^e ~= 10^k
+struct CachedPower {
+  uint64_t f;
+  int e;
+  int k;
+};
+
+// Range of binary exponent of product of value and cached power
+constexpr int Alpha = -60;
+constexpr int Gamma = -32;
+constexpr int CachedPowersMinDecExp = -300;
+constexpr int CachedPowersDecStep = 8;
+
+const CachedPower CachedPowers[] PROGMEM = {
+    {0xAB70FE17C79AC6CA, -1060, -300},
+    {0xFF77B1FCBEBCDC4F, -1034, -292},
+    {0xBE5691EF416BD60C, -1007, -284},
+    {0x8DD01FAD907FFC3C, -980, -276},
+    {0xD3515C2831559A83, -954, -268},
+    {0x9D71AC8FADA6C9B5, -927, -260},
+    {0xEA9C227723EE8BCB, -901, -252},
+    {0xAECC49914078536D, -874, -244},
+    {0x823C12795DB6CE57, -847, -236},
+    {0xC21094364DFB5637, -821, -228},
+    {0x9096EA6F3848984F, -794, -220},
+    {0xD77485CB25823AC7, -768, -212},
+    {0xA086CFCD97BF97F4, -741, -204},
+    {0xEF340A98172AACE5, -715, -196},
+    {0xB23867FB2A35B28E, -688, -188},
+    {0x84C8D4DFD2C63F3B, -661, -180},
+    {0xC5DD44271AD3CDBA, -635, -172},
+    {0x936B9FCEBB25C996, -608, -164},
+    {0xDBAC6C247D62A584, -582, -156},
+    {0xA3AB66580D5FDAF6, -555, -148},
+    {0xF3E2F893DEC3F126, -529, -140},
+    {0xB5B5ADA8AAFF80B8, -502, -132},
+    {0x87625F056C7C4A8B, -475, -124},
+    {0xC9BCFF6034C13053, -449, -116},
+    {0x964E858C91BA2655, -422, -108},
+    {0xDFF9772470297EBD, -396, -100},
+    {0xA6DFBD9FB8E5B88F, -369, -92},
+    {0xF8A95FCF88747D94, -343, -84},
+    {0xB94470938FA89BCF, -316, -76},
+    {0x8A08F0F8BF0F156B, -289, -68},
+    {0xCDB02555653131B6, -263, -60},
+    {0x993FE2C6D07B7FAC, -236, -52},
+    {0xE45C10C42A2B3B06, -210, -44},
+    {0xAA242499697392D3, -183, -36},
+    {0xFD87B5F28300CA0E, -157, -28},
+    {0xBCE5086492111AEB, -130, -20},
+    {0x8CBCCC096F5088CC, -103, -12},
+    {0xD1B71758E219652C, -77, -4},
+    {0x9C40000000000000, -50, 4},
+    {0xE8D4A51000000000, -24, 12},
+    {0xAD78EBC5AC620000, 3, 20},
+    {0x813F3978F8940984, 30, 28},
+    {0xC097CE7BC90715B3, 56, 36},
+    {0x8F7E32CE7BEA5C70, 83, 44},
+    {0xD5D238A4ABE98068, 109, 52},
+    {0x9F4F2726179A2245, 136, 60},
+    {0xED63A231D4C4FB27, 162, 68},
+    {0xB0DE65388CC8ADA8, 189, 76},
+    {0x83C7088E1AAB65DB, 216, 84},
+    {0xC45D1DF942711D9A, 242, 92},
+    {0x924D692CA61BE758, 269, 100},
+    {0xDA01EE641A708DEA, 295, 108},
+    {0xA26DA3999AEF774A, 322, 116},
+    {0xF209787BB47D6B85, 348, 124},
+    {0xB454E4A179DD1877, 375, 132},
+    {0x865B86925B9BC5C2, 402, 140},
+    {0xC83553C5C8965D3D, 428, 148},
+    {0x952AB45CFA97A0B3, 455, 156},
+    {0xDE469FBD99A05FE3, 481, 164},
+    {0xA59BC234DB398C25, 508, 172},
+    {0xF6C69A72A3989F5C, 534, 180},
+    {0xB7DCBF5354E9BECE, 561, 188},
+    {0x88FCF317F22241E2, 588, 196},
+    {0xCC20CE9BD35C78A5, 614, 204},
+    {0x98165AF37B2153DF, 641, 212},
+    {0xE2A0B5DC971F303A, 667, 220},
+    {0xA8D9D1535CE3B396, 694, 228},
+    {0xFB9B7CD9A4A7443C, 720, 236},
+    {0xBB764C4CA7A44410, 747, 244},
+    {0x8BAB8EEFB6409C1A, 774, 252},
+    {0xD01FEF10A657842C, 800, 260},
+    {0x9B10A4E5E9913129, 827, 268},
+    {0xE7109BFBA19C0C9D, 853, 276},
+    {0xAC2820D9623BF429, 880, 284},
+    {0x80444B5E7AA7CF85, 907, 292},
+    {0xBF21E44003ACDD2D, 933, 300},
+    {0x8E679C2F5E44FF8F, 960, 308},
+    {0xD433179D9C8CB841, 986, 316},
+    {0x9E19DB92B4E31BA9, 1013, 324},
+    {0xEB96BF6EBADF77D9, 1039, 332},
+    {0xAF87023B9BF0EE6B, 1066, 340},
+};
+
+// Returns cached power c, so that the binary exponent of value * c is in
+// range [Alpha, Gamma]
+CachedPower getCachedPower(int e) {
+  const int f = Alpha - e - 1;
+  // ceil(f * log10(2))
+  const int k = (f * 78913) / (1 << 18) + (f > 0);
+  const int index =
+      (-CachedPowersMinDecExp + k + (CachedPowersDecStep - 1)) /
+      CachedPowersDecStep;
+  CachedPower cached;
+  memcpy_P(&cached, &CachedPowers[index], sizeof(cached));
+  return cached;
+}
+
+// Returns number of decimal digits of n and sets pow10 to 10^(digits - 1)
+int largestPow10(uint32_t n, uint32_t &pow10) {
+  int digits = 1;
+  pow10 = 1;
+  while (digits < 10 && n / pow10 >= 10) {
+    pow10 *= 10;
+    digits++;
+  }
+  return digits;
+}
+
+// Moves the last digit closer to the exact value, while it stays in range
+void roundWeed(char *buffer, int length, uint64_t dist, uint64_t delta,
+               uint64_t rest, uint64_t tenK) {
+  while (rest < dist && delta - rest >= tenK &&
+         (rest + tenK < dist || dist - rest > rest + tenK - dist)) {
+    buffer[length - 1]--;
+    rest += tenK;
+  }
+}
+
+// Generates the shortest digits of a number in range (minus, plus), closest
+// to w. Value is digits * 10^exponent.
+void generateDigits(char *buffer, int &length, int &exponent, DiyFp minus,
+                    DiyFp w, DiyFp plus) {
+  uint64_t delta = sub(plus, minus).f;
+  uint64_t dist = sub(plus, w).f;
+  const DiyFp one{uint64_t{1} << -plus.e, plus.e};
+  uint32_t p1 = uint32_t(plus.f >> -one.e);
+  uint64_t p2 = plus.f & (one.f - 1);
+  uint32_t pow10;
+  int n = largestPow10(p1, pow10);
+  while (n > 0) {
+    const uint32_t d = p1 / pow10;
+    p1 %= pow10;
+    buffer[length++] = char('0' + d);
+    n--;
+    const uint64_t rest = (uint64_t{p1} << -one.e) + p2;
+    if (rest <= delta) {
+      exponent += n;
+      roundWeed(buffer, length, dist, delta, rest, uint64_t{pow10} << -one.e);
+      return;
+    }
+    pow10 /= 10;
+  }
+  int m = 0;
+  while (true) {
+    p2 *= 10;
+    buffer[length++] = char('0' + (p2 >> -one.e));
+    p2 &= one.f - 1;
+    m++;
+    delta *= 10;
+    dist *= 10;
+    if (p2 <= delta) {
+      break;
+    }
+  }
+  exponent -= m;
+  roundWeed(buffer, length, dist, delta, p2, one.f);
+}
+
+// Writes shortest digits of finite positive value
+template <typename T>
+void grisu2(char *buffer, int &length, int &exponent, T value) {
+  const Boundaries b = computeBoundaries(value);
+  const CachedPower cached = getCachedPower(b.plus.e);
+  const DiyFp c{cached.f, cached.e};
+  const DiyFp w = mul(b.w, c);
+  DiyFp minus = mul(b.minus, c);
+  DiyFp plus = mul(b.plus, c);
+  // shrink the range by the possible error of multiplication
+  minus.f++;
+  plus.f--;
+  length = 0;
+  exponent = -cached.k;
+  generateDigits(buffer, length, exponent, minus, w, plus);
+}
+
+// Writes exponent with sign and at least two digits
+size_t writeExponent(char *buffer, int e) {
+  char *p = buffer;
+  if (e < 0) {
+    *p++ = '-';
+    e = -e;
+  } else {
+    *p++ = '+';
+  }
+  if (e >= 100) {
+    *p++ = char('0' + e / 100);
+    e %= 100;
+  }
+  *p++ = char('0' + e / 10);
+  *p++ = char('0' + e % 10);
+  return p - buffer;
+}
+
+// Places decimal point into length digits of number digits * 10^exponent.
+// Fixed notation is used for decimal point position in (minExp, maxExp].
+size_t formatDigits(char *buffer, int length, int exponent, int minExp,
+                    int maxExp) {
+  const int n = length + exponent;
+  if (length <= n && n <= maxExp) {
+    // digits000
+    memset(buffer + length, '0', n - length);
+    return n;
+  }
+  if (0 < n && n <= maxExp) {
+    // dig.its
+    memmove(buffer + n + 1, buffer + n, length - n);
+    buffer[n] = '.';
+    return length + 1;
+  }
+  if (minExp < n && n <= 0) {
+    // 0.000digits
+    memmove(buffer + 2 - n, buffer, length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    memset(buffer + 2, '0', -n);
+    return 2 - n + length;
+  }
+  size_t written = 1;
+  if (length > 1) {
+    // d.igits
+    memmove(buffer + 2, buffer + 1, length - 1);
+    buffer[1] = '.';
+    written = length + 1;
+  }
+  buffer[written++] = 'e';
+  return written + writeExponent(buffer + written, n - 1);
+}
+
+// Two decimal digits of numbers 00 to 99. Kept in RAM, it is read for every
+// pair of written digits.
+const char DigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes digits of value ending just before end, two at a time
+void writeDigits(char *end, uint64_t value) {
+  // split off 8 digit chunks so the rest uses cheap 32-bit arithmetic
+  while (value > 0xFFFFFFFFu) {
+    const uint64_t q = value / 100000000u;
+    uint32_t chunk = uint32_t(value - q * 100000000u);
+    value = q;
+    for (int i = 0; i < 4; i++) {
+      end -= 2;
+      memcpy(end, &DigitPairs[(chunk % 100) * 2], 2);
+      chunk /= 100;
+    }
+  }
+  uint32_t v = uint32_t(value);
+  while (v >= 100) {
+    end -= 2;
+    memcpy(end, &DigitPairs[(v % 100) * 2], 2);
+    v /= 100;
+  }
+  if (v >= 10) {
+    memcpy(end - 2, &DigitPairs[v * 2], 2);
+  } else {
+    end[-1] = char('0' + v);
+  }
+}
+
+const uint64_t Pow10[] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+constexpr int MaxDecimalPlaces = 17;
+
+// Writes finite positive value with fixed number of decimal places, using at
+// most size chars. Returns 0 if it does not fit.
+size_t formatFixed(char *buffer, size_t size, double value,
+                   int decimalPlaces) {
+  if (decimalPlaces > MaxDecimalPlaces) {
+    decimalPlaces = MaxDecimalPlaces;
+  }
+  // value = m * 2^e exactly
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const int biased = int(bits >> 52);
+  const uint64_t hiddenBit = uint64_t{1} << 52;
+  const uint64_t m = biased ? (bits & (hiddenBit - 1)) | hiddenBit : bits;
+  const int e = (biased ? biased : 1) - 1075;
+  if (e > 10) {
+    // integer of more than 63 bits, its shortest digits are padded with zeros
+    int length, exponent;
+    grisu2(buffer, length, exponent, value);
+    const int n = length + exponent;
+    if (size_t(n + (decimalPlaces ? decimalPlaces + 1 : 0)) > size) {
+      return 0;
+    }
+    size_t written = formatDigits(buffer, length, exponent, 0, n);
+    if (decimalPlaces > 0) {
+      buffer[written++] = '.';
+      memset(buffer + written, '0', decimalPlaces);
+      written += decimalPlaces;
+    }
+    return written;
+  }
+  uint64_t integer;
+  char digits[MaxDecimalPlaces];
+  bool up = false;
+  if (e >= 0) {
+    integer = m << e;
+    memset(digits, '0', decimalPlaces);
+  } else if (e >= -60) {
+    // fraction of -e bits, times 10 still fits 64 bits
+    const int shift = -e;
+    const uint64_t mask = (uint64_t{1} << shift) - 1;
+    integer = shift < 64 ? m >> shift : 0;
+    uint64_t frac = m & mask;
+    for (int i = 0; i < decimalPlaces; i++) {
+      frac *= 10;
+      digits[i] = char('0' + (frac >> shift));
+      frac &= mask;
+    }
+    up = frac >= (uint64_t{1} << (shift - 1));
+  } else {
+    // value < 2^-8, scaled value is below 2^53, so the rounding error of the
+    // product is the only inexact part
+    const uint64_t pow10 = Pow10[decimalPlaces];
+    const double scaled = value * double(pow10);
+    uint64_t n = uint64_t(scaled);
+    const double frac = scaled - double(n);
+    bool half = frac >= 0.5;
+    if (std::fabs(frac - 0.5) <= scaled * 2.3e-16) {
+      // rounding of the product could cross the halfway point, so the exact
+      // product error decides
+      half = (frac - 0.5) + std::fma(value, double(pow10), -scaled) >= 0;
+    }
+    n += half;
+    integer = n / pow10;
+    uint64_t f = n % pow10;
+    for (int i = decimalPlaces - 1; i >= 0; i--) {
+      digits[i] = char('0' + f % 10);
+      f /= 10;
+    }
+  }
+  // round half away from zero
+  for (int i = decimalPlaces - 1; up && i >= 0; i--) {
+    up = digits[i] == '9';
+    digits[i] = up ? '0' : digits[i] + 1;
+  }
+  integer += up;
+  size_t length = countDigits(integer);
+  if (length + (decimalPlaces ? decimalPlaces + 1 : 0) > size) {
+    return 0;
+  }
+  writeDigits(buffer + length, integer);
+  if (decimalPlaces > 0) {
+    buffer[length++] = '.';
+    memcpy(buffer + length, digits, decimalPlaces);
+    length += decimalPlaces;
+  }
+  return length;
+}
+
+template <typename T>
+size_t format(char *buffer, T value, int decimalPlaces) {
+  if (!std::isfinite(value)) {
+    return 0;
+  }
+  size_t sign = 0;
+  if (std::signbit(value)) {
+    buffer[sign++] = '-';
+    value = -value;
+  }
+  if (decimalPlaces >= 0) {
+    const size_t length = formatFixed(buffer + sign, FloatBufferSize - sign,
+                                      value, decimalPlaces);
+    if (length) {
+      return sign + length;
+    }
+  }
+  if (value == 0) {
+    buffer[sign] = '0';
+    return sign + 1;
+  }
+  int length, exponent;
+  grisu2(buffer + sign, length, exponent, value);
+  // fixed notation for numbers in range [1e-4, 1e15)
+  return sign + formatDigits(buffer + sign, length, exponent, -4, 15);
+}
+
+}  // namespace
+
+size_t formatDouble(char *buffer, double value, int decimalPlaces) {
+  return format(buffer, value, decimalPlaces);
+}
+
+size_t formatFloat(char *buffer, float value, int decimalPlaces) {
+  return format(buffer, value, decimalPlaces);
+}
+
+size_t countDigits(uint64_t value) {
+  size_t digits = 1;
+  while (digits < sizeof(Pow10) / sizeof(Pow10[0]) && value >= Pow10[digits]) {
+    digits++;
+  }
+  return digits;
+}
+
+size_t formatUInt(char *buffer, uint64_t value) {
+  const size_t length = countDigits(value);
+  writeDigits(buffer + length, value);
+  return length;
+}
+
+size_t formatInt(char *buffer, int64_t value) {
+  if (value < 0) {
+    buffer[0] = '-';
+    // negation in unsigned arithmetic is valid also for the minimum value
+    return 1 + formatUInt(buffer + 1, 0 - uint64_t(value));
+  }
+  return formatUInt(buffer, uint64_t(value));
+}
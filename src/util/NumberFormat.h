@@ -0,0 +1,65 @@
+/**
+ *
+ * NumberFormat.h: Formatting numbers for line protocol without heap use
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _INFLUXDB_CLIENT_NUMBER_FORMAT_H_
+#define _INFLUXDB_CLIENT_NUMBER_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of buffer sufficient for any number written by formatDouble and
+// formatFloat
+constexpr size_t FloatBufferSize = 40;
+
+// Writes value to buffer, which must have at least FloatBufferSize bytes, and
+// returns number of written chars. The string is not null terminated.
+// If decimalPlaces is negative, writes the shortest representation converting
+// back to the same value. Otherwise value is rounded half away from zero to
+// decimalPlaces (at most 17) decimal places. Integer part above 2^63 is
+// written as the shortest digits padded with zeros, and in exponent notation
+// when it does not fit the buffer with the decimal places. Without decimal
+// places, exponent notation is used for numbers too large or too small to be
+// written in a reasonable length. NaN
+// and infinity cannot be written in line protocol, so nothing is written and
+// 0 is returned.
+size_t formatDouble(char *buffer, double value, int decimalPlaces = -1);
+// Same as formatDouble, the shortest representation converts back to the same
+// float value
+size_t formatFloat(char *buffer, float value, int decimalPlaces = -1);
+
+// Size of buffer sufficient for any 64-bit integer, including sign
+constexpr size_t IntBufferSize = 20;
+
+// Returns number of decimal digits of value
+size_t countDigits(uint64_t value);
+// Writes decimal digits of value to buffer, which must have at least
+// IntBufferSize bytes, and returns number of written chars. The string is not
+// null terminated.
+size_t formatUInt(char *buffer, uint64_t value);
+// Same as formatUInt, negative value is prefixed with '-'
+size_t formatInt(char *buffer, int64_t value);
+
+#endif  //_INFLUXDB_CLIENT_NUMBER_FORMAT_H_
@@ -0,0 +1,70 @@
+/**
+ *
+ * SeriesCache.cpp: Cache of series keys of measurements joined with default tags
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "SeriesCache.h"
+
+const std::string& SeriesCache::get(const std::string& measurement,
+                                    const std::string& defaultTags) {
+  _clock++;
+  // points of one measurement are usually written in a row
+  if (_last < _entries.size() && _entries[_last].measurement == measurement) {
+    _entries[_last].used = _clock;
+    return _entries[_last].series;
+  }
+  size_t oldest = 0;
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (_entries[i].measurement == measurement) {
+      _entries[i].used = _clock;
+      _last = i;
+      return _entries[i].series;
+    }
+    if (_entries[i].used < _entries[oldest].used) {
+      oldest = i;
+    }
+  }
+  if (_entries.size() < _capacity) {
+    _entries.emplace_back();
+    oldest = _entries.size() - 1;
+  }
+  Entry& entry = _entries[oldest];
+  entry.measurement.assign(measurement);
+  // default tags are already sorted and unique
+  entry.series.assign(measurement);
+  if (!defaultTags.empty()) {
+    entry.series.push_back(',');
+    entry.series.append(defaultTags, 0, defaultTags.length() - 1);
+  }
+  entry.used = _clock;
+  _last = oldest;
+  return entry.series;
+}
+
+void SeriesCache::reset(size_t capacity) {
+  _entries.clear();
+  _entries.reserve(capacity);
+  _capacity = capacity;
+  _last = 0;
+}
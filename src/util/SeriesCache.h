@@ -0,0 +1,69 @@
+/**
+ *
+ * SeriesCache.h: Cache of series keys of measurements joined with default tags
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _INFLUXDB_CLIENT_SERIES_CACHE_H_
+#define _INFLUXDB_CLIENT_SERIES_CACHE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * SeriesCache keeps series keys of points without own tags: escaped
+ * measurement joined with default tags. Points of a few measurements written
+ * repeatedly then share the key instead of merging tags for each point. The
+ * least recently used key is replaced when the cache is full.
+ */
+class SeriesCache {
+ public:
+  SeriesCache(size_t capacity = 8) { reset(capacity); }
+  // Returns series key of escaped measurement and default tags, which are
+  // escaped, sorted by key and each followed by comma. Cache must be reset
+  // when default tags change. Must not be called when the cache is disabled.
+  const std::string& get(const std::string& measurement,
+                         const std::string& defaultTags);
+  // Removes all keys and sets capacity. Zero capacity disables the cache
+  void reset(size_t capacity);
+  size_t getCapacity() const { return _capacity; }
+  size_t size() const { return _entries.size(); }
+
+ private:
+  struct Entry {
+    std::string measurement;
+    std::string series;
+    // value of _clock at the last use
+    uint32_t used;
+  };
+  std::vector<Entry> _entries;
+  size_t _capacity;
+  // Incremented on each get
+  uint32_t _clock = 0;
+  // Index of the last used entry, checked first
+  size_t _last = 0;
+};
+
+#endif  //_INFLUXDB_CLIENT_SERIES_CACHE_H_
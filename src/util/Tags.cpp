@@ -0,0 +1,156 @@
+/**
+ *
+ * Tags.cpp: Sorted list of escaped tags
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "Tags.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+static TagList::iterator findTag(TagList& tags, const std::string& key) {
+  return std::lower_bound(
+      tags.begin(), tags.end(), key,
+      [](const Tag& tag, const std::string& key) { return tag.key < key; });
+}
+
+void setTag(TagList& tags, const std::string& key, const std::string& value) {
+  auto it = findTag(tags, key);
+  if (it != tags.end() && it->key == key) {
+    it->value = value;
+  } else {
+    tags.insert(it, Tag{key, value});
+  }
+}
+
+void setTag(TagList& tags, Tag& tag) {
+  auto it = findTag(tags, tag.key);
+  if (it != tags.end() && it->key == tag.key) {
+    std::swap(*it, tag);
+  } else {
+    tags.insert(it, std::move(tag));
+  }
+}
+
+// Calls f(key, keyLength, value, valueLength) for each tag of escaped list
+template <class F>
+static void parseTags(const std::string& list, F f) {
+  size_t start = 0;
+  size_t equal = std::string::npos;
+  for (size_t i = 0; i <= list.length(); i++) {
+    if (i == list.length() || list[i] == ',') {
+      if (equal != std::string::npos) {
+        f(list.data() + start, equal - start, list.data() + equal + 1,
+          i - equal - 1);
+      }
+      start = i + 1;
+      equal = std::string::npos;
+    } else if (list[i] == '\\') {
+      // escaped char
+      i++;
+    } else if (list[i] == '=' && equal == std::string::npos) {
+      equal = i;
+    }
+  }
+}
+
+void setTags(TagList& tags, const std::string& list) {
+  parseTags(list, [&tags](const char* key, size_t keyLength, const char* value,
+                          size_t valueLength) {
+    setTag(tags, std::string(key, keyLength), std::string(value, valueLength));
+  });
+}
+
+void appendTags(std::string& str, const TagList& tags) {
+  for (const auto& tag : tags) {
+    str.push_back(',');
+    str.append(tag.key);
+    str.push_back('=');
+    str.append(tag.value);
+  }
+}
+
+namespace {
+// Tag referring to strings of a source, sources with higher priority replace
+// tags of lower ones
+struct TagRef {
+  const char* key;
+  size_t keyLength;
+  const char* value;
+  size_t valueLength;
+  int priority;
+  bool operator<(const TagRef& other) const {
+    int c = memcmp(key, other.key, std::min(keyLength, other.keyLength));
+    if (c == 0 && keyLength != other.keyLength) {
+      c = keyLength < other.keyLength ? -1 : 1;
+    }
+    return c < 0 || (c == 0 && priority < other.priority);
+  }
+  bool sameKey(const TagRef& other) const {
+    return keyLength == other.keyLength &&
+           memcmp(key, other.key, keyLength) == 0;
+  }
+};
+}  // namespace
+
+void appendTags(std::string& str, const std::string& list,
+                const TagList& fixed, const TagList& tags) {
+  // upper bound of number of tags, commas can be also escaped
+  const size_t maxCount = std::count(list.begin(), list.end(), ',') + 1 +
+                          fixed.size() + tags.size();
+  // usual number of tags fits on stack
+  TagRef stackRefs[16];
+  std::unique_ptr<TagRef[]> heapRefs;
+  TagRef* refs = stackRefs;
+  if (maxCount > sizeof(stackRefs) / sizeof(stackRefs[0])) {
+    heapRefs.reset(new TagRef[maxCount]);
+    refs = heapRefs.get();
+  }
+  size_t count = 0;
+  parseTags(list, [refs, &count](const char* key, size_t keyLength,
+                                 const char* value, size_t valueLength) {
+    refs[count++] = TagRef{key, keyLength, value, valueLength, 0};
+  });
+  int priority = 1;
+  for (const TagList* l : {&fixed, &tags}) {
+    for (const auto& tag : *l) {
+      refs[count++] = TagRef{tag.key.data(), tag.key.length(),
+                             tag.value.data(), tag.value.length(), priority};
+    }
+    priority++;
+  }
+  std::sort(refs, refs + count);
+  for (size_t i = 0; i < count; i++) {
+    // the last of tags with the same key has the highest priority
+    if (i + 1 < count && refs[i].sameKey(refs[i + 1])) {
+      continue;
+    }
+    str.push_back(',');
+    str.append(refs[i].key, refs[i].keyLength);
+    str.push_back('=');
+    str.append(refs[i].value, refs[i].valueLength);
+  }
+}
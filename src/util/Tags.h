@@ -0,0 +1,59 @@
+/**
+ *
+ * Tags.h: Sorted list of escaped tags
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _INFLUXDB_CLIENT_TAGS_H_
+#define _INFLUXDB_CLIENT_TAGS_H_
+
+#include <string>
+#include <vector>
+
+// Tag with escaped key and value
+struct Tag {
+  std::string key;
+  std::string value;
+};
+
+// Tags sorted by escaped key, without duplicate keys. Sorted tags are the
+// canonical form of a series, which server processes fastest.
+typedef std::vector<Tag> TagList;
+
+// Sets tag of escaped key and value, replacing value of tag with the same key
+void setTag(TagList& tags, const std::string& key, const std::string& value);
+// Moves tag to the list. If there is a tag with the same key, it is replaced
+// and moved to tag
+void setTag(TagList& tags, Tag& tag);
+// Sets tags of escaped list, where each tag is followed by comma (the last
+// comma is optional), such as WriteOptions default tags
+void setTags(TagList& tags, const std::string& list);
+// Appends ",key=value" for each tag
+void appendTags(std::string& str, const TagList& tags);
+// Appends ",key=value" for tags of escaped list, as accepted by setTags, and
+// both tag lists merged in order of key. A tag of fixed replaces a tag of list
+// with the same key, a tag of tags replaces both. Tag strings are not copied.
+void appendTags(std::string& str, const std::string& list,
+                const TagList& fixed, const TagList& tags);
+
+#endif  //_INFLUXDB_CLIENT_TAGS_H_
@@ -0,0 +1,196 @@
+/**
+ *
+ * Worker.cpp: Background task running a job on demand
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "Worker.h"
+
+#if defined(INFLUXDB_CLIENT_WORKER_FREERTOS)
+
+bool Worker::start(Job job, const char *name, uint32_t stackSize,
+                   uint8_t priority) {
+  if (_running) {
+    return true;
+  }
+  if (!_mutex) {
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+      return false;
+    }
+  }
+  _job = job;
+  _stop = false;
+  _finished = false;
+  _running = true;
+  TaskHandle_t task = nullptr;
+  if (xTaskCreate(taskMain, name, stackSize, this, priority, &task) !=
+      pdPASS) {
+    _running = false;
+    return false;
+  }
+  taskENTER_CRITICAL(&_taskMux);
+  _task = task;
+  taskEXIT_CRITICAL(&_taskMux);
+  return true;
+}
+
+void Worker::taskMain(void *arg) {
+  Worker *worker = static_cast<Worker *>(arg);
+  while (!worker->_stop) {
+    uint32_t wait = worker->_job();
+    if (worker->_stop) {
+      break;
+    }
+    ulTaskNotifyTake(pdTRUE,
+                     wait == Forever ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+  }
+  worker->_finished = true;
+  // deleted by stop() once no notify() uses the task handle
+  vTaskSuspend(nullptr);
+}
+
+void Worker::stop() {
+  if (!_running) {
+    return;
+  }
+  _stop = true;
+  // from now on notify(), e.g. called by a timer task, does not use the handle
+  taskENTER_CRITICAL(&_taskMux);
+  TaskHandle_t task = _task;
+  _task = nullptr;
+  taskEXIT_CRITICAL(&_taskMux);
+  xTaskNotifyGive(task);
+  while (true) {
+    taskENTER_CRITICAL(&_taskMux);
+    const bool notifying = _notifiers > 0;
+    taskEXIT_CRITICAL(&_taskMux);
+    if (_finished && !notifying) {
+      break;
+    }
+    delay(1);
+  }
+  vTaskDelete(task);
+  _running = false;
+}
+
+void Worker::notify() {
+  taskENTER_CRITICAL(&_taskMux);
+  TaskHandle_t task = _task;
+  if (task) {
+    _notifiers++;
+  }
+  taskEXIT_CRITICAL(&_taskMux);
+  if (task) {
+    // task is not deleted until this notification is given
+    xTaskNotifyGive(task);
+    taskENTER_CRITICAL(&_taskMux);
+    _notifiers--;
+    taskEXIT_CRITICAL(&_taskMux);
+  }
+}
+
+void Worker::lock() const {
+  if (_running) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+  }
+}
+
+void Worker::unlock() const {
+  if (_running) {
+    xSemaphoreGive(_mutex);
+  }
+}
+
+#elif defined(INFLUXDB_CLIENT_WORKER_THREAD)
+
+bool Worker::start(Job job, const char *, uint32_t, uint8_t) {
+  if (_running) {
+    return true;
+  }
+  _job = job;
+  _stop = false;
+  _notified = false;
+  _running = true;
+  _thread = std::thread(&Worker::threadMain, this);
+  return true;
+}
+
+void Worker::threadMain() {
+  while (!_stop) {
+    uint32_t wait = _job();
+    std::unique_lock<std::mutex> lock(_notifyMutex);
+    auto woken = [this]() { return _notified || _stop; };
+    if (wait == Forever) {
+      _cond.wait(lock, woken);
+    } else {
+      _cond.wait_for(lock, std::chrono::milliseconds(wait), woken);
+    }
+    _notified = false;
+  }
+}
+
+void Worker::stop() {
+  if (!_running) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_notifyMutex);
+    _stop = true;
+  }
+  _cond.notify_one();
+  _thread.join();
+  _running = false;
+}
+
+void Worker::notify() {
+  if (_running) {
+    {
+      std::lock_guard<std::mutex> lock(_notifyMutex);
+      _notified = true;
+    }
+    _cond.notify_one();
+  }
+}
+
+void Worker::lock() const {
+  if (_running) {
+    _mutex.lock();
+  }
+}
+
+void Worker::unlock() const {
+  if (_running) {
+    _mutex.unlock();
+  }
+}
+
+#else  // no tasks
+
+bool Worker::start(Job, const char *, uint32_t, uint8_t) { return false; }
+void Worker::stop() {}
+void Worker::notify() {}
+void Worker::lock() const {}
+void Worker::unlock() const {}
+
+#endif
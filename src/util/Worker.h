@@ -0,0 +1,98 @@
+/**
+ *
+ * Worker.h: Background task running a job on demand
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _INFLUXDB_CLIENT_WORKER_H_
+#define _INFLUXDB_CLIENT_WORKER_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <functional>
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#define INFLUXDB_CLIENT_WORKER_FREERTOS
+#elif defined(INFLUXDB_CLIENT_HOST)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#define INFLUXDB_CLIENT_WORKER_THREAD
+#endif
+
+/**
+ * Worker runs a job in a background task, a FreeRTOS task on ESP32 or a
+ * thread on host. The job runs again when notified or when the wait time it
+ * returned elapses. On platforms without tasks (ESP8266) start() fails.
+ *
+ * Worker also provides a lock for data shared with the job. Locking is a no-op
+ * while the worker is not running.
+ **/
+class Worker {
+ public:
+  // Wait time meaning wait for notification
+  static const uint32_t Forever = UINT32_MAX;
+  // Runs once, returns milliseconds to wait before the next run
+  typedef std::function<uint32_t()> Job;
+  Worker() {}
+  ~Worker() { stop(); }
+  Worker(const Worker &) = delete;
+  Worker &operator=(const Worker &) = delete;
+  // Starts background task running job. Returns false if not supported
+  bool start(Job job, const char *name, uint32_t stackSize, uint8_t priority);
+  // Stops task and waits for the running job to finish
+  void stop();
+  // Wakes task to run the job. Safe to call from any task
+  void notify();
+  bool isRunning() const { return _running; }
+  void lock() const;
+  void unlock() const;
+
+ private:
+  Job _job;
+  std::atomic<bool> _running{false};
+  std::atomic<bool> _stop{false};
+#if defined(INFLUXDB_CLIENT_WORKER_FREERTOS)
+  static void taskMain(void *arg);
+  // Guards _task and _notifiers, notify() can run in another task
+  portMUX_TYPE _taskMux = portMUX_INITIALIZER_UNLOCKED;
+  TaskHandle_t _task = nullptr;
+  // Number of notify() calls using _task
+  uint32_t _notifiers = 0;
+  SemaphoreHandle_t _mutex = nullptr;
+  std::atomic<bool> _finished{false};
+#elif defined(INFLUXDB_CLIENT_WORKER_THREAD)
+  void threadMain();
+  std::thread _thread;
+  mutable std::mutex _mutex;
+  std::mutex _notifyMutex;
+  std::condition_variable _cond;
+  bool _notified = false;
+#endif
+};
+
+#endif  //_INFLUXDB_CLIENT_WORKER_H_
@@ -25,6 +25,7 @@
  * SOFTWARE.
  */
 #include "helpers.h"
+#include "NumberFormat.h"
 
 void timeSync(const char* tzInfo, const char* ntpServer1,
               const char* ntpServer2, const char* ntpServer3) {
@@ -63,43 +64,81 @@ unsigned long long getTimeStamp(struct timeval* tv, const int secFracDigits) {
 
 std::string timeStampToString(const unsigned long long timestamp,
                               const int extraCharsSpace) {
-  // 22 is max long long string length (18)
-  char buff[22 + extraCharsSpace + 1];
-  snprintf(buff, 22, "%llu", timestamp);
-  return buff;
+  // extra space is reserved, so caller can append without reallocation
+  std::string ret(IntBufferSize + extraCharsSpace, '\0');
+  ret.resize(formatUInt(&ret[0], timestamp));
+  return ret;
 }
 
-constexpr char escapeChars[] = "=\r\n\t ,";
+// Classes of chars, which must be escaped by a backslash
+enum EscapeClass : uint8_t {
+  // measurement, tag key, tag value and field key
+  EscapeKey = 1,
+  // '=' in tag key, tag value and field key
+  EscapeEqual = 2,
+  // field string value
+  EscapeValue = 4
+};
+
+// Escape classes of ASCII chars, other chars are never escaped
+static const uint8_t EscapeTable[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0,  // \t \n \r
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  //
+    1, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,  // space " ,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0,  // =
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  //
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0,  // backslash
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  //
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  //
+};
+
+static inline bool needsEscape(const char c, const uint8_t classes) {
+  return (unsigned char)c < 128 && (EscapeTable[(unsigned char)c] & classes);
+}
 
-size_t escapeKey(std::string& str, const size_t start, const std::string& key,
-                 const bool escapeEqual) {
-  std::string ret;
-  for (auto c : key) {
-    if (strchr(escapeEqual ? escapeChars : escapeChars + 1, c)) {
-      ret.push_back('\\');
+// Writes src of length len to str at position start, prefixing chars of
+// given classes by a backslash. Input is scanned first, so a string without
+// such chars is copied at once and others are escaped in place, without a
+// temporary string. Returns number of written chars.
+static size_t escape(std::string& str, const size_t start, const char* src,
+                     const size_t len, const uint8_t classes,
+                     const char quote = 0) {
+  size_t count = 0;
+  for (size_t i = 0; i < len; i++) {
+    count += needsEscape(src[i], classes);
+  }
+  const size_t quotes = quote ? 2 : 0;
+  const size_t length = len + count + quotes;
+  if (count == 0 && !quote) {
+    str.insert(start, src, len);
+    return length;
+  }
+  // escaping backslashes are already in place, only chars are written
+  str.insert(start, length, '\\');
+  char* out = &str[start];
+  if (quote) *out++ = quote;
+  if (count == 0) {
+    memcpy(out, src, len);
+    out += len;
+  } else {
+    for (size_t i = 0; i < len; i++) {
+      out += needsEscape(src[i], classes);
+      *out++ = src[i];
     }
-    ret.push_back(c);
   }
-  str.insert(start, ret);
-  return ret.length();
+  if (quote) *out = quote;
+  return length;
+}
+
+size_t escapeKey(std::string& str, const size_t start, const std::string& key,
+                 const bool escapeEqual) {
+  return escape(str, start, key.data(), key.length(),
+                escapeEqual ? EscapeKey | EscapeEqual : EscapeKey);
 }
 
 size_t escapeValue(std::string& str, const size_t start,
                    const std::string& value) {
-  std::string ret;
-  ret.push_back('"');
-  for (auto c : value) {
-    switch (c) {
-      case '\\':
-      case '\"':
-        ret.push_back('\\');
-        break;
-    }
-    ret.push_back(c);
-  }
-  ret.push_back('"');
-  str.insert(start, ret);
-  return ret.length();
+  return escape(str, start, value.data(), value.length(), EscapeValue, '"');
 }
 
 constexpr char invalidChars[] = "$&+,/:;=?@ <>#%{}|\\^~[]`";
@@ -123,6 +162,46 @@ std::string urlEncode(const std::string& src) {
   return ret;
 }
 
+std::string escapeJSONString(const std::string& value) {
+  std::string ret;
+  ret.reserve(value.length() + value.length() / 10);
+  // most probably we will escape just double quotes
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        ret.append("\\\"");
+        break;
+      case '\\':
+        ret.append("\\\\");
+        break;
+      case '\b':
+        ret.append("\\b");
+        break;
+      case '\f':
+        ret.append("\\f");
+        break;
+      case '\n':
+        ret.append("\\n");
+        break;
+      case '\r':
+        ret.append("\\r");
+        break;
+      case '\t':
+        ret.append("\\t");
+        break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[7];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          ret.append(buf);
+        } else {
+          ret.push_back(c);
+        }
+    }
+  }
+  return ret;
+}
+
 bool isValidID(const std::string& idString) {
   return idString.length() == 16 &&
          idString.find_first_not_of("0123456789abcdefABCDEF") ==
@@ -131,7 +210,24 @@ bool isValidID(const std::string& idString) {
 
 const char* bool2string(const bool val) { return (val ? "true" : "false"); }
 
-size_t getNumLength(const long long l) { return std::to_string(l).length(); }
+size_t getNumLength(const long long l) {
+  return l < 0 ? countDigits(0 - (unsigned long long)l) + 1 : countDigits(l);
+}
+
+// CRC-32 by nibbles
+static const uint32_t CrcTable[] PROGMEM = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+    0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+uint32_t updateCrc32(uint32_t crc, const uint8_t* data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = pgm_read_dword(&CrcTable[(crc ^ data[i]) & 0x0F]) ^ (crc >> 4);
+    crc = pgm_read_dword(&CrcTable[(crc ^ (data[i] >> 4)) & 0x0F]) ^ (crc >> 4);
+  }
+  return ~crc;
+}
 
 bool endsWith(const std::string str, const std::string suffix) {
   return str.size() >= suffix.size() &&
@@ -61,12 +61,16 @@ size_t escapeValue(std::string& str, const size_t start,
 
 // Encode URL string for invalid chars
 std::string urlEncode(const std::string& src);
+// Escapes string to be used as a JSON string value, without quotes
+std::string escapeJSONString(const std::string& value);
 // Returns true of string contains valid InfluxDB ID type
 bool isValidID(const std::string& idString);
 // Returns "true" if val is true, otherwise "false"
 const char* bool2string(const bool val);
 // Returns number of digits
 size_t getNumLength(const long long l);
+// Updates CRC-32 (as used by gzip) of data. Start with crc 0
+uint32_t updateCrc32(uint32_t crc, const uint8_t* data, size_t len);
 
 bool endsWith(const std::string str, const std::string suffix);
 bool startsWith(const std::string str, const std::string suffix);
@@ -33,6 +33,10 @@
 #include <chrono>
 #include <memory>
 
+#if defined(ARDUINO)
+#include <LittleFS.h>
+#endif
+
 #include "../src/Version.h"
 #include "InfluxData.h"
 #include "TestSupport.h"
@@ -46,8 +50,11 @@ void Test::run() {
   testUtils();
   testOptions();
   testPoint();
+  testPointSchema();
+  testPointFields();
   testOldAPI();
   testBatch();
+  testLineProtocolEncoder();
   testLineProtocol();
   testEcaping();
   testUrlEncode();
@@ -74,7 +81,18 @@ void Test::run() {
   testV1();
   testUserAgent();
   testHTTPReadTimeout();
+  testHealthCheck();
+  testGzipWrite();
+  testFlushInBatches();
+  testWritePoints();
+  testStreamWritePoints();
+  testAsyncFlushAndQuery();
+  testConnectionPool();
+  testTLSState();
+  testPersistentQueue();
+  testBackgroundFlush();
   testDefaultTags();
+  testSeriesCache();
   // Advanced tests
   testLargeBatch();
   testFailedWrites();
@@ -103,6 +121,28 @@ void Test::testUtils() {
   TEST_ASSERTM(d == 1, std::to_string(d));
   d = getNumLength(12);
   TEST_ASSERTM(d == 2, std::to_string(d));
+  d = getNumLength(0);
+  TEST_ASSERTM(d == 1, std::to_string(d));
+  d = getNumLength(-123);
+  TEST_ASSERTM(d == 4, std::to_string(d));
+  d = getNumLength(-9223372036854775807LL - 1);
+  TEST_ASSERTM(d == 20, std::to_string(d));
+  auto ts = timeStampToString(18446744073709551615ULL);
+  TEST_ASSERTM(ts == "18446744073709551615", ts);
+  std::string esc = "m,";
+  d = escapeKey(esc, esc.length(), "t a=1,b\tc");
+  TEST_ASSERTM(d == 13 && esc == "m,t\\ a\\=1\\,b\\\tc", esc);
+  esc = "m ";
+  d = escapeKey(esc, 1, "a b=c", false);
+  TEST_ASSERTM(d == 6 && esc == "ma\\ b=c ", esc);
+  esc = "f=";
+  d = escapeValue(esc, esc.length(), "say \"hi\" C:\\");
+  TEST_ASSERTM(d == 17 && esc == "f=\"say \\\"hi\\\" C:\\\\\"", esc);
+  WriteOptions wo;
+  wo.addDefaultTag("b", "2").addDefaultTag("a b", "1").addDefaultTag("b", "3");
+  TEST_ASSERTM(wo._defaultTags == "a\\ b=1,b=3,", wo._defaultTags);
+  auto json = escapeJSONString("a\"b\\c\n\x01\xc3\xa9");
+  TEST_ASSERTM(json == "a\\\"b\\\\c\\n\\u0001\xc3\xa9", json);
   TEST_END();
 }
 
@@ -114,8 +154,17 @@ void Test::testOptions() {
   TEST_ASSERT(defWO._bufferSize == 5);
   TEST_ASSERT(defWO._flushInterval == std::chrono::seconds{60});
   TEST_ASSERT(defWO._retryInterval == std::chrono::seconds{5});
+  TEST_ASSERT(defWO._maxRetryInterval == std::chrono::seconds{300});
+  TEST_ASSERT(defWO._maxRetryAttempts == 0);
+  TEST_ASSERT(defWO._retryJitter);
   TEST_ASSERT(defWO._defaultTags.length() == 0);
   TEST_ASSERT(!defWO._useServerTimestamp);
+  TEST_ASSERT(defWO._healthCheckPolicy == HealthCheckPolicy::OnFailureOrIdle);
+  TEST_ASSERT(defWO._healthCheckTTL == std::chrono::seconds{60});
+  TEST_ASSERT(defWO._maxBatchBytes == 0);
+  TEST_ASSERT(defWO._queueDir.empty());
+  TEST_ASSERT(defWO._queueSegmentSize == 16384);
+  TEST_ASSERT(defWO._queueSyncInterval == 10);
 
   defWO = WriteOptions()
               .writePrecision(WritePrecision::NS)
@@ -123,24 +172,45 @@ void Test::testOptions() {
               .bufferSize(20)
               .flushInterval(std::chrono::seconds{120})
               .retryInterval(std::chrono::seconds{1})
+              .maxRetryInterval(std::chrono::seconds{60})
+              .maxRetryAttempts(3)
+              .retryJitter(false)
               .addDefaultTag("tag1", "val1")
               .addDefaultTag("tag2", "val2")
-              .useServerTimestamp(true);
+              .useServerTimestamp(true)
+              .healthCheckPolicy(HealthCheckPolicy::Always)
+              .healthCheckTTL(std::chrono::seconds{10})
+              .maxBatchBytes(4096)
+              .persistentQueue("/queue", 4096, 5);
   TEST_ASSERT(defWO._writePrecision == WritePrecision::NS);
   TEST_ASSERT(defWO._batchSize == 32000);
   TEST_ASSERT(defWO._bufferSize == 20);
   TEST_ASSERT(defWO._flushInterval == std::chrono::seconds{120});
   TEST_ASSERT(defWO._retryInterval == std::chrono::seconds{1});
+  TEST_ASSERT(defWO._maxRetryInterval == std::chrono::seconds{60});
+  TEST_ASSERT(defWO._maxRetryAttempts == 3);
+  TEST_ASSERT(!defWO._retryJitter);
   TEST_ASSERT(defWO._defaultTags == "tag1=val1,tag2=val2");
   TEST_ASSERT(defWO._useServerTimestamp);
+  TEST_ASSERT(defWO._healthCheckPolicy == HealthCheckPolicy::Always);
+  TEST_ASSERT(defWO._healthCheckTTL == std::chrono::seconds{10});
+  TEST_ASSERT(defWO._maxBatchBytes == 4096);
+  TEST_ASSERT(defWO._queueDir == "/queue");
+  TEST_ASSERT(defWO._queueSegmentSize == 4096);
+  TEST_ASSERT(defWO._queueSyncInterval == 5);
 
   HTTPOptions defHO;
   TEST_ASSERT(!defHO._connectionReuse);
   TEST_ASSERT(defHO._httpReadTimeout == 5000);
+  TEST_ASSERT(defHO._compressionLevel == 0);
 
-  defHO = HTTPOptions().connectionReuse(true).httpReadTimeout(20000);
+  defHO = HTTPOptions()
+              .connectionReuse(true)
+              .httpReadTimeout(20000)
+              .compressionLevel(12);
   TEST_ASSERT(defHO._connectionReuse);
   TEST_ASSERT(defHO._httpReadTimeout == 20000);
+  TEST_ASSERT(defHO._compressionLevel == 9);
 
   InfluxDBClient c;
   TEST_ASSERT(c._writeOptions._writePrecision == WritePrecision::NoTime);
@@ -186,13 +256,13 @@ void Test::testOptions() {
 
   defWO = WriteOptions().batchSize(100).bufferSize(7000);
   c.setWriteOptions(defWO);
-  TEST_ASSERTM(c._writeBuffer->buffer.capacity() == 70,
-               std::to_string(c._writeBuffer->buffer.capacity()));
+  TEST_ASSERTM(c._writeBuffer->getBufferSize() == 700000,
+               std::to_string(c._writeBuffer->getBufferSize()));
 
   defWO = WriteOptions().batchSize(10).bufferSize(7000);
   c.setWriteOptions(defWO);
-  TEST_ASSERTM(c._writeBuffer->buffer.capacity() == 255,
-               std::to_string(c._writeBuffer->buffer.capacity()));
+  TEST_ASSERTM(c._writeBuffer->getCapacity() == 0,
+               std::to_string(c._writeBuffer->getCapacity()));
 
   TEST_END();
 }
@@ -389,6 +459,22 @@ void Test::testPoint() {
   TEST_ASSERT(!p.hasFields());
   p.addField("nan", (double)NAN);
   TEST_ASSERT(!p.hasFields());
+  p.addField("inf", (float)INFINITY);
+  TEST_ASSERT(!p.hasFields());
+  p.addField("inf", -(double)INFINITY);
+  TEST_ASSERT(!p.hasFields());
+
+  p.addField("f", 21.3f, -1);
+  p.addField("d", 0.1 + 0.2, -1);
+  p.addField("e", -2.5e-7, -1);
+  p.addField("l", 1e20, 2);
+  p.addField("r", 2.675, 2);
+  p.addField("z", 0.0, 0);
+  line = p.toLineProtocol();
+  TEST_ASSERTM(line == "test f=21.3,d=0.30000000000000004,e=-2.5e-07,"
+                       "l=1e+20,r=2.67,z=0\n",
+               line);
+  p.clearFields();
 
   p.addField("a", 1);
   p.addTag("t", "a");
@@ -405,6 +491,128 @@ void Test::testPoint() {
   TEST_END();
 }
 
+void Test::testPointSchema() {
+  TEST_INIT("testPointSchema");
+  PointSchema schema("air quality");
+  // tags are sorted by key
+  schema.addTag("sensor", "SCD=30").addTag("location", "living room");
+  TEST_ASSERTM(schema.getSeries() ==
+                   "air\\ quality,location=living\\ room,sensor=SCD\\=30",
+               schema.getSeries());
+  auto co2 = schema.field("co2 ppm");
+  auto temperature = schema.field("temperature");
+  auto status = schema.field("status");
+  TEST_ASSERTM(co2.getKey() == "co2\\ ppm=", co2.getKey());
+
+  Point p(schema);
+  p.addField(co2, 612).addField(temperature, 21.456).addField(status, "ok");
+  p.setTime(1600000000ULL);
+  std::string testLine =
+      "air\\ quality,location=living\\ room,sensor=SCD\\=30 "
+      "co2\\ ppm=612i,temperature=21.46,status=\"ok\" 1600000000\n";
+  auto line = p.toLineProtocol();
+  TEST_ASSERTM(line == testLine, line);
+
+  // tags of point are merged with tags of schema
+  p.addTag("room", "1").addTag("location", "kitchen");
+  testLine =
+      "air\\ quality,location=kitchen,room=1,sensor=SCD\\=30 "
+      "co2\\ ppm=612i,temperature=21.46,status=\"ok\" 1600000000\n";
+  line = p.toLineProtocol();
+  TEST_ASSERTM(line == testLine, line);
+
+  // same point written by name
+  Point p2("air quality");
+  p2.addTag("sensor", "SCD=30").addTag("location", "living room");
+  p2.addTag("room", "1").addTag("location", "kitchen");
+  p2.addField("co2 ppm", 612).addField("temperature", 21.456);
+  p2.addField("status", "ok");
+  p2.setTime(1600000000ULL);
+  line = p2.toLineProtocol();
+  TEST_ASSERTM(line == testLine, line);
+
+  // default tags are joined to the prefix and the prefix is rebuilt when they
+  // change
+  WriteOptions wo;
+  wo.addDefaultTag("dev", "esp 32");
+  p.clearFields();
+  p.clearTags();
+  p.addField(co2, 600u);
+  line = p.toLineProtocol(wo._defaultTags);
+  testLine =
+      "air\\ quality,dev=esp\\ 32,location=living\\ room,sensor=SCD\\=30 "
+      "co2\\ ppm=600i\n";
+  TEST_ASSERTM(line == testLine, line);
+  TEST_ASSERT(p._data->lineProtocolLength(wo._defaultTags) == testLine.length());
+  line = p.toLineProtocol();
+  testLine = "air\\ quality,location=living\\ room,sensor=SCD\\=30 "
+             "co2\\ ppm=600i\n";
+  TEST_ASSERTM(line == testLine, line);
+  wo.addDefaultTag("fw", "1.0");
+  line = p.toLineProtocol(wo._defaultTags);
+  testLine =
+      "air\\ quality,dev=esp\\ 32,fw=1.0,location=living\\ room,"
+      "sensor=SCD\\=30 co2\\ ppm=600i\n";
+  TEST_ASSERTM(line == testLine, line);
+
+  // legacy API
+  InfluxData d(schema);
+  d.addValue(temperature, 20.5);
+  d.setTimestamp(1600000000l);
+  line = d.toString();
+  testLine = "air\\ quality,location=living\\ room,sensor=SCD\\=30 "
+             "temperature=20.50 1600000000000000000\n";
+  TEST_ASSERTM(line == testLine, line);
+
+  TEST_END();
+}
+
+void Test::testPointFields() {
+  TEST_INIT("testPointFields");
+  Point p("test");
+  p.addField("a", 1).addField("b", 2.5f).addField("c", "x");
+  p.setTime(1600000000ULL);
+  auto line = p.toLineProtocol();
+  TEST_ASSERTM(line == "test a=1i,b=2.50,c=\"x\" 1600000000\n", line);
+
+  // value of existing field is replaced, order is kept
+  p.setField("a", 2).setField("b", -1.25, 1).addField("d", true);
+  line = p.toLineProtocol();
+  TEST_ASSERTM(line == "test a=2i,b=-1.3,c=\"x\",d=true 1600000000\n", line);
+
+  // field can change type
+  p.setField("c", 3u);
+  line = p.toLineProtocol();
+  TEST_ASSERTM(line == "test a=2i,b=-1.3,c=3i,d=true 1600000000\n", line);
+  TEST_ASSERT(p._data->lineProtocolLength("") == line.length());
+
+  // NaN removes the field
+  p.setField("b", (float)NAN);
+  line = p.toLineProtocol();
+  TEST_ASSERTM(line == "test a=2i,c=3i,d=true 1600000000\n", line);
+  p.setField("a", (double)INFINITY).setField("c", (double)NAN);
+  p.setField("d", (double)NAN);
+  TEST_ASSERT(!p.hasFields());
+
+  // removed entries are reused
+  p.setField("e f", "g\"h").setField("a", 1);
+  line = p.toLineProtocol();
+  TEST_ASSERTM(line == "test e\\ f=\"g\\\"h\",a=1i 1600000000\n", line);
+  TEST_ASSERT(p._data->fieldCount == 2);
+  TEST_ASSERT(p._data->fieldList.size() == 4);
+
+  // schema and name keys address the same field
+  PointSchema schema("test");
+  auto a = schema.field("a");
+  Point p2(schema);
+  p2.addField("a", 1).addField(a, 5).addField("b", 1);
+  p2.setField(a, 6);
+  line = p2.toLineProtocol();
+  TEST_ASSERTM(line == "test a=6i,b=1i\n", line);
+
+  TEST_END();
+}
+
 void Test::testOldAPI() {
   TEST_INIT("testOldAPI");
   InfluxData d("a"), p("b");
@@ -424,55 +632,103 @@ void Test::testBatch() {
   TEST_INIT("testBatch");
   InfluxDBClient::Batch batch(2);
   TEST_ASSERT(batch.getBufferSize() == 2);
-  // TEST_ASSERT(batch.pointer == 0);
-  TEST_ASSERT(batch.buffer.empty());
+  TEST_ASSERT(batch.getLength() == 0);
   TEST_ASSERT(batch.isEmpty());
   TEST_ASSERT(!batch.isFull());
-  const char *line = "air,location=Zdiby,sensor=STH31 temp=22.1,hum=44";
+  const char *line = "air,location=Zdiby,sensor=STH31 temp=22.1,hum=44\n";
+  const uint32_t len = strlen(line);
+  batch.reserve(3 * len);
+  TEST_ASSERT(batch.getCapacity() == 3 * len);
   TEST_ASSERT(!batch.append(line));
   TEST_ASSERT(!batch.isEmpty());
   TEST_ASSERT(!batch.isFull());
   TEST_ASSERT(batch.append(line));
   TEST_ASSERT(!batch.isEmpty());
   TEST_ASSERT(batch.isFull());
-  // TEST_ASSERT(batch.pointer == 2);
-
-  // InfluxDBClient::BatchStreamer str(&batch);
-  // auto len = strlen(line);
-  // TEST_ASSERT(str.available() == len * 2 + 2);
-  // int size = str.available() + 1;
-  // std::unique_ptr<char[]> buff{new char[size]};
-  // TEST_ASSERT(str.readBytes(buff.get(), len + 1) == len + 1);
-  // TEST_ASSERT(str.peek() == 'a');
-  // TEST_ASSERT(str.available() == len + 1);
-  // TEST_ASSERT(str.readBytes(buff.get() + len + 1, len) == len);
-  // TEST_ASSERT(str.peek() == '\n');
-  // TEST_ASSERT(str.available() == 1);
-  // TEST_ASSERT(str.readBytes(buff.get() + 2 * len + 1, 1) == 1);
-  // TEST_ASSERT(str.peek() == -1);
-  // TEST_ASSERT(str.available() == 0);
-  // buff[size - 1] = 0;
-  // Serial.println(buff.get());
-  // int i;
-  // for (i = 0; i < strlen(line); i++) {
-  //   TEST_ASSERT(buff[i] == line[i]);
-  // }
-  // TEST_ASSERT(buff[i++] == '\n');
-  // for (int j = 0; j < strlen(line); j++) {
-  //   TEST_ASSERT(buff[i++] == line[j]);
-  // }
-  // TEST_ASSERT(buff[i++] == '\n');
-  // buff[0] = 0;
-  // str.reset();
-  // // Test Stream API
-  // Stream *s = &str;
-  // TEST_ASSERT(s->available() == len * 2 + 2);
-  // TEST_ASSERT(s->readBytes(buff.get(), len + 1) == len + 1);
-  // TEST_ASSERT(s->available() == len + 1);
-  // TEST_ASSERT(s->readBytes(buff.get() + len + 1, len) == len);
-  // TEST_ASSERT(s->available() == 1);
-  // TEST_ASSERT(s->readBytes(buff.get() + 2 * len + 1, 1) == 1);
-  // TEST_ASSERT(s->available() == 0);
+  TEST_ASSERT(batch.getLength() == 2 * len);
+
+  InfluxDBClient::BatchStreamer str(&batch);
+  TEST_ASSERT(str.available() == (int)(len * 2));
+  std::unique_ptr<char[]> buff{new char[3 * len + 1]};
+  TEST_ASSERT(str.readBytes(buff.get(), len + 1) == len + 1);
+  TEST_ASSERT(str.peek() == 'i');
+  TEST_ASSERT(str.available() == (int)(len - 1));
+  TEST_ASSERT(str.readBytes(buff.get() + len + 1, len) == len - 1);
+  TEST_ASSERT(str.peek() == -1);
+  TEST_ASSERT(str.available() == 0);
+  TEST_ASSERT(!memcmp(buff.get(), line, len));
+  TEST_ASSERT(!memcmp(buff.get() + len, line, len));
+
+  // third line still fits, fourth wraps around and evicts the oldest line
+  const char *line2 = "air,location=Praha temp=20.1,hum=40\n";
+  const uint32_t len2 = strlen(line2);
+  batch.append(line);
+  TEST_ASSERT(batch.getNumPoints() == 3);
+  batch.append(line2);
+  TEST_ASSERTM(batch.getNumPoints() == 3, std::to_string(batch.getNumPoints()));
+  TEST_ASSERT(batch.getLength() == 2 * len + len2);
+  TEST_ASSERT(batch.getCapacity() == 3 * len);
+  uint32_t len0, len1;
+  batch.getSpan(0, len0);
+  batch.getSpan(1, len1);
+  TEST_ASSERTM(len0 == 2 * len && len1 == len2,
+               std::to_string(len0) + "," + std::to_string(len1));
+
+  // wrapped content is streamed in order
+  str.reset();
+  TEST_ASSERT(str.available() == (int)(2 * len + len2));
+  TEST_ASSERT(str.readBytes(buff.get(), 3 * len) == 2 * len + len2);
+  TEST_ASSERT(!memcmp(buff.get(), line, len));
+  TEST_ASSERT(!memcmp(buff.get() + len, line, len));
+  TEST_ASSERT(!memcmp(buff.get() + 2 * len, line2, len2));
+
+  // line larger than the capacity enlarges the buffer
+  std::string large(4 * len, 'x');
+  large += '\n';
+  batch.append(large.c_str());
+  TEST_ASSERT(batch.getNumPoints() == 1);
+  TEST_ASSERT(batch.getCapacity() == large.length());
+
+  batch.clear();
+  TEST_ASSERT(batch.isEmpty());
+  TEST_ASSERT(batch.getLength() == 0);
+  batch.release();
+  TEST_ASSERT(batch.getCapacity() == 0);
+
+  TEST_END();
+}
+
+void Test::testLineProtocolEncoder() {
+  TEST_INIT("testLineProtocolEncoder");
+  const std::string defaultTags = "dtag=val,";
+  InfluxDBClient::Batch batch(5);
+  batch.reserve(200);
+  std::string lines;
+  for (int i = 0; i < 5; i++) {
+    Point p("test");
+    p.addTag("tag1", "tagvalue");
+    p.addField("index", i);
+    p.addField("text", "a \"b\"");
+    if (i % 2) {
+      p.setTime(1234567890ull + i);
+    }
+    const bool excludeTimestamp = i == 3;
+    auto &data = *p._data;
+    auto length = data.lineProtocolLength(defaultTags, excludeTimestamp);
+    batch.beginLine(length);
+    data.writeLineProtocol(batch, defaultTags, excludeTimestamp);
+    batch.endLine();
+    auto &line = p.createLineProtocol(defaultTags, excludeTimestamp);
+    TEST_ASSERTM(line.length() == length, line);
+    lines += line;
+  }
+  // buffer keeps the latest lines that fit
+  TEST_ASSERT(batch.getNumPoints() < 5);
+  InfluxDBClient::BatchStreamer str(&batch);
+  std::string encoded(str.available(), '\0');
+  str.readBytes(&encoded[0], encoded.length());
+  TEST_ASSERTM(lines.substr(lines.length() - encoded.length()) == encoded,
+               encoded);
 
   TEST_END();
 }
@@ -779,6 +1035,527 @@ void Test::testUserAgent() {
   TEST_END();
 }
 
+static int getHealthChecksCount() {
+  auto url = std::string(Test::apiUrl) + "/test/health-checks";
+  WiFiClient wifiClient;
+  HTTPClient http;
+  if (!http.begin(wifiClient, url.c_str()) || http.GET() != 200) {
+    return -1;
+  }
+  int count = http.getString().toInt();
+  http.end();
+  return count;
+}
+
+void Test::testHealthCheck() {
+  TEST_INIT("testHealthCheck");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  waitServer(Test::managementUrl, true);
+  int checks = getHealthChecksCount();
+  TEST_ASSERT(checks >= 0);
+  // first write validates connection, next ones are within TTL
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT(client.writeRecord("test,tag=a index=" + std::to_string(i)));
+  }
+  TEST_ASSERTM(getHealthChecksCount() == checks + 1,
+               std::to_string(getHealthChecksCount()));
+
+  // failed write triggers validation before the next one
+  waitServer(Test::managementUrl, false);
+  TEST_ASSERT(!client.writeRecord("test,tag=a index=3"));
+  TEST_ASSERT(!client._healthy);
+  client._nextRetry = std::chrono::steady_clock::time_point::min();
+  waitServer(Test::managementUrl, true);
+  checks = getHealthChecksCount();
+  TEST_ASSERT(client.flushBuffer());
+  TEST_ASSERTM(getHealthChecksCount() == checks + 1,
+               std::to_string(getHealthChecksCount()));
+
+  // idle longer than TTL
+  client.setWriteOptions(WriteOptions().healthCheckTTL(std::chrono::seconds{1}));
+  delay(1100);
+  TEST_ASSERT(client.writeRecord("test,tag=a index=4"));
+  TEST_ASSERTM(getHealthChecksCount() == checks + 2,
+               std::to_string(getHealthChecksCount()));
+
+  client.setWriteOptions(
+      WriteOptions().healthCheckPolicy(HealthCheckPolicy::Always));
+  TEST_ASSERT(client.writeRecord("test,tag=a index=5"));
+  TEST_ASSERT(client.writeRecord("test,tag=a index=6"));
+  TEST_ASSERTM(getHealthChecksCount() == checks + 4,
+               std::to_string(getHealthChecksCount()));
+
+  client.setWriteOptions(
+      WriteOptions().healthCheckPolicy(HealthCheckPolicy::Never));
+  TEST_ASSERT(client.writeRecord("test,tag=a index=7"));
+  TEST_ASSERTM(getHealthChecksCount() == checks + 4,
+               std::to_string(getHealthChecksCount()));
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+static std::string getLastContentEncoding() {
+  auto url = std::string(Test::apiUrl) + "/test/content-encoding";
+  WiFiClient wifiClient;
+  HTTPClient http;
+  if (!http.begin(wifiClient, url.c_str()) || http.GET() != 200) {
+    return "error";
+  }
+  std::string encoding = http.getString().c_str();
+  http.end();
+  return encoding;
+}
+
+void Test::testGzipWrite() {
+  TEST_INIT("testGzipWrite");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  client.setWriteOptions(WriteOptions().batchSize(25).bufferSize(2));
+  client.setHTTPOptions(HTTPOptions().compressionLevel(6));
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERT(client.validateConnection());
+  for (int i = 0; i < 50; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERTM(client.writePoint(*p.get()), client.getLastErrorMessage());
+  }
+  TEST_ASSERT(client.isBufferEmpty());
+  TEST_ASSERTM(getLastContentEncoding() == "gzip", getLastContentEncoding());
+  FluxQueryResult q = client.query("select");
+  auto lines = getLines(q);
+  TEST_ASSERTM(q.getError() == "", q.getError());
+  TEST_ASSERTM(lines.size() == 50, std::to_string(lines.size()));
+  TEST_ASSERT(lines[0].find(",0") != std::string::npos);
+  TEST_ASSERT(lines[49].find(",49") != std::string::npos);
+  deleteAll(Test::apiUrl);
+
+  // V1
+  InfluxDBClient clientV1;
+  clientV1.setConnectionParamsV1(Test::apiUrl, Test::dbName, "user",
+                                 "my secret password");
+  clientV1.setHTTPOptions(HTTPOptions().compressionLevel(1));
+  for (int i = 0; i < 5; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERTM(clientV1.writePoint(*p.get()),
+                 clientV1.getLastErrorMessage());
+  }
+  TEST_ASSERTM(getLastContentEncoding() == "gzip", getLastContentEncoding());
+  q = clientV1.query("select");
+  TEST_ASSERTM(countLines(q) == 5, q.getError());
+
+  // compression disabled
+  client.setHTTPOptions(HTTPOptions().compressionLevel(0));
+  client.setWriteOptions(WriteOptions().batchSize(1));
+  std::unique_ptr<Point> p{createPoint("test1")};
+  p->addField("index", 100);
+  TEST_ASSERT(client.writePoint(*p.get()));
+  TEST_ASSERTM(getLastContentEncoding() == "", getLastContentEncoding());
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testFlushInBatches() {
+  TEST_INIT("testFlushInBatches");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  client.setWriteOptions(
+      WriteOptions().batchSize(5).bufferSize(4).retryJitter(false));
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERT(client.validateConnection());
+  for (int i = 0; i < 20; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    if (i == 10) {
+      // server responds 503 to the batch starting with this point
+      p->addTag("direction", "status");
+      p->addTag("x-code", "503");
+    }
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p.get(), false));
+  }
+  TEST_ASSERT(client._writeBuffer->getNumPoints() == 20);
+  uint32_t length;
+  TEST_ASSERT(client.nextBatch(*client._writeBuffer, length) == 5);
+  TEST_ASSERT(length == client._writeBuffer->getLinesLength(5));
+  // stops at the first retryable failure, written batches are removed
+  TEST_ASSERT(!client.flushBuffer());
+  TEST_ASSERTM(client._writeBuffer->getNumPoints() == 10,
+               std::to_string(client._writeBuffer->getNumPoints()));
+  TEST_ASSERT(!client.canSendRequest());
+  FluxQueryResult q = client.query("select");
+  TEST_ASSERTM(countLines(q) == 10, q.getError());
+
+  // remove failing point and send the rest
+  client._writeBuffer->drop(1);
+  client._nextRetry = std::chrono::steady_clock::time_point::min();
+  TEST_ASSERT(client.flushBuffer());
+  TEST_ASSERT(client.isBufferEmpty());
+  q = client.query("select");
+  auto lines = getLines(q);
+  TEST_ASSERTM(lines.size() == 19, std::to_string(lines.size()));
+  TEST_ASSERT(lines[18].find(",19") != std::string::npos);
+  deleteAll(Test::apiUrl);
+
+  // batch rejected by server is skipped
+  for (int i = 0; i < 15; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    if (i == 5) {
+      p->addTag("direction", "status");
+      p->addTag("x-code", "400");
+    }
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p.get(), false));
+  }
+  TEST_ASSERT(!client.flushBuffer());
+  TEST_ASSERT(client.isBufferEmpty());
+  TEST_ASSERT(client.canSendRequest());
+  q = client.query("select");
+  TEST_ASSERTM(countLines(q) == 10, q.getError());
+  deleteAll(Test::apiUrl);
+
+  // byte limit
+  for (int i = 0; i < 3; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p.get(), false));
+  }
+  auto lineLength = client._writeBuffer->getLinesLength(1);
+  client.setWriteOptions(
+      WriteOptions().batchSize(5).bufferSize(4).maxBatchBytes(lineLength * 2));
+  TEST_ASSERT(client.nextBatch(*client._writeBuffer, length) == 2);
+  TEST_ASSERT(length == lineLength * 2);
+  client.setWriteOptions(
+      WriteOptions().batchSize(5).bufferSize(4).maxBatchBytes(1));
+  TEST_ASSERT(client.nextBatch(*client._writeBuffer, length) == 1);
+  TEST_ASSERT(client.flushBuffer());
+  q = client.query("select");
+  TEST_ASSERTM(countLines(q) == 3, q.getError());
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testWritePoints() {
+  TEST_INIT("testWritePoints");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  client.setWriteOptions(WriteOptions().batchSize(5).bufferSize(2));
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERT(client.validateConnection());
+  std::vector<Point> points;
+  for (int i = 0; i < 100; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    points.push_back(*p);
+  }
+  TEST_ASSERT(client.writePoints(points.data(), 3, false));
+  TEST_ASSERT(client._writeBuffer->getNumPoints() == 3);
+  // lines are the same as written by writePoint
+  TEST_ASSERT(client.writePoint(points[3], false));
+  TEST_ASSERT(client._writeBuffer->getLinesLength(4) ==
+              client._writeBuffer->getLinesLength(1) * 4);
+  client.resetBuffer();
+
+  // point without fields is skipped
+  Point empty("test1");
+  Point some[] = {points[0], empty, points[1]};
+  TEST_ASSERT(!client.writePoints(some, 3, false));
+  TEST_ASSERT(client._writeBuffer->getNumPoints() == 2);
+  client.resetBuffer();
+
+  // burst larger than buffer, full batches are flushed before they would be
+  // overwritten
+  TEST_ASSERT(client.writePoints(points.begin(), points.end()));
+  TEST_ASSERT(client.flushBuffer());
+  FluxQueryResult q = client.query("select");
+  auto lines = getLines(q);
+  TEST_ASSERTM(lines.size() == 100, std::to_string(lines.size()));
+  TEST_ASSERT(lines[99].find(",99") != std::string::npos);
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testStreamWritePoints() {
+  TEST_INIT("testStreamWritePoints");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  client.setStreamWrite(true);
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERT(client.validateConnection());
+  std::vector<Point> points;
+  for (int i = 0; i < 100; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    points.push_back(*p);
+  }
+  // point without fields is skipped, others are written
+  points[50].clearFields();
+  TEST_ASSERT(!client.writePoints(points.begin(), points.end()));
+  TEST_ASSERT(client.writePoint(points[0]));
+  FluxQueryResult q = client.query("select");
+  auto lines = getLines(q);
+  TEST_ASSERTM(lines.size() == 100, std::to_string(lines.size()));
+  TEST_ASSERT(lines[98].find(",99") != std::string::npos);
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testAsyncFlushAndQuery() {
+  TEST_INIT("testAsyncFlushAndQuery");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  client.setWriteOptions(WriteOptions().batchSize(10).bufferSize(50));
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERT(client.validateConnection());
+  for (int i = 0; i < 35; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p));
+  }
+  int flushed = -1;
+  TEST_ASSERTM(client.flushBufferAsync([&](bool success) { flushed = success; }),
+               client.getLastErrorMessage());
+  // only one request at a time
+  TEST_ASSERT(!client.flushBufferAsync());
+  // points written during flush stay in the buffer
+  std::unique_ptr<Point> p{createPoint("test1")};
+  p->addField("index", 35);
+  TEST_ASSERT(client.writePoint(*p));
+  int polls = 0;
+  while (client.poll()) {
+    polls++;
+    delay(1);
+  }
+  TEST_ASSERTM(flushed == 1, client.getLastErrorMessage());
+  TEST_ASSERTM(polls > 0, std::to_string(polls));
+  TEST_ASSERT(!client.isBufferEmpty());
+  TEST_ASSERT(client.flushBuffer());
+
+  std::vector<std::string> lines;
+  TEST_ASSERTM(client.queryAsync("select",
+                                 [&](FluxQueryResult q) { lines = getLines(q); }),
+               client.getLastErrorMessage());
+  while (client.poll()) {
+    delay(1);
+  }
+  TEST_ASSERTM(lines.size() == 36, std::to_string(lines.size()));
+  // synchronous request reuses the connection
+  FluxQueryResult q = client.query("select");
+  TEST_ASSERTM(getLines(q).size() == 36, q.getError());
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testConnectionPool() {
+  TEST_INIT("testConnectionPool");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  client.setHTTPOptions(
+      HTTPOptions().connectionReuse(true).connectionPoolSize(2).connectionIdleTimeout(500));
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERT(client.validateConnection());
+  for (int i = 0; i < 20; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p));
+  }
+  TEST_ASSERT(client._pool.empty());
+  FluxQueryResult q = client.query("select");
+  int rows = 0;
+  while (q.next()) {
+    if (++rows == 10) {
+      // written using the second connection, query continues
+      std::unique_ptr<Point> p{createPoint("test1")};
+      p->addField("index", 20);
+      TEST_ASSERTM(client.writePoint(*p), client.getLastErrorMessage());
+    }
+  }
+  TEST_ASSERTM(q.getError() == "", q.getError());
+  TEST_ASSERTM(rows == 20, std::to_string(rows));
+  q.close();
+  TEST_ASSERTM(client._pool.size() == 1, std::to_string(client._pool.size()));
+  TEST_ASSERT(client._service->isIdle());
+
+  q = client.query("select");
+  auto lines = getLines(q);
+  TEST_ASSERTM(lines.size() == 21, std::to_string(lines.size()));
+  // unused connections are closed after idle timeout
+  TEST_ASSERT(client.isConnected());
+  delay(600);
+  client.poll();
+  TEST_ASSERT(!client.isConnected());
+  // the timeout counts also requests not changing last request time
+  TEST_ASSERT(client.validateConnection());
+  client.poll();
+  TEST_ASSERT(client.isConnected());
+
+  // with a single connection reserved by the query, write uses a temporary one
+  client.setHTTPOptions(HTTPOptions().connectionReuse(true));
+  q = client.query("select");
+  rows = 0;
+  while (q.next()) {
+    if (++rows == 10) {
+      std::unique_ptr<Point> p{createPoint("test1")};
+      p->addField("index", 21);
+      TEST_ASSERTM(client.writePoint(*p), client.getLastErrorMessage());
+    }
+  }
+  TEST_ASSERTM(q.getError() == "", q.getError());
+  TEST_ASSERTM(rows == 21, std::to_string(rows));
+  q.close();
+  TEST_ASSERTM(client._temporary.size() == 1,
+               std::to_string(client._temporary.size()));
+  TEST_ASSERT(!client._temporary[0]->isConnected());
+
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testTLSState() {
+  TEST_INIT("testTLSState");
+  InfluxDBClient client("https://localhost:8086/", Test::orgName,
+                        Test::bucketName, Test::token);
+  TLSState state = client.getTLSState();
+  TEST_ASSERT(state.isValid());
+  TEST_ASSERT(state.belongsTo("https://localhost:8086"));
+  TEST_ASSERT(state.mfln == TLSState::MflnUnknown);
+  // e.g. restored after deep sleep
+  state.mfln = TLSState::MflnSupported;
+  TEST_ASSERT(!client.setTLSState(state));
+  state.seal();
+  TEST_ASSERTM(client.setTLSState(state), client.getLastErrorMessage());
+  TEST_ASSERT(client.getTLSState().mfln == TLSState::MflnSupported);
+  // state of another server
+  InfluxDBClient other("https://localhost:8087", Test::orgName,
+                       Test::bucketName, Test::token);
+  TEST_ASSERT(!other.setTLSState(state));
+  TEST_ASSERT(other.getLastErrorMessage() == "Invalid TLS state");
+  // uninitialized memory
+  memset((void *)&state, 0x55, sizeof(state));
+  TEST_ASSERT(!client.setTLSState(state));
+  TEST_ASSERT(client.getTLSState().mfln == TLSState::MflnSupported);
+
+  TEST_END();
+}
+
+void Test::testPersistentQueue() {
+  TEST_INIT("testPersistentQueue");
+#if defined(ESP8266)
+  TEST_ASSERT(LittleFS.begin());
+#elif defined(ARDUINO)
+  TEST_ASSERT(LittleFS.begin(true));
+#endif
+  auto options =
+      WriteOptions().batchSize(2).bufferSize(5).retryJitter(false).persistentQueue(
+          "/influxdb-test-queue", 512, 1);
+  uint32_t buffered = 0;
+  {
+    InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                          Test::token);
+    TEST_ASSERTM(client.setWriteOptions(options), client.getLastErrorMessage());
+    TEST_ASSERT(client._queue);
+    waitServer(Test::managementUrl, false);
+    for (int i = 10; i < 60; i++) {
+      std::unique_ptr<Point> p{createPoint("test1")};
+      p->addField("index", i);
+      client.writePoint(*p.get());
+    }
+    // the oldest points are overwritten in buffer and removed also from queue
+    buffered = client._writeBuffer->getNumPoints();
+    TEST_ASSERTM(buffered >= 10 && buffered < 50, std::to_string(buffered));
+    TEST_ASSERT(client._queue->size() == buffered);
+    // persistent queue cannot be enabled when buffer has data
+    InfluxDBClient other(Test::apiUrl, Test::orgName, Test::bucketName,
+                         Test::token);
+    TEST_ASSERT(other.writeRecord("test1,tag=a index=0i", false));
+    TEST_ASSERT(!other.setWriteOptions(options));
+  }
+  // simulates restart
+  waitServer(Test::managementUrl, true);
+  {
+    InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                          Test::token);
+    TEST_ASSERTM(client.setWriteOptions(options), client.getLastErrorMessage());
+    TEST_ASSERT(client._writeBuffer->getNumPoints() == buffered);
+    TEST_ASSERT(client._writeBuffer->_write);
+    TEST_ASSERT(client.checkBuffer());
+    TEST_ASSERT(client.isBufferEmpty());
+    TEST_ASSERT(client._queue->size() == 0);
+    FluxQueryResult q = client.query("select");
+    auto lines = getLines(q);
+    TEST_ASSERTM(lines.size() == buffered, std::to_string(lines.size()));
+    TEST_ASSERT(lines[buffered - 1].find(",59") != std::string::npos);
+    // nothing is replayed after successful write
+    InfluxDBClient again(Test::apiUrl, Test::orgName, Test::bucketName,
+                         Test::token);
+    TEST_ASSERT(again.setWriteOptions(
+        WriteOptions().persistentQueue("/influxdb-test-queue/")));
+    TEST_ASSERT(again.isBufferEmpty());
+  }
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
+void Test::testBackgroundFlush() {
+  TEST_INIT("testBackgroundFlush");
+  InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
+                        Test::token);
+  TEST_ASSERT(client.setWriteOptions(
+      WriteOptions().batchSize(5).bufferSize(20).retryJitter(false)));
+#if defined(ESP8266)
+  TEST_ASSERT(!client.setBackgroundFlush());
+  TEST_ASSERTM(client.getLastErrorMessage() ==
+                   "Background flush is not supported on this platform",
+               client.getLastErrorMessage());
+#else
+  waitServer(Test::managementUrl, true);
+  TEST_ASSERTM(client.setBackgroundFlush(), client.getLastErrorMessage());
+  TEST_ASSERT(client._worker.isRunning());
+  for (int i = 0; i < 12; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p.get()));
+  }
+  // waits for the task to write everything
+  TEST_ASSERTM(client.flushBuffer(), client.getLastErrorMessage());
+  TEST_ASSERT(client.isBufferEmpty());
+  FluxQueryResult q = client.query("select");
+  auto lines = getLines(q);
+  TEST_ASSERTM(lines.size() == 12, std::to_string(lines.size()));
+  deleteAll(Test::apiUrl);
+
+  // lines not written by the task are kept when it is stopped
+  waitServer(Test::managementUrl, false);
+  for (int i = 0; i < 12; i++) {
+    std::unique_ptr<Point> p{createPoint("test1")};
+    p->addField("index", i);
+    TEST_ASSERT(client.writePoint(*p.get()));
+  }
+  TEST_ASSERT(!client.flushBuffer());
+  TEST_ASSERT(client.setBackgroundFlush(false));
+  TEST_ASSERT(!client._worker.isRunning());
+  TEST_ASSERT(!client._flushBuffer);
+  TEST_ASSERTM(client._writeBuffer->getNumPoints() == 12,
+               std::to_string(client._writeBuffer->getNumPoints()));
+  waitServer(Test::managementUrl, true);
+  client.resetBuffer();
+
+  // persistent queue writes from the caller task only
+  TEST_ASSERT(client.setWriteOptions(
+      WriteOptions().persistentQueue("/influxdb-test-queue")));
+  TEST_ASSERT(!client.setBackgroundFlush());
+  TEST_ASSERT(!client._worker.isRunning());
+#endif
+  TEST_END();
+  deleteAll(Test::apiUrl);
+}
+
 void Test::testHTTPReadTimeout() {
   TEST_INIT("testHTTPReadTimeout");
   InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
@@ -1161,9 +1938,11 @@ void Test::testRetriesOnServerOverload() {
   TEST_INIT("testRetriesOnServerOverload");
   InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
                         Test::token);
-  client.setWriteOptions(
-      WriteOptions().batchSize(5).bufferSize(20).flushInterval(
-          std::chrono::seconds{60}));
+  client.setWriteOptions(WriteOptions()
+                             .batchSize(5)
+                             .bufferSize(20)
+                             .flushInterval(std::chrono::seconds{60})
+                             .retryJitter(false));
 
   waitServer(Test::managementUrl, true);
   TEST_ASSERT(client.validateConnection());
@@ -1518,6 +2297,54 @@ void Test::testTimestampAdjustment() {
   client.checkPrecisions(point);
   TEST_ASSERTM(endsWith(point.getTime(), "000000"), point.getTime());
 
+  // every pair of precisions
+  const WritePrecision precisions[] = {WritePrecision::S, WritePrecision::MS,
+                                       WritePrecision::US, WritePrecision::NS};
+  const char *times[] = {"1600000000", "1600000000123", "1600000000123456",
+                         "1600000000123456789"};
+  const unsigned long long values[] = {1600000000ULL, 1600000000123ULL,
+                                       1600000000123456ULL,
+                                       1600000000123456789ULL};
+  for (int from = 0; from < 4; from++) {
+    for (int to = 0; to < 4; to++) {
+      client.setWriteOptions(WriteOptions().writePrecision(precisions[to]));
+      point.setTime(values[from], precisions[from]);
+      client.checkPrecisions(point);
+      std::string expected = times[std::min(from, to)];
+      expected.append(3 * std::max(to - from, 0), '0');
+      TEST_ASSERTM(point.getTime() == expected,
+                   std::to_string(from) + "->" + std::to_string(to) + ": " +
+                       point.getTime());
+      // converted timestamp is not converted again
+      client.checkPrecisions(point);
+      TEST_ASSERTM(point.getTime() == expected, point.getTime());
+    }
+  }
+  // timestamp without precision is written as it is
+  client.setWriteOptions(WriteOptions().writePrecision(WritePrecision::MS));
+  point.setTime(1600000000ULL);
+  client.checkPrecisions(point);
+  TEST_ASSERTM(point.getTime() == "1600000000", point.getTime());
+  point.setTime("1600000000");
+  client.checkPrecisions(point);
+  TEST_ASSERTM(point.getTime() == "1600000000", point.getTime());
+  point.setTime("16000x");
+  TEST_ASSERT(!point.hasTime());
+  // times before epoch are rounded to past
+  point.setTime("-1500");
+  TEST_ASSERT(point.getTimestamp() == -1500);
+  point._data->tsWritePrecision = WritePrecision::MS;
+  client.setWriteOptions(WriteOptions().writePrecision(WritePrecision::S));
+  client.checkPrecisions(point);
+  TEST_ASSERTM(point.getTime() == "-2", point.getTime());
+
+  // original API sets seconds, written in precision of client
+  InfluxData data("a");
+  data.addValue("f", 1);
+  data.setTimestamp(1600000000l);
+  client.checkPrecisions(data);
+  TEST_ASSERTM(data.getTime() == "1600000000", data.getTime());
+
   TEST_END();
 }
 
@@ -2466,81 +3293,79 @@ void Test::testRetryInterval() {
   TEST_INIT("testRetryInterval");
   InfluxDBClient client(Test::apiUrl, Test::orgName, Test::bucketName,
                         Test::token);
-  client.setWriteOptions(WriteOptions().retryInterval(std::chrono::seconds{2}));
+  client.setWriteOptions(WriteOptions()
+                             .retryInterval(std::chrono::seconds{2})
+                             .maxRetryAttempts(3)
+                             .retryJitter(false));
 
   waitServer(Test::managementUrl, true);
   TEST_ASSERT(client.validateConnection());
 
-  std::string rec =
-      "test1,direction=permanent-set,x-code=502,SSID=bonitoo.io,device_name="
-      "ESP32,device_id=4272205360 "
-      "temperature=28.60,humidity=86i,code=69i,door=false,status=\"failed\","
-      "index=0";
+  // server responds 502 as long as this point is the first one in buffer
+  std::string rec = "test1,direction=status,x-code=502 index=0i";
   TEST_ASSERT(!client.writeRecord(rec));
   TEST_ASSERT(!client.canSendRequest());
   TEST_ASSERTM(client.getRemainingRetryTime() == 2,
                std::to_string(client.getRemainingRetryTime()));
-  //   TEST_ASSERTM(client._writeBuffer.retryCount == 1,
-  //                std::to_string(client._writeBuffer[0]->retryCount));
+  TEST_ASSERT(client._retryCount == 1);
+  // exponential backoff
   delay(2000);
-  rec =
-      "test1,direction=permanent-unset,SSID=bonitoo.io,device_name=ESP32,"
-      "device_id=4272205360 "
-      "temperature=28.60,humidity=86i,code=69i,door=false,status=\"failed\","
-      "index=2";
-  TEST_ASSERT(!client.writeRecord(rec));
-  TEST_ASSERT(!client.canSendRequest());
+  TEST_ASSERT(!client.writeRecord("test1,tag=a index=1i"));
   TEST_ASSERTM(client.getRemainingRetryTime() == 4,
                std::to_string(client.getRemainingRetryTime()));
-  //   TEST_ASSERTM(client._writeBuffer[0]->retryCount == 2,
-  //                std::to_string(client._writeBuffer[0]->retryCount));
   delay(4000);
-  rec =
-      "test1,SSID=bonitoo.io,device_name=ESP32,device_id=4272205360 "
-      "temperature=28.60,humidity=86i,code=69i,door=false,status=\"failed\","
-      "index=3";
-  TEST_ASSERT(!client.writeRecord(rec));
-  TEST_ASSERT(!client.canSendRequest());
+  TEST_ASSERT(!client.writeRecord("test1,tag=a index=2i"));
   TEST_ASSERTM(client.getRemainingRetryTime() == 8,
                std::to_string(client.getRemainingRetryTime()));
-  //   TEST_ASSERTM(client._writeBuffer[0]->retryCount == 3,
-  //                std::to_string(client._writeBuffer[0]->retryCount));
+  TEST_ASSERT(client._retryCount == 3);
+  // failing batch is discarded after max attempts
   delay(8000);
-  rec =
-      "test1,SSID=bonitoo.io,device_name=ESP32,device_id=4272205360 "
-      "temperature=28.60,humidity=86i,code=69i,door=false,status=\"failed\","
-      "index=4";
-  TEST_ASSERT(!client.writeRecord(rec));
-  TEST_ASSERT(!client.canSendRequest());
+  TEST_ASSERT(!client.writeRecord("test1,tag=a index=3i"));
+  TEST_ASSERT(client._writeBuffer->getNumPoints() == 3);
+  TEST_ASSERT(client._retryCount == 0);
   TEST_ASSERTM(client.getRemainingRetryTime() == 2,
                std::to_string(client.getRemainingRetryTime()));
-  TEST_ASSERT(!client._writeBuffer->buffer.empty());
-//   TEST_ASSERTM(client._writeBuffer[1]->retryCount == 0,
-//                std::to_string(client._writeBuffer[1]->retryCount));
-
-  delay(2000);
-  rec =
-      "test1,SSID=bonitoo.io,device_name=ESP32,device_id=4272205360 "
-      "temperature=28.60,humidity=86i,code=69i,door=false,status=\"failed\","
-      "index=5";
-  TEST_ASSERT(!client.writeRecord(rec));
-  TEST_ASSERT(!client.canSendRequest());
-  TEST_ASSERTM(client.getRemainingRetryTime() == 2,
-               std::to_string(client.getRemainingRetryTime()));
-  TEST_ASSERT(!client._writeBuffer->buffer.empty());
-  //   TEST_ASSERTM(client._writeBuffer[1]->retryCount == 1,
-  //                std::to_string(client._writeBuffer[1]->retryCount));
 
   delay(2000);
   TEST_ASSERT(client.canSendRequest());
-  TEST_ASSERTM(client.flushBuffer(), client.getLastErrorMessage());
+  TEST_ASSERTM(client.writeRecord("test1,tag=a index=4i"),
+               client.getLastErrorMessage());
   TEST_ASSERT(client.isBufferEmpty());
-  TEST_ASSERT(!client.isBufferFull());
   std::string query = "select";
   FluxQueryResult q = client.query(query);
-  TEST_ASSERT(countLines(q) == 3);  // point with the direction tag is skipped
+  TEST_ASSERT(countLines(q) == 4);
   TEST_ASSERTM(q.getError() == "", q.getError());
 
+  // max retry interval
+  client.setWriteOptions(
+      WriteOptions().maxRetryInterval(std::chrono::seconds{3}));
+  client._retryCount = 5;
+  client.scheduleRetry(client._retryCount, 0);
+  TEST_ASSERTM(client.getRemainingRetryTime() == 3,
+               std::to_string(client.getRemainingRetryTime()));
+
+  // full jitter
+  client.setWriteOptions(
+      WriteOptions().retryInterval(std::chrono::seconds{2}).retryJitter(true));
+  client._retryCount = 0;
+  for (int i = 0; i < 10; i++) {
+    client.scheduleRetry(2, 0);
+    TEST_ASSERTM(client.getRemainingRetryTime() <= 4,
+                 std::to_string(client.getRemainingRetryTime()));
+  }
+  client._nextRetry = std::chrono::steady_clock::time_point::min();
+
+  // Retry-After has precedence
+  rec = "test1,direction=429-1 index=5i";
+  TEST_ASSERT(!client.writeRecord(rec));
+  TEST_ASSERTM(client.getRemainingRetryTime() == 10,
+               std::to_string(client.getRemainingRetryTime()));
+  q = client.query(query);
+  TEST_ASSERT(!q.next());
+  TEST_ASSERTM(q.getError().find("Cannot send request yet") == 0,
+               q.getError());
+  client.resetBuffer();
+
   TEST_END();
   deleteAll(Test::apiUrl);
 }
@@ -2586,6 +3411,11 @@ void Test::testDefaultTags() {
   testLine = "test,dtag1=dval1,dtag2=dval2,tag1=tagvalue fieldInt=-23i";
   line = client.pointToLineProtocol(pt);
   TEST_ASSERTM(line == testLine, line);
+  // tag of point replaces default tag
+  pt.addTag("dtag2", "own");
+  testLine = "test,dtag1=dval1,dtag2=own,tag1=tagvalue fieldInt=-23i\n";
+  line = client.pointToLineProtocol(pt);
+  TEST_ASSERTM(line == testLine, line);
 
   for (int i = 0; i < 5; i++) {
     std::unique_ptr<Point> p{createPoint("test1")};
@@ -2630,6 +3460,58 @@ void Test::testDefaultTags() {
   deleteAll(Test::apiUrl);
 }
 
+void Test::testSeriesCache() {
+  TEST_INIT("testSeriesCache");
+  SeriesCache cache(2);
+  const std::string tags = "a=1,b=2,";
+  TEST_ASSERTM(cache.get("m1", tags) == "m1,a=1,b=2", cache.get("m1", tags));
+  TEST_ASSERT(&cache.get("m1", tags) == &cache.get("m1", tags));
+  TEST_ASSERT(cache.get("m2", tags) == "m2,a=1,b=2");
+  TEST_ASSERT(cache.size() == 2);
+  // m1 is used more recently, m2 is replaced
+  cache.get("m1", tags);
+  const std::string *m1 = &cache.get("m1", tags);
+  TEST_ASSERT(cache.get("m3", "") == "m3");
+  TEST_ASSERT(cache.size() == 2);
+  TEST_ASSERT(&cache.get("m1", tags) == m1);
+  cache.reset(0);
+  TEST_ASSERT(cache.size() == 0);
+  TEST_ASSERT(cache.getCapacity() == 0);
+
+  // client uses cache for points without tags
+  InfluxDBClient client;
+  client.setWriteOptions(
+      WriteOptions().batchSize(10).addDefaultTag("site", "A"));
+  Point p1("m 1"), p2("m2"), p3("m2");
+  p1.addField("f", 1);
+  p2.addField("f", 2);
+  p3.addTag("t", "x").addField("f", 3);
+  Point points[] = {p1, p2, p3};
+  TEST_ASSERT(client.writePoints(points, 3, false));
+  TEST_ASSERT(client._seriesCache.size() == 2);
+  // default tags changed, cache is reset
+  client.setWriteOptions(
+      WriteOptions().batchSize(10).addDefaultTag("site", "B"));
+  TEST_ASSERT(client._seriesCache.size() == 0);
+  TEST_ASSERT(client.writePoint(p1, false));
+  // disabled cache
+  client.setWriteOptions(WriteOptions()
+                             .batchSize(10)
+                             .addDefaultTag("site", "B")
+                             .seriesCacheSize(0));
+  TEST_ASSERT(client.writePoint(p2, false));
+  TEST_ASSERT(client._seriesCache.size() == 0);
+  uint32_t length;
+  std::string buffer(client._writeBuffer->getSpan(0, length));
+  buffer.resize(length);
+  TEST_ASSERTM(buffer ==
+                   "m\\ 1,site=A f=1i\nm2,site=A f=2i\nm2,site=A,t=x f=3i\n"
+                   "m\\ 1,site=B f=1i\nm2,site=B f=2i\n",
+               buffer);
+
+  TEST_END();
+}
+
 void Test::testUrlEncode() {
   TEST_INIT("testUrlEncode");
   std::string res = "my%20%5Bsecret%5D%20pass%3A%2F%5Cw%60o%5Er%25d";
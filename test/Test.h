@@ -41,8 +41,11 @@ private: // tests
     static void testOptions();
     static void testEcaping();
     static void testPoint();
+    static void testPointSchema();
+    static void testPointFields();
     static void testOldAPI();
     static void testBatch();
+    static void testLineProtocolEncoder();
     static void testLineProtocol();
     static void testUseServerTimestamp();
     static void testFluxTypes();
@@ -64,6 +67,16 @@ private: // tests
     static void testTimestamp();
     static void testTimestampAdjustment();
     static void testHTTPReadTimeout();
+    static void testHealthCheck();
+    static void testGzipWrite();
+    static void testFlushInBatches();
+    static void testWritePoints();
+    static void testStreamWritePoints();
+    static void testAsyncFlushAndQuery();
+    static void testConnectionPool();
+    static void testTLSState();
+    static void testPersistentQueue();
+    static void testBackgroundFlush();
     static void testRetryOnFailedConnection();
     static void testRetryOnFailedConnectionWithFlush();
     static void testBufferOverwriteBatchsize1();
@@ -72,6 +85,7 @@ private: // tests
     static void testRetriesOnServerOverload();
     static void testRetryInterval();
     static void testDefaultTags();
+    static void testSeriesCache();
     static void testUrlEncode();
     static void testRepeatedInit();
     static void testIsValidID();
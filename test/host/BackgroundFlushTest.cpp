@@ -0,0 +1,99 @@
+/**
+ *
+ * BackgroundFlushTest.cpp: Writes points while background task flushes them
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host only test. Points are written while the background task sends them to
+// a local TestServer, which fails some of the writes. Options are changed and
+// the flush ticker fires meanwhile. All points must arrive once and in order.
+// Build with -fsanitize=thread to check for data races.
+
+#include <InfluxDbClient.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "TestServer.h"
+
+#define CHECK(cond, ...)                              \
+  if (!(cond)) {                                      \
+    printf("%s:%d: %s: ", __FILE__, __LINE__, #cond); \
+    printf(__VA_ARGS__);                              \
+    printf("\n");                                     \
+    return false;                                     \
+  }
+
+static bool testWriteWhileFlushing() {
+  TestServer server;
+  InfluxDBClient client(server.getUrl(), "org", "bucket", "token");
+  // buffer is flushed when it holds 300 points, or by ticker
+  auto options = WriteOptions()
+                     .batchSize(10)
+                     .bufferSize(30)
+                     .flushInterval(std::chrono::seconds{1})
+                     .retryInterval(std::chrono::seconds{0})
+                     .maxRetryInterval(std::chrono::seconds{0})
+                     .retryJitter(false);
+  CHECK(client.setWriteOptions(options), "%s",
+        client.getLastErrorMessage().c_str());
+  CHECK(client.setBackgroundFlush(), "%s",
+        client.getLastErrorMessage().c_str());
+  // ids of the same length, so that all lines have the same size
+  const int first = 10000, count = 3000;
+  for (int i = 0; i < count; i++) {
+    // outages of 100 points, shorter than the buffer, so no point is lost
+    server.writeStatus = i % 500 >= 400 ? 503 : 204;
+    if (i == count / 2) {
+      // pauses background task while options change
+      CHECK(client.setWriteOptions(options.batchSize(7)), "%s",
+            client.getLastErrorMessage().c_str());
+    }
+    Point p("test");
+    p.addField("id", first + i);
+    CHECK(client.writePoint(p), "%s", client.getLastErrorMessage().c_str());
+    client.getRemainingRetryTime();
+    usleep(100);
+  }
+  // the last incomplete batch is sent by the ticker
+  server.writeStatus = 204;
+  for (int i = 0; i < 3000 && server.getLines().size() < count; i++) {
+    delay(1);
+  }
+  CHECK(client.isBufferEmpty(), "buffer not empty");
+  CHECK(client.setBackgroundFlush(false), "stop");
+  auto lines = server.getLines();
+  CHECK(lines.size() == count, "%zu", lines.size());
+  for (int i = 0; i < count; i++) {
+    const std::string expected = "test id=" + std::to_string(first + i) + "i";
+    CHECK(lines[i] == expected, "%d: %s", i, lines[i].c_str());
+  }
+  CHECK(server.failedWrites > 0, "no outage hit");
+  return true;
+}
+
+int main() {
+  bool ok = testWriteWhileFlushing();
+  printf("%s\n", ok ? "SUCCEEDED" : "FAILED");
+  return ok ? 0 : 1;
+}
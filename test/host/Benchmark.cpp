@@ -0,0 +1,662 @@
+/**
+ *
+ * Benchmark.cpp: Microbenchmarks of the library hot paths
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host only benchmark. Each benchmark runs a fixed synthetic workload and
+// reports time, allocated bytes and number of allocations per operation.
+// Results are printed as JSON to stdout, so runs of different versions can be
+// compared. Usage: influxdb_bench [--filter=<substring>] [--min-time=<ms>]
+
+#include <InfluxDbClient.h>
+#include <Version.h>
+#include <util/GzipStream.h>
+#include <util/NumberFormat.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Allocations made through operator new, counted for all threads
+static std::atomic<uint64_t> allocCount{0};
+static std::atomic<uint64_t> allocBytes{0};
+
+static void *countedAlloc(size_t size) {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(size, std::memory_order_relaxed);
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// Prevents compiler from removing computation of value
+template <class T>
+static void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Options {
+  std::string filter;
+  std::chrono::milliseconds minTime{500};
+};
+
+static Options options;
+static bool firstResult = true;
+
+// Runs op repeatedly, at least for minTime, and prints the result. Single call
+// of op performs opsPerCall operations.
+template <class Op>
+static void run(const char *name, uint32_t opsPerCall, Op op) {
+  if (!options.filter.empty() &&
+      std::string(name).find(options.filter) == std::string::npos) {
+    return;
+  }
+  typedef std::chrono::steady_clock clock;
+  // warm up and find number of calls taking approximately minTime
+  uint64_t calls = 1;
+  while (true) {
+    auto start = clock::now();
+    for (uint64_t i = 0; i < calls; i++) {
+      op(i);
+    }
+    auto elapsed = clock::now() - start;
+    if (elapsed * 10 >= options.minTime) {
+      calls = std::max<uint64_t>(calls * options.minTime / elapsed, 1);
+      break;
+    }
+    calls *= 10;
+  }
+  const uint64_t count = allocCount.load();
+  const uint64_t bytes = allocBytes.load();
+  auto start = clock::now();
+  for (uint64_t i = 0; i < calls; i++) {
+    op(i);
+  }
+  auto elapsed = clock::now() - start;
+  const double ops = double(calls) * opsPerCall;
+  const double ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  printf("%s\n    {\"name\": \"%s\", \"iterations\": %.0f, \"ns_per_op\": %.2f, "
+         "\"bytes_per_op\": %.2f, \"allocs_per_op\": %.3f}",
+         firstResult ? "" : ",", name, ops, ns / ops,
+         (allocBytes.load() - bytes) / ops, (allocCount.load() - count) / ops);
+  firstResult = false;
+  fflush(stdout);
+}
+
+// Serves fixed response body from memory, instead of a socket
+class MemoryClient : public WiFiClient {
+ public:
+  MemoryClient(const std::string &data) : _data(data) {
+    // any valid value, socket is never used
+    _fd = 0;
+  }
+  ~MemoryClient() { _fd = -1; }
+  void rewind() {
+    _pos = 0;
+    _rxPos = _rxLen = 0;
+    _eof = false;
+  }
+  virtual void stop() override {}
+
+ protected:
+  virtual ssize_t rawRecv(uint8_t *buf, size_t size) override {
+    size = std::min(size, _data.length() - _pos);
+    memcpy(buf, _data.data() + _pos, size);
+    _pos += size;
+    return size;
+  }
+  virtual bool waitAvailable(unsigned long) override { return fill() > 0; }
+
+ private:
+  const std::string &_data;
+  size_t _pos = 0;
+};
+
+// HTTP client with a response body already received
+class MemoryHTTPClient : public HTTPClient {
+ public:
+  void attach(WiFiClient &client, int size) {
+    _client = &client;
+    _size = size;
+  }
+};
+
+// Exposes conversion of raw values
+class ValueConverter : public FluxQueryResult {
+ public:
+  ValueConverter() : FluxQueryResult("") {}
+  using FluxQueryResult::convertValue;
+};
+
+static void benchPoint() {
+  Point point("environment");
+  point.addTag("device", "ESP32");
+  point.addTag("location", "living-room");
+  point.addField("temperature", 21.5);
+  point.addField("humidity", 48.25f);
+  point.addField("pressure", 1013);
+  point.addField("status", "ok");
+  point.setTime(1600000000123456789ULL);
+
+  Point p("environment");
+  run("Point::addField/int", 1, [&](uint64_t i) {
+    p.clearFields();
+    p.addField("pressure", int(i));
+  });
+  run("Point::addField/long long", 1, [&](uint64_t i) {
+    p.clearFields();
+    p.addField("counter", (long long)i * 1000003LL);
+  });
+  run("Point::addField/unsigned long", 1, [&](uint64_t i) {
+    p.clearFields();
+    p.addField("uptime", (unsigned long)i);
+  });
+  run("Point::addField/double", 1, [&](uint64_t i) {
+    p.clearFields();
+    p.addField("temperature", 21.5 + i * 0.01);
+  });
+  run("Point::addField/float", 1, [&](uint64_t i) {
+    p.clearFields();
+    p.addField("humidity", 48.25f + i * 0.01f);
+  });
+  run("Point::addField/bool", 1, [&](uint64_t i) {
+    p.clearFields();
+    p.addField("door", (i & 1) == 0);
+  });
+  run("Point::addField/string", 1, [&](uint64_t) {
+    p.clearFields();
+    p.addField("status", "ok");
+  });
+  run("Point::addTag", 1, [&](uint64_t) {
+    p.clearTags();
+    p.addTag("location", "living-room");
+  });
+  run("Point::createLineProtocol", 1,
+      [&](uint64_t) { keep(point.toLineProtocol()); });
+
+  // Compares writing line protocol created by Point, which copies the line
+  // twice, with encoding the point directly into the write buffer
+  InfluxDBClient client("http://localhost:8086", "org", "bucket", "token");
+  client.setWriteOptions(WriteOptions().batchSize(100).bufferSize(10));
+  run("InfluxDBClient::writeRecord/toLineProtocol", 1, [&](uint64_t) {
+    client.writeRecord(point.toLineProtocol(), false);
+  });
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint", 1,
+      [&](uint64_t) { client.writePoint(point, false); });
+  // Same with a new point for every write, so the line string created by
+  // toLineProtocol is allocated every time. The difference of bytes per op is
+  // the line copy saved by writePoint
+  auto newPoint = [](uint64_t i) {
+    Point p("environment");
+    p.addTag("device", "ESP32");
+    p.addTag("location", "living-room");
+    p.addField("temperature", 21.5 + i * 0.01);
+    p.addField("humidity", 48.25f);
+    p.addField("pressure", 1013);
+    p.addField("status", "ok");
+    p.setTime(1600000000123456789ULL + i);
+    return p;
+  };
+  client.resetBuffer();
+  run("InfluxDBClient::writeRecord/toLineProtocol/newPoint", 1,
+      [&](uint64_t i) {
+        Point p = newPoint(i);
+        client.writeRecord(p.toLineProtocol(), false);
+      });
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/newPoint", 1, [&](uint64_t i) {
+    Point p = newPoint(i);
+    client.writePoint(p, false);
+  });
+
+  // Builds the same point for every write, by names and from a schema
+  client.setWriteOptions(WriteOptions()
+                             .batchSize(100)
+                             .bufferSize(10)
+                             .addDefaultTag("firmware", "1.2.0"));
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/byName", 1, [&](uint64_t i) {
+    Point p("environment");
+    p.addTag("device", "ESP32");
+    p.addTag("location", "living-room");
+    p.addField("temperature", 21.5 + i * 0.01);
+    p.addField("pressure", 1013);
+    p.setTime(1600000000123456789ULL + i);
+    client.writePoint(p, false);
+  });
+  PointSchema schema("environment");
+  schema.addTag("device", "ESP32").addTag("location", "living-room");
+  auto temperature = schema.field("temperature");
+  auto pressure = schema.field("pressure");
+  Point sp(schema);
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/schema", 1, [&](uint64_t i) {
+    sp.clearFields();
+    sp.addField(temperature, 21.5 + i * 0.01);
+    sp.addField(pressure, 1013);
+    sp.setTime(1600000000123456789ULL + i);
+    client.writePoint(sp, false);
+  });
+  // Only the changed field is formatted again
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/setField", 1, [&](uint64_t i) {
+    sp.setField(temperature, 21.5 + i * 0.01);
+    sp.setTime(1600000000123456789ULL + i);
+    client.writePoint(sp, false);
+  });
+  PointPool pool(4);
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/pool", 1, [&](uint64_t i) {
+    Point p = pool.acquire(schema);
+    p.addField(temperature, 21.5 + i * 0.01);
+    p.addField(pressure, 1013);
+    p.setTime(1600000000123456789ULL + i);
+    client.writePoint(p, false);
+  });
+  // Timestamp in nanoseconds converted to precision of client
+  client.setWriteOptions(WriteOptions()
+                             .batchSize(100)
+                             .bufferSize(10)
+                             .writePrecision(WritePrecision::MS));
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/convertTime", 1, [&](uint64_t i) {
+    sp.setTime(1600000000123456789ULL + i, WritePrecision::NS);
+    client.writePoint(sp, false);
+  });
+  // Burst of 10 points written one by one and at once, per point
+  std::vector<Point> burst;
+  for (int i = 0; i < 10; i++) {
+    Point b(schema);
+    b.addField(temperature, 21.5 + i * 0.01);
+    b.setTime(1600000000123ULL + i);
+    burst.push_back(b);
+  }
+  client.resetBuffer();
+  run("InfluxDBClient::writePoint/burst", burst.size(), [&](uint64_t) {
+    for (auto& b : burst) {
+      client.writePoint(b, false);
+    }
+  });
+  client.resetBuffer();
+  run("InfluxDBClient::writePoints/burst", burst.size(), [&](uint64_t) {
+    client.writePoints(burst.begin(), burst.end(), false);
+  });
+
+  // New point without own tags for every write, with fleet default tags
+  WriteOptions fleet = WriteOptions()
+                           .batchSize(100)
+                           .bufferSize(10)
+                           .addDefaultTag("site", "prague-1")
+                           .addDefaultTag("rack", "r12")
+                           .addDefaultTag("firmware", "1.2.0")
+                           .addDefaultTag("board", "esp32-devkit")
+                           .addDefaultTag("region", "eu-central")
+                           .addDefaultTag("owner", "ops");
+  for (uint8_t size : {0, 8}) {
+    client.setWriteOptions(fleet.seriesCacheSize(size));
+    client.resetBuffer();
+    run(size ? "InfluxDBClient::writePoint/defaultTags"
+             : "InfluxDBClient::writePoint/defaultTags/noCache",
+        1, [&](uint64_t i) {
+          Point p = pool.acquire("environment");
+          p.addField("temperature", 21.5 + i * 0.01);
+          p.setTime(1600000000123456789ULL + i);
+          client.writePoint(p, false);
+        });
+  }
+}
+
+// Compares formatting 1M random values using Arduino String, which is used
+// by Point::addField up to 3.13, with the built-in formatter
+static void benchFloatFormat() {
+  const uint32_t count = 1000000;
+  std::vector<double> values(count);
+  std::mt19937_64 random(1);
+  std::uniform_real_distribution<double> mantissa(-10, 10);
+  std::uniform_int_distribution<int> exponent(-6, 6);
+  for (auto &v : values) {
+    v = mantissa(random) * pow(10, exponent(random));
+  }
+  char buff[FloatBufferSize];
+  run("String(double, 2)", count, [&](uint64_t) {
+    for (double v : values) {
+      String s(v, 2);
+      keep(s);
+    }
+  });
+  run("formatDouble/fixed2", count, [&](uint64_t) {
+    for (double v : values) {
+      keep(formatDouble(buff, v, 2));
+    }
+  });
+  run("formatDouble/shortest", count, [&](uint64_t) {
+    for (double v : values) {
+      keep(formatDouble(buff, v));
+    }
+  });
+  run("formatFloat/shortest", count, [&](uint64_t) {
+    for (double v : values) {
+      keep(formatFloat(buff, float(v)));
+    }
+  });
+}
+
+// Formats 1M random integers of all lengths
+static void benchIntFormat() {
+  const uint32_t count = 1000000;
+  std::vector<int64_t> values(count);
+  std::mt19937_64 random(1);
+  for (uint32_t i = 0; i < count; i++) {
+    values[i] = int64_t(random()) >> (i % 64);
+  }
+  char buff[IntBufferSize];
+  run("std::to_string(long long)", count, [&](uint64_t) {
+    for (int64_t v : values) {
+      keep(std::to_string(v));
+    }
+  });
+  run("formatInt", count, [&](uint64_t) {
+    for (int64_t v : values) {
+      keep(formatInt(buff, v));
+    }
+  });
+  run("timeStampToString", 1, [&](uint64_t i) {
+    keep(timeStampToString(1600000000123456789ULL + i));
+  });
+}
+
+static void benchEscaping() {
+  const std::string plainKey = "temperature_sensor_1";
+  const std::string escapedKey = "temperature sensor=1,a";
+  const std::string plainValue = "The quick brown fox jumps over the lazy dog";
+  const std::string escapedValue = "path \"C:\\data\\sensor\" is used";
+  std::string dest;
+  run("escapeKey/plain", 1, [&](uint64_t) {
+    dest.clear();
+    keep(escapeKey(dest, 0, plainKey));
+  });
+  run("escapeKey/escaped", 1, [&](uint64_t) {
+    dest.clear();
+    keep(escapeKey(dest, 0, escapedKey));
+  });
+  run("escapeValue/plain", 1, [&](uint64_t) {
+    dest.clear();
+    keep(escapeValue(dest, 0, plainValue));
+  });
+  run("escapeValue/escaped", 1, [&](uint64_t) {
+    dest.clear();
+    keep(escapeValue(dest, 0, escapedValue));
+  });
+  const std::string query =
+      "from(bucket: \"iot\")\n"
+      "  |> range(start: -1h)\n"
+      "  |> filter(fn: (r) => r._measurement == \"environment\" and "
+      "r.location == \"living-room\")\n"
+      "  |> aggregateWindow(every: 1m, fn: mean)\n";
+  run("escapeJSONString", 1, [&](uint64_t) { keep(escapeJSONString(query)); });
+}
+
+static void benchQuery() {
+  const uint32_t rows = 1000;
+  std::string body =
+      "#datatype,string,long,dateTime:RFC3339,dateTime:RFC3339,dateTime:"
+      "RFC3339,double,string,string,string,string\n"
+      "#group,false,false,true,true,false,false,true,true,true,true\n"
+      "#default,_result,,,,,,,,,\n"
+      ",result,table,_start,_stop,_time,_value,_field,_measurement,device,"
+      "location\n";
+  for (uint32_t i = 0; i < rows - 4; i++) {
+    body += ",,0,2020-10-13T08:00:00Z,2020-10-13T09:00:00Z,2020-10-13T08:";
+    body += std::to_string(10 + i % 50);
+    body += ":00.123456789Z,";
+    body += std::to_string(20 + i % 7);
+    body += ".25,temperature,environment,ESP32,\"living room, north\"\n";
+  }
+  MemoryClient stream(body);
+  MemoryHTTPClient http;
+  run("CsvReader::next", rows, [&](uint64_t) {
+    stream.rewind();
+    http.attach(stream, body.length());
+    CsvReader reader(new HttpStreamScanner(&http, false));
+    while (reader.next()) {
+      keep(reader);
+    }
+  });
+
+  ValueConverter converter;
+  struct Value {
+    const char *name;
+    std::string type;
+    std::string value;
+  };
+  std::vector<Value> values = {
+      {"FluxQueryResult::convertValue/long", "long", "-1234567890"},
+      {"FluxQueryResult::convertValue/unsignedLong", "unsignedLong",
+       "1234567890123"},
+      {"FluxQueryResult::convertValue/double", "double", "1013.25"},
+      {"FluxQueryResult::convertValue/boolean", "boolean", "true"},
+      {"FluxQueryResult::convertValue/string", "string", "living-room"},
+      {"FluxQueryResult::convertValue/dateTime", "dateTime:RFC3339",
+       "2020-10-13T08:10:00.123456789Z"},
+  };
+  for (auto &v : values) {
+    run(v.name, 1, [&](uint64_t) {
+      FluxValue value(converter.convertValue(v.value, v.type));
+      keep(value);
+    });
+  }
+}
+
+// Minimal keep-alive HTTP server on loopback, answering each request by 204.
+// Uses only stack buffers, so it does not affect counted allocations.
+class LoopbackServer {
+ public:
+  LoopbackServer() {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(_fd, (sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(_fd, (sockaddr *)&addr, &len);
+    _port = ntohs(addr.sin_port);
+    listen(_fd, 4);
+    _thread = std::thread([this] { serve(); });
+  }
+  ~LoopbackServer() {
+    shutdown(_fd, SHUT_RDWR);
+    close(_fd);
+    _thread.join();
+  }
+  uint16_t getPort() const { return _port; }
+
+ private:
+  void serve() {
+    int conn;
+    while ((conn = accept(_fd, nullptr, nullptr)) >= 0) {
+      char buff[16384];
+      size_t used = 0;
+      ssize_t r;
+      while ((r = read(conn, buff + used, sizeof(buff) - used)) > 0) {
+        used += r;
+        // requests of the benchmark fit into buffer
+        size_t requestLength;
+        while ((requestLength = requestSize(buff, used)) > 0) {
+          static const char response[] =
+              "HTTP/1.1 204 No Content\r\nConnection: keep-alive\r\n\r\n";
+          if (write(conn, response, sizeof(response) - 1) < 0) {
+            break;
+          }
+          memmove(buff, buff + requestLength, used - requestLength);
+          used -= requestLength;
+        }
+      }
+      close(conn);
+    }
+  }
+  // Returns size of the first request in buffer, 0 if it is not complete
+  static size_t requestSize(const char *buff, size_t used) {
+    const char *end = (const char *)memmem(buff, used, "\r\n\r\n", 4);
+    if (!end) {
+      return 0;
+    }
+    size_t length = end + 4 - buff;
+    if (memmem(buff, length, "Transfer-Encoding: chunked", 26)) {
+      // chunk size lines up to the last chunk of zero size
+      while (true) {
+        const char *line = buff + length;
+        end = (const char *)memmem(line, used - length, "\r\n", 2);
+        if (!end) {
+          return 0;
+        }
+        size_t size = strtoul(line, nullptr, 16);
+        length += end + 2 - line + size + 2;
+        if (length > used) {
+          return 0;
+        }
+        if (size == 0) {
+          return length;
+        }
+      }
+    }
+    const char *cl = (const char *)memmem(buff, length, "Content-Length: ", 16);
+    length += cl ? atoi(cl + 16) : 0;
+    return length <= used ? length : 0;
+  }
+  int _fd;
+  uint16_t _port;
+  std::thread _thread;
+};
+
+// Compares CPU and allocations of write requests over a kept-alive loopback
+// connection. Time includes the system calls of both sides.
+static void benchHTTP() {
+  LoopbackServer server;
+  ConnectionInfo conn;
+  conn.serverUrl = "http://127.0.0.1:" + std::to_string(server.getPort());
+  conn.authToken = "my-secret-token-my-secret-token-my-secret-token";
+  conn.dbVersion = 2;
+  conn.certInfo = nullptr;
+  conn.insecure = false;
+  std::string url = conn.serverUrl +
+                    "/api/v2/write?org=my-org&bucket=my-bucket&precision=ns";
+  const char *line =
+      "environment,device=ESP32,location=living-room temperature=21.5 "
+      "1600000000123456789\n";
+  {
+    // server handles one connection at a time, it closes with the service
+    HTTPService service(&conn);
+    service.setHTTPOptions(HTTPOptions().connectionReuse(true));
+    run("HTTPService::doPOST/keepAlive", 1, [&](uint64_t) {
+      service.doPOST(url.c_str(), line, "text/plain", 204, nullptr);
+    });
+
+    // gzip body of known size is compressed twice, chunked body only once
+    std::string lines;
+    for (int i = 0; i < 100; i++) {
+      lines += "environment,device=ESP32,location=living-room temperature=";
+      lines += std::to_string(20 + i % 7) + ".5 " +
+               std::to_string(1600000000123456789LL + i * 1000000000LL) + "\n";
+    }
+    MemoryClient source(lines);
+    run("HTTPService::doPOST/gzipStream", 100, [&](uint64_t) {
+      source.rewind();
+      GzipStream gzip(&source, [&source]() { source.rewind(); });
+      service.doPOST(url.c_str(), &gzip, "text/plain", 204, nullptr, "gzip");
+    });
+    run("HTTPService::doPOST/gzipChunked", 100, [&](uint64_t) {
+      source.rewind();
+      GzipStream gzip(&source, nullptr);
+      service.doPOST(
+          url.c_str(),
+          [&gzip](uint8_t *buffer, size_t size) {
+            return gzip.readBytes((char *)buffer, size);
+          },
+          "text/plain", 204, nullptr, "gzip");
+    });
+  }
+
+  // stream write mode sends all points of writePoints in one request
+  InfluxDBClient client(conn.serverUrl, "my-org", "my-bucket", conn.authToken);
+  client.setHTTPOptions(HTTPOptions().connectionReuse(true));
+  client.setStreamWrite(true);
+  std::vector<Point> points;
+  for (int i = 0; i < 100; i++) {
+    Point point("environment");
+    point.addTag("device", "ESP32");
+    point.addField("temperature", 20 + i % 7 + 0.5);
+    point.setTime(1600000000123456789ULL + i * 1000000000ULL);
+    points.push_back(point);
+  }
+  run("InfluxDBClient::writePoints/streamWrite", points.size(),
+      [&](uint64_t) { client.writePoints(points.begin(), points.end()); });
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--filter=", 0) == 0) {
+      options.filter = arg.substr(9);
+    } else if (arg.rfind("--min-time=", 0) == 0) {
+      options.minTime = std::chrono::milliseconds(atoi(arg.c_str() + 11));
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--filter=<substring>] [--min-time=<ms>]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  printf("{\n  \"library\": \"influxdb-client-arduino\",\n");
+  printf("  \"version\": \"%s\",\n", INFLUXDB_CLIENT_VERSION);
+  printf("  \"benchmarks\": [");
+  benchPoint();
+  benchFloatFormat();
+  benchIntFormat();
+  benchEscaping();
+  benchQuery();
+  benchHTTP();
+  printf("\n  ]\n}\n");
+  return 0;
+}
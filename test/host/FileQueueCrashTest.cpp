@@ -0,0 +1,309 @@
+/**
+ *
+ * FileQueueCrashTest.cpp: Crash consistency test of the persistent write queue
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host only test. A child process appends and removes records in a loop and
+// is killed at a random moment, possibly in the middle of a record. The queue
+// reopened afterwards must hold a contiguous sequence of intact records that
+// includes every record reported as synced and not removed.
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "util/FileQueue.h"
+
+#define CHECK(cond, ...)                                  \
+  if (!(cond)) {                                          \
+    printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);     \
+    printf(__VA_ARGS__);                                  \
+    printf("\n");                                         \
+    return false;                                         \
+  }
+
+// State reported by the writer after each sync or removal
+struct Report {
+  // Id of the oldest record, all older are removed and cursor is synced.
+  // Records removed later can be replayed again
+  uint32_t first;
+  // Id after the last synced record
+  uint32_t durableEnd;
+};
+
+static std::string makeRecord(uint32_t id) {
+  std::string record = "m,id=" + std::to_string(id) + " v=" +
+                       std::to_string(id) + "i,s=\"";
+  // variable length, so records wrap segments at various positions
+  record.append(id * 7919 % 200, 'a' + id % 26);
+  record += "\"";
+  return record;
+}
+
+static bool parseRecord(const char *data, size_t length, uint32_t &id) {
+  std::string record(data, length);
+  if (sscanf(record.c_str(), "m,id=%u", &id) != 1) {
+    return false;
+  }
+  return record == makeRecord(id);
+}
+
+// Replays queue in dir, checks records and returns ids range
+static bool replay(const std::string &dir, FileQueue &queue, uint32_t &first,
+                   uint32_t &end) {
+  bool valid = true;
+  uint32_t count = 0;
+  first = end = 0;
+  bool opened = queue.open([&](const char *data, size_t length) {
+    uint32_t id;
+    if (!parseRecord(data, length, id)) {
+      printf("damaged record: %.*s\n", (int)length, data);
+      valid = false;
+      return;
+    }
+    if (count == 0) {
+      first = id;
+    } else if (id != end) {
+      printf("expected id %u, got %u\n", end, id);
+      valid = false;
+    }
+    end = id + 1;
+    count++;
+  });
+  CHECK(opened, "cannot open %s", dir.c_str());
+  CHECK(valid, "invalid replay");
+  CHECK(queue.size() == count, "size %u, replayed %u", queue.size(), count);
+  return true;
+}
+
+// Writes records until killed
+static void writer(const std::string &dir, int reportFd, unsigned seed) {
+  FileQueue queue(dir, 512, UINT16_MAX);
+  uint32_t first, end;
+  if (!replay(dir, queue, first, end)) {
+    _exit(2);
+  }
+  if (queue.size() == 0) {
+    first = end;
+  }
+  srand(seed);
+  uint32_t durableEnd = end;
+  uint32_t durableFirst = first;
+  for (uint32_t id = end;; id++) {
+    std::string record = makeRecord(id);
+    // write in parts, so a kill can tear the record
+    const size_t half = record.length() / 2;
+    if (!queue.beginRecord(record.length()) ||
+        !queue.write(record.c_str(), half) ||
+        !queue.write(record.c_str() + half, record.length() - half) ||
+        !queue.endRecord()) {
+      _exit(3);
+    }
+    Report report{durableFirst, durableEnd};
+    if (rand() % 4 == 0) {
+      if (!queue.sync()) {
+        _exit(4);
+      }
+      report.durableEnd = durableEnd = id + 1;
+      report.first = durableFirst = first;
+    } else if (rand() % 3 == 0 && durableEnd - first > 1) {
+      // remove records, keeping the last synced one
+      uint32_t count = rand() % (durableEnd - first - 1) + 1;
+      if (!queue.pop(count)) {
+        _exit(5);
+      }
+      first += count;
+    } else {
+      continue;
+    }
+    if (write(reportFd, &report, sizeof(report)) != sizeof(report)) {
+      _exit(6);
+    }
+  }
+}
+
+static bool testCrashes(const std::string &dir) {
+  Report last{0, 0};
+  for (int round = 0; round < 40; round++) {
+    int fds[2];
+    CHECK(pipe(fds) == 0, "pipe");
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      writer(dir, fds[1], round);
+    }
+    close(fds[1]);
+    usleep(1000 + rand() % 20000);
+    kill(pid, SIGKILL);
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status), "writer exited with %d", WEXITSTATUS(status));
+    Report report;
+    while (read(fds[0], &report, sizeof(report)) == sizeof(report)) {
+      last = report;
+    }
+    close(fds[0]);
+
+    FileQueue queue(dir, 512, UINT16_MAX);
+    uint32_t first, end;
+    if (!replay(dir, queue, first, end)) {
+      return false;
+    }
+    CHECK(queue.size() > 0 || last.durableEnd == 0, "round %d: queue empty",
+          round);
+    CHECK(first >= last.first, "round %d: removed record %u replayed", round,
+          first);
+    CHECK(end >= last.durableEnd, "round %d: synced record %u lost", round,
+          end);
+    printf("round %d: replayed %u - %u\n", round, first, end);
+  }
+  return true;
+}
+
+static bool testTornTail(const std::string &dir) {
+  {
+    FileQueue queue(dir, 512, 1);
+    uint32_t first, end;
+    CHECK(replay(dir, queue, first, end), "open");
+    for (uint32_t id = 0; id < 10; id++) {
+      std::string record = makeRecord(id);
+      CHECK(queue.push(record.c_str(), record.length()), "push");
+    }
+    CHECK(queue.pop(3), "pop");
+  }
+  // append a partial record to the newest segment
+  std::string last;
+  DIR *d = opendir(dir.c_str());
+  struct dirent *entry;
+  while ((entry = readdir(d)) != nullptr) {
+    std::string name = entry->d_name;
+    if (name.length() > 2 && name.substr(name.length() - 2) == ".q" &&
+        name > last) {
+      last = name;
+    }
+  }
+  closedir(d);
+  CHECK(!last.empty(), "no segment");
+  FILE *f = fopen((dir + "/" + last).c_str(), "ab");
+  const uint8_t torn[] = {50, 0, 0, 0, 'm', ',', 'i', 'd'};
+  fwrite(torn, 1, sizeof(torn), f);
+  fclose(f);
+
+  FileQueue queue(dir, 512, 1);
+  uint32_t first, end;
+  CHECK(replay(dir, queue, first, end), "reopen");
+  CHECK(first == 3 && end == 10, "replayed %u - %u", first, end);
+  // new records continue in a new segment
+  std::string record = makeRecord(10);
+  CHECK(queue.push(record.c_str(), record.length()), "push");
+  CHECK(queue.pop(7), "pop");
+  FileQueue queue2(dir, 512, 1);
+  CHECK(replay(dir, queue2, first, end), "reopen");
+  CHECK(first == 10 && end == 11, "replayed %u - %u", first, end);
+  return true;
+}
+
+// Runs action on the queue in dir in a child process, which exits without
+// closing the queue, as if it crashed. Returns ids range replayed afterwards
+static bool crashAfter(const std::string &dir,
+                       const std::function<bool(FileQueue &)> &action,
+                       uint32_t &first, uint32_t &end) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    // _exit skips the destructor
+    FileQueue queue(dir, 16384, 5);
+    _exit(replay(dir, queue, first, end) && action(queue) ? 0 : 1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child failed");
+  FileQueue queue(dir, 16384, 5);
+  return replay(dir, queue, first, end);
+}
+
+static bool testStaleCursor(const std::string &dir) {
+  uint32_t first, end;
+  CHECK(crashAfter(dir,
+                   [](FileQueue &queue) {
+                     for (uint32_t id = 0; id < 20; id++) {
+                       std::string record = makeRecord(id);
+                       CHECK(queue.push(record.c_str(), record.length()),
+                             "push");
+                     }
+                     // cursor is written after syncInterval removed records
+                     CHECK(queue.pop(4), "pop");
+                     return true;
+                   },
+                   first, end),
+        "crash");
+  CHECK(first == 0 && end == 20, "replayed %u - %u", first, end);
+  CHECK(crashAfter(dir, [](FileQueue &queue) { return queue.pop(5); }, first,
+                   end),
+        "crash");
+  CHECK(first == 5 && end == 20, "replayed %u - %u", first, end);
+  // or by sync
+  CHECK(crashAfter(dir,
+                   [](FileQueue &queue) {
+                     return queue.pop(2) && queue.sync();
+                   },
+                   first, end),
+        "crash");
+  CHECK(first == 7 && end == 20, "replayed %u - %u", first, end);
+  return true;
+}
+
+static void removeDir(const std::string &dir) {
+  DIR *d = opendir(dir.c_str());
+  if (!d) {
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(d)) != nullptr) {
+    if (entry->d_name[0] != '.') {
+      unlink((dir + "/" + entry->d_name).c_str());
+    }
+  }
+  closedir(d);
+  rmdir(dir.c_str());
+}
+
+int main() {
+  char tmpl[] = "/tmp/influxdb-queue-XXXXXX";
+  std::string base = mkdtemp(tmpl);
+  srand(getpid());
+  bool ok = testTornTail(base + "/torn") &&
+            testStaleCursor(base + "/stale") && testCrashes(base + "/crash");
+  removeDir(base + "/torn");
+  removeDir(base + "/stale");
+  removeDir(base + "/crash");
+  rmdir(base.c_str());
+  printf("%s\n", ok ? "SUCCEEDED" : "FAILED");
+  return ok ? 0 : 1;
+}
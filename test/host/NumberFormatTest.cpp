@@ -0,0 +1,236 @@
+/**
+ *
+ * NumberFormatTest.cpp: Test of formatting numbers for line protocol
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host only test. Checks formatting of special values and that the shortest
+// representation of random doubles and floats converts back to the same
+// value and fixed precision matches printf up to 2^63, except for ties.
+// Integers are compared with std::to_string.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <limits>
+#include <random>
+#include <string>
+
+#include "util/NumberFormat.h"
+
+#define CHECK(cond, ...)                                  \
+  if (!(cond)) {                                          \
+    printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);     \
+    printf(__VA_ARGS__);                                  \
+    printf("\n");                                         \
+    return false;                                         \
+  }
+
+static std::string format(double value, int decimalPlaces = -1) {
+  char buff[FloatBufferSize];
+  return std::string(buff, formatDouble(buff, value, decimalPlaces));
+}
+
+static std::string formatF(float value, int decimalPlaces = -1) {
+  char buff[FloatBufferSize];
+  return std::string(buff, formatFloat(buff, value, decimalPlaces));
+}
+
+static bool testSpecialValues() {
+  struct {
+    double value;
+    int decimalPlaces;
+    const char *expected;
+  } cases[] = {
+      {0.0, -1, "0"},
+      {-0.0, -1, "-0"},
+      {1.0, -1, "1"},
+      {-21.5, -1, "-21.5"},
+      {0.1, -1, "0.1"},
+      {0.1 + 0.2, -1, "0.30000000000000004"},
+      {1e-4, -1, "0.0001"},
+      {1e-5, -1, "1e-05"},
+      {123456789012345.0, -1, "123456789012345"},
+      {1e15, -1, "1e+15"},
+      {1.5e300, -1, "1.5e+300"},
+      {5e-324, -1, "5e-324"},
+      {1.7976931348623157e308, -1, "1.7976931348623157e+308"},
+      {1.0, 0, "1"},
+      {2.5, 0, "3"},
+      {-2.5, 0, "-3"},
+      {1.005, 2, "1.00"},
+      {2.675, 2, "2.67"},
+      {-0.001, 2, "-0.00"},
+      {1234.5678, 3, "1234.568"},
+      {0.000123, 5, "0.00012"},
+      {99147832973978.75, 2, "99147832973978.75"},
+      {-246052652183842.19, 4, "-246052652183842.1875"},
+      {-11935319286735.58, 7, "-11935319286735.5800781"},
+      {614183737421405.88, 8, "614183737421405.87500000"},
+      {9007199254740993.0, 1, "9007199254740992.0"},
+      {9223372036854774784.0, 0, "9223372036854774784"},
+      {1e20, 2, "100000000000000000000.00"},
+      {-1e21, 16, "-1000000000000000000000.0000000000000000"},
+      {-1e21, 17, "-1e+21"},
+      {1e22, 17, "1e+22"},
+      {1.5e300, 0, "1.5e+300"},
+      {0.00390625, 8, "0.00390625"},
+      {0.001953125, 8, "0.00195313"},
+      {5e-324, 17, "0.00000000000000000"},
+      {NAN, -1, ""},
+      {INFINITY, 2, ""},
+      {-INFINITY, -1, ""},
+  };
+  for (auto &c : cases) {
+    auto s = format(c.value, c.decimalPlaces);
+    CHECK(s == c.expected, "%.17g %d: %s, expected %s", c.value,
+          c.decimalPlaces, s.c_str(), c.expected);
+  }
+  CHECK(formatF(21.3f) == "21.3", "%s", formatF(21.3f).c_str());
+  CHECK(formatF(16777216.0f) == "16777216", "%s",
+        formatF(16777216.0f).c_str());
+  CHECK(formatF(1e-45f) == "1e-45", "%s", formatF(1e-45f).c_str());
+  CHECK(formatF(1.12345f, 5) == "1.12345", "%s", formatF(1.12345f, 5).c_str());
+  return true;
+}
+
+static bool testRoundTrip() {
+  std::mt19937_64 random(1);
+  for (int i = 0; i < 1000000; i++) {
+    // random bits cover whole range including subnormals
+    uint64_t bits = random();
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    if (isfinite(d)) {
+      auto s = format(d);
+      CHECK(strtod(s.c_str(), nullptr) == d, "%.17g: %s", d, s.c_str());
+    }
+    uint32_t fbits = uint32_t(bits >> 16);
+    float f;
+    memcpy(&f, &fbits, sizeof(f));
+    if (isfinite(f)) {
+      auto s = formatF(f);
+      CHECK(strtof(s.c_str(), nullptr) == f, "%.9g: %s", f, s.c_str());
+    }
+  }
+  return true;
+}
+
+// Returns true if value is exactly halfway between two numbers with
+// decimalPlaces, printf rounds such ties to even
+static bool isTie(double value, int decimalPlaces) {
+  // every double is written exactly with 1100 decimal places
+  static char exact[1500];
+  snprintf(exact, sizeof(exact), "%.1100f", value);
+  const char *frac = strchr(exact, '.') + 1 + decimalPlaces;
+  return *frac == '5' && strspn(frac + 1, "0") == strlen(frac + 1);
+}
+
+static bool checkFixed(double value, int decimalPlaces) {
+  char expected[64];
+  snprintf(expected, sizeof(expected), "%.*f", decimalPlaces, value);
+  auto s = format(value, decimalPlaces);
+  CHECK(s == expected || isTie(value, decimalPlaces), "%.17g %d: %s, expected %s", value, decimalPlaces,
+        s.c_str(), expected);
+  return true;
+}
+
+static bool testFixed() {
+  std::mt19937_64 random(2);
+  for (int i = 0; i < 300000; i++) {
+    const int decimalPlaces = i % 18;
+    // random bits with magnitude in [2^-70, 2^63)
+    uint64_t bits = random();
+    bits = (bits & 0x800fffffffffffff) |
+           (uint64_t(1023 - 70 + (bits >> 52) % 133) << 52);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    // decimal numbers, halfway cases of the fewer decimal places are common
+    const double pow10 = pow(10, i % 9);
+    const double decimal = double(int64_t(random()) >> (11 + i % 40)) / pow10;
+    if (!checkFixed(d, decimalPlaces) || !checkFixed(decimal, decimalPlaces)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool checkInt(int64_t value) {
+  char buff[IntBufferSize];
+  std::string s(buff, formatInt(buff, value));
+  CHECK(s == std::to_string(value), "%s", s.c_str());
+  if (value >= 0) {
+    CHECK(countDigits(value) == s.length(), "%s", s.c_str());
+  }
+  uint64_t u = uint64_t(value);
+  std::string us(buff, formatUInt(buff, u));
+  CHECK(us == std::to_string(u), "%s", us.c_str());
+  CHECK(countDigits(u) == us.length(), "%s", us.c_str());
+  return true;
+}
+
+static bool testIntegers() {
+  // every power of ten and its neighbours, 10^18 is the largest in int64
+  int64_t p = 1;
+  for (int i = 0; i <= 18; i++) {
+    if (!checkInt(p - 1) || !checkInt(p) || !checkInt(p + 1) ||
+        !checkInt(-p)) {
+      return false;
+    }
+    if (i < 18) {
+      p *= 10;
+    }
+  }
+  const int64_t min = std::numeric_limits<int64_t>::min();
+  const int64_t max = std::numeric_limits<int64_t>::max();
+  char buff[IntBufferSize];
+  std::string s(buff, formatInt(buff, min));
+  CHECK(s == "-9223372036854775808", "%s", s.c_str());
+  s.assign(buff, formatInt(buff, max));
+  CHECK(s == "9223372036854775807", "%s", s.c_str());
+  s.assign(buff, formatUInt(buff, std::numeric_limits<uint64_t>::max()));
+  CHECK(s == "18446744073709551615", "%s", s.c_str());
+  if (!checkInt(min) || !checkInt(min + 1) || !checkInt(max) ||
+      !checkInt(max - 1) || !checkInt(std::numeric_limits<uint32_t>::max()) ||
+      !checkInt(int64_t(std::numeric_limits<uint32_t>::max()) + 1)) {
+    return false;
+  }
+  std::mt19937_64 random(3);
+  for (int i = 0; i < 1000000; i++) {
+    // vary magnitude, so all lengths are covered equally
+    if (!checkInt(int64_t(random()) >> (i % 64))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  bool ok = testSpecialValues() && testRoundTrip() && testFixed() &&
+            testIntegers();
+  printf("%s\n", ok ? "SUCCEEDED" : "FAILED");
+  return ok ? 0 : 1;
+}
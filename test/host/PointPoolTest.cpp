@@ -0,0 +1,161 @@
+/**
+ *
+ * PointPoolTest.cpp: Checks that writing pooled points does not allocate
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host only test. Counts heap allocations made while points acquired from a
+// PointPool are filled and written to the buffer of a client. Once the pool
+// and the buffer are warmed up, no allocation is expected.
+
+#include <InfluxDbClient.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+static std::atomic<uint64_t> allocCount{0};
+
+static void *countedAlloc(size_t size) {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+#define CHECK(cond, ...)                                  \
+  if (!(cond)) {                                          \
+    printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);     \
+    printf(__VA_ARGS__);                                  \
+    printf("\n");                                         \
+    return false;                                         \
+  }
+
+static const std::string measurement = "environment";
+static const std::string device = "device";
+static const std::string location = "location";
+static const std::string room = "living room";
+static const std::string temperature = "temperature";
+static const std::string status = "status";
+
+// Writes count points from the pool, returns number of allocations
+template <class Write>
+static uint64_t writePoints(int count, Write write) {
+  const uint64_t start = allocCount.load();
+  for (int i = 0; i < count; i++) {
+    write(i);
+  }
+  return allocCount.load() - start;
+}
+
+static bool testPool() {
+  PointPool pool(2);
+  CHECK(pool.size() == 2, "%zu", pool.size());
+  {
+    Point p1 = pool.acquire(measurement);
+    Point p2 = p1;
+    CHECK(pool.used() == 1, "%zu", pool.used());
+    Point p3 = pool.acquire(measurement);
+    Point p4 = pool.acquire(measurement);
+    CHECK(pool.used() == 3 && pool.size() == 3, "%zu %zu", pool.used(),
+          pool.size());
+  }
+  CHECK(pool.used() == 0, "%zu", pool.used());
+  // acquired point is cleared
+  Point p = pool.acquire(measurement);
+  p.addTag(device, "ESP32");
+  p.addField(temperature, 21.5);
+  p.setTime(1600000000ULL);
+  std::string line = p.toLineProtocol();
+  CHECK(line == "environment,device=ESP32 temperature=21.50 1600000000\n", "%s",
+        line.c_str());
+  p = pool.acquire(PointSchema("air"));
+  p.addField("co2", 600);
+  line = p.toLineProtocol();
+  CHECK(line == "air co2=600i\n", "%s", line.c_str());
+  return true;
+}
+
+static bool testNoAllocation() {
+  InfluxDBClient client("http://localhost:8086", "org", "bucket", "token");
+  // points are only buffered, the oldest are overwritten
+  client.setWriteOptions(WriteOptions()
+                             .batchSize(100)
+                             .bufferSize(2)
+                             .addDefaultTag("firmware", "1.2.0"));
+  PointPool pool(4);
+  auto byName = [&](int i) {
+    Point p = pool.acquire(measurement);
+    p.addTag(device, "ESP32");
+    p.addTag(location, room);
+    p.addField(temperature, 21.5 + i * 0.01);
+    p.addField(status, "ok");
+    p.setTime(1600000000123456789ULL + i);
+    client.writePoint(p, false);
+  };
+  PointSchema schema(measurement);
+  schema.addTag(device, "ESP32").addTag(location, room);
+  auto temperatureField = schema.field(temperature);
+  auto statusField = schema.field(status);
+  auto bySchema = [&](int i) {
+    Point p = pool.acquire(schema);
+    p.addField(temperatureField, 21.5 + i * 0.01);
+    p.addField(statusField, "ok");
+    p.setTime(1600000000123456789ULL + i);
+    client.writePoint(p, false);
+  };
+  // warm up
+  writePoints(1000, byName);
+  writePoints(1000, bySchema);
+  uint64_t allocs = writePoints(10000, byName);
+  CHECK(allocs == 0, "by name: %llu allocations", (unsigned long long)allocs);
+  allocs = writePoints(10000, bySchema);
+  CHECK(allocs == 0, "by schema: %llu allocations",
+        (unsigned long long)allocs);
+  // the same without pool allocates data of each point
+  allocs = writePoints(100, [&](int i) {
+    Point p(schema);
+    p.addField(temperatureField, 21.5 + i * 0.01);
+    client.writePoint(p, false);
+  });
+  CHECK(allocs >= 100, "without pool: %llu allocations",
+        (unsigned long long)allocs);
+  return true;
+}
+
+int main() {
+  bool ok = testPool() && testNoAllocation();
+  printf("%s\n", ok ? "SUCCEEDED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+/**
+ *
+ * RetryTest.cpp: Checks retrying of failed writes
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Host only test. Writes to a local TestServer which fails health checks or
+// writes and checks that points are dropped after maxRetryAttempts.
+
+#include <InfluxDbClient.h>
+#include <stdio.h>
+
+#include "TestServer.h"
+
+#define CHECK(cond, ...)                              \
+  if (!(cond)) {                                      \
+    printf("%s:%d: %s: ", __FILE__, __LINE__, #cond); \
+    printf(__VA_ARGS__);                              \
+    printf("\n");                                     \
+    return false;                                     \
+  }
+
+// Returns options retrying immediately, checking health before every write
+static WriteOptions retryOptions(uint16_t maxRetryAttempts) {
+  return WriteOptions()
+      .batchSize(2)
+      .bufferSize(10)
+      .retryInterval(std::chrono::seconds{0})
+      .maxRetryInterval(std::chrono::seconds{0})
+      .retryJitter(false)
+      .maxRetryAttempts(maxRetryAttempts)
+      .healthCheckPolicy(HealthCheckPolicy::Always);
+}
+
+static void writePoints(InfluxDBClient &client, int from, int to) {
+  for (int i = from; i < to; i++) {
+    Point p("test");
+    p.addField("index", i);
+    client.writePoint(p, false);
+  }
+}
+
+static bool testHealthCheckFailures() {
+  TestServer server;
+  InfluxDBClient client(server.getUrl(), "org", "bucket", "token");
+  client.setWriteOptions(retryOptions(2));
+  writePoints(client, 0, 4);
+  // 2 failed health checks are retried, the third one drops the first batch
+  server.healthStatus = 503;
+  server.healthFailures = 3;
+  for (int i = 0; i < 3; i++) {
+    CHECK(!client.flushBuffer(), "attempt %d", i);
+  }
+  CHECK(server.healthChecks == 3, "%d", server.healthChecks.load());
+  CHECK(server.writes == 0, "%d", server.writes.load());
+  CHECK(client.flushBuffer(), "%s", client.getLastErrorMessage().c_str());
+  auto lines = server.getLines();
+  CHECK(lines.size() == 2, "%zu", lines.size());
+  CHECK(lines[0] == "test index=2i" && lines[1] == "test index=3i", "%s %s",
+        lines[0].c_str(), lines[1].c_str());
+  return true;
+}
+
+static bool testHealthCheckRecovery() {
+  TestServer server;
+  InfluxDBClient client(server.getUrl(), "org", "bucket", "token");
+  client.setWriteOptions(retryOptions(2));
+  writePoints(client, 0, 4);
+  // failures below the limit keep all points
+  server.healthStatus = 503;
+  server.healthFailures = 2;
+  CHECK(!client.flushBuffer(), "first attempt");
+  CHECK(!client.flushBuffer(), "second attempt");
+  CHECK(client.flushBuffer(), "%s", client.getLastErrorMessage().c_str());
+  CHECK(server.getLines().size() == 4, "%zu", server.getLines().size());
+  // successful write resets the attempt count
+  writePoints(client, 4, 6);
+  server.healthFailures = 2;
+  CHECK(!client.flushBuffer(), "first attempt");
+  CHECK(!client.flushBuffer(), "second attempt");
+  CHECK(client.flushBuffer(), "%s", client.getLastErrorMessage().c_str());
+  CHECK(server.getLines().size() == 6, "%zu", server.getLines().size());
+  return true;
+}
+
+static bool testWriteFailures() {
+  TestServer server;
+  InfluxDBClient client(server.getUrl(), "org", "bucket", "token");
+  client.setWriteOptions(retryOptions(1));
+  writePoints(client, 0, 4);
+  server.writeStatus = 503;
+  CHECK(!client.flushBuffer(), "first attempt");
+  CHECK(!client.flushBuffer(), "second attempt");
+  server.writeStatus = 204;
+  CHECK(client.flushBuffer(), "%s", client.getLastErrorMessage().c_str());
+  auto lines = server.getLines();
+  CHECK(lines.size() == 2 && lines[0] == "test index=2i", "%zu", lines.size());
+  return true;
+}
+
+int main() {
+  bool ok =
+      testHealthCheckFailures() && testHealthCheckRecovery() && testWriteFailures();
+  printf("%s\n", ok ? "SUCCEEDED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/**
+ *
+ * TestServer.h: Minimal InfluxDB server for host tests
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 InfluxData
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _HOST_TEST_SERVER_H_
+#define _HOST_TEST_SERVER_H_
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * TestServer answers health checks and writes on a loopback port. Status codes
+ * of both can be changed by the test, written lines are recorded. Every
+ * connection is closed after one request.
+ */
+class TestServer {
+ public:
+  TestServer() {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(_fd, (sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(_fd, (sockaddr *)&addr, &len);
+    _port = ntohs(addr.sin_port);
+    listen(_fd, 16);
+    _thread = std::thread([this] { serve(); });
+  }
+  ~TestServer() {
+    shutdown(_fd, SHUT_RDWR);
+    close(_fd);
+    _thread.join();
+  }
+  std::string getUrl() const {
+    return "http://127.0.0.1:" + std::to_string(_port);
+  }
+  // Status code of the next healthFailures health checks, 200 afterwards
+  std::atomic<int> healthStatus{200};
+  std::atomic<int> healthFailures{0};
+  // Status code of writes
+  std::atomic<int> writeStatus{204};
+  std::atomic<int> healthChecks{0};
+  std::atomic<int> writes{0};
+  std::atomic<int> failedWrites{0};
+  // Returns lines of accepted writes
+  std::vector<std::string> getLines() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _lines;
+  }
+
+ private:
+  void serve() {
+    int conn;
+    while ((conn = accept(_fd, nullptr, nullptr)) >= 0) {
+      std::string request;
+      char buff[4096];
+      ssize_t r;
+      size_t length = 0;
+      while (!length && (r = read(conn, buff, sizeof(buff))) > 0) {
+        request.append(buff, r);
+        length = requestSize(request);
+      }
+      if (length) {
+        std::string response = handle(request.substr(0, length));
+        if (write(conn, response.data(), response.length()) < 0) {
+          perror("write");
+        }
+      }
+      close(conn);
+    }
+  }
+  std::string handle(const std::string &request) {
+    int status;
+    if (request.compare(0, 4, "GET ") == 0) {
+      healthChecks++;
+      status = 200;
+      if (healthFailures > 0) {
+        healthFailures--;
+        status = healthStatus;
+      }
+    } else {
+      writes++;
+      status = writeStatus;
+      if (status / 100 != 2) {
+        failedWrites++;
+      } else {
+        std::string body = requestBody(request);
+        std::lock_guard<std::mutex> guard(_mutex);
+        size_t start = 0, end;
+        while ((end = body.find('\n', start)) != std::string::npos) {
+          _lines.push_back(body.substr(start, end - start));
+          start = end + 1;
+        }
+      }
+    }
+    return "HTTP/1.1 " + std::to_string(status) +
+           " Status\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  }
+  // Returns size of the first request, 0 if it is not complete
+  static size_t requestSize(const std::string &request) {
+    size_t length = request.find("\r\n\r\n");
+    if (length == std::string::npos) {
+      return 0;
+    }
+    length += 4;
+    if (request.rfind("Transfer-Encoding: chunked", length) !=
+        std::string::npos) {
+      while (true) {
+        size_t end = request.find("\r\n", length);
+        if (end == std::string::npos) {
+          return 0;
+        }
+        size_t size = strtoul(request.c_str() + length, nullptr, 16);
+        length = end + 2 + size + 2;
+        if (length > request.length()) {
+          return 0;
+        }
+        if (size == 0) {
+          return length;
+        }
+      }
+    }
+    size_t cl = request.find("Content-Length: ");
+    if (cl != std::string::npos && cl < length) {
+      length += atoi(request.c_str() + cl + 16);
+    }
+    return length <= request.length() ? length : 0;
+  }
+  // Returns body of complete request, decoding chunks
+  static std::string requestBody(const std::string &request) {
+    size_t pos = request.find("\r\n\r\n") + 4;
+    if (request.rfind("Transfer-Encoding: chunked", pos) == std::string::npos) {
+      return request.substr(pos);
+    }
+    std::string body;
+    size_t size;
+    while ((size = strtoul(request.c_str() + pos, nullptr, 16)) > 0) {
+      pos = request.find("\r\n", pos) + 2;
+      body.append(request, pos, size);
+      pos += size + 2;
+    }
+    return body;
+  }
+  int _fd;
+  uint16_t _port;
+  std::thread _thread;
+  std::mutex _mutex;
+  std::vector<std::string> _lines;
+};
+
+#endif  //_HOST_TEST_SERVER_H_
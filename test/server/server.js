@@ -1,5 +1,6 @@
 const express = require('express');
 const readline = require('readline');
+const zlib = require('zlib');
 var os = require('os');
 const e = require('express');
 
@@ -12,6 +13,8 @@ var lastUserAgent = '';
 var chunked = false;
 var delay = 0;
 var permanentError = 0;
+var healthChecks = 0;
+var lastContentEncoding = '';
 const prefix = '';
 var server = undefined;
 
@@ -34,6 +37,7 @@ mgmtApp.get('/start', (req,res) => {
         server = app.listen(port);
         server.on('close',function() {
             pointsdb = [];
+            healthChecks = 0;
             server = undefined;
             console.log('Server closed');
         });
@@ -73,12 +77,23 @@ mgmtApp.post('/log', (req,res) => {
 
 app.use (function(req, res, next) {
     var data='';
-    req.setEncoding('utf8');
-    req.on('data', function(chunk) { 
+    var body = req;
+    if(req.method == 'POST') {
+        lastContentEncoding = req.get('Content-Encoding') || '';
+    }
+    if(req.get('Content-Encoding') == 'gzip') {
+        body = req.pipe(zlib.createGunzip());
+        body.on('error', function(err) {
+            console.log("gunzip error", err);
+            res.status(400).send("invalid gzip body: " + err.message);
+        });
+    }
+    body.setEncoding('utf8');
+    body.on('data', function(chunk) { 
        data += chunk;
     });
 
-    req.on('end', function() {
+    body.on('end', function() {
         req.body = data;
         next();
     });
@@ -90,13 +105,21 @@ app.get(prefix + '/ready', (req,res) => {
     lastUserAgent = req.get('User-Agent');
     res.status(200).send("<html><body><h1>OK</h1></body></html>");
 })
+app.get(prefix + '/test/content-encoding', (req,res) => {
+    res.status(200).send(lastContentEncoding);
+})
+app.get(prefix + '/test/health-checks', (req,res) => {
+    res.status(200).send(healthChecks.toString());
+})
 app.get(prefix + '/health', (req,res) => {
     lastUserAgent = req.get('User-Agent');
+    healthChecks++;
     res.status(200).send("<html><body><h1>OK</h1></body></html>");
 })
 
 app.get(prefix + '/ping', (req,res) => {
     lastUserAgent = req.get('User-Agent');
+    healthChecks++;
     if(req.query['verbose'] == 'true') {
         res.status(200).send("<html><body><h1>OK</h1></body></html>");
     } else {